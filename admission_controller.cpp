@@ -0,0 +1,129 @@
+#include "admission_controller.h"
+
+#include <algorithm>
+#include <execution>
+#include <thread>
+
+using namespace std;
+
+AdmissionController::AdmissionController(const SearchServer& search_server, const AdmissionOptions& options)
+	: search_server_(search_server)
+	, options_(options)
+{
+	if (options_.max_concurrent_queries == 0) {
+		options_.max_concurrent_queries = max(1u, thread::hardware_concurrency());
+	}
+	if (options_.degraded_max_plus_words == 0) {
+		throw invalid_argument("Degraded query must keep at least one word"s);
+	}
+}
+
+vector<Document> AdmissionController::FindTopDocuments(string_view raw_query, DocumentStatus status, QueryMode mode) {
+	vector<Document> result;
+	if (FillTopDocuments(raw_query, status, mode, result) == AdmissionDecision::REJECTED) {
+		throw QueryRejectedError("Query rejected by admission control"s);
+	}
+	return result;
+}
+
+AdmissionDecision AdmissionController::FillTopDocuments(string_view raw_query, DocumentStatus status, QueryMode mode, vector<Document>& result) {
+	const Ticket ticket = Admit(raw_query, mode);
+	result.clear();
+	if (ticket.decision == AdmissionDecision::REJECTED) {
+		return ticket.decision;
+	}
+
+	const auto filter = [status](int, DocumentStatus document_status, int) {
+		return document_status == status;
+	};
+	try {
+		if (ticket.decision == AdmissionDecision::DEGRADED) {
+			search_server_.FillTopDocuments(execution::seq, raw_query, mode, filter, SearchServer::QueryLimits{ options_.degraded_max_plus_words }, result);
+		} else {
+			search_server_.FillTopDocuments(execution::seq, raw_query, mode, filter, nullptr, result);
+		}
+	} catch (...) {
+		Release(ticket);
+		throw;
+	}
+	Release(ticket);
+	return ticket.decision;
+}
+
+AdmissionCounters AdmissionController::GetCounters() const {
+	lock_guard guard(mutex_);
+	return counters_;
+}
+
+size_t AdmissionController::GetInFlightQueries() const {
+	lock_guard guard(mutex_);
+	return in_flight_queries_;
+}
+
+size_t AdmissionController::GetInFlightCost() const {
+	lock_guard guard(mutex_);
+	return in_flight_cost_;
+}
+
+const AdmissionOptions& AdmissionController::GetOptions() const {
+	return options_;
+}
+
+AdmissionController::Ticket AdmissionController::Admit(string_view raw_query, QueryMode mode) {
+	// оценки считаются до блокировки: разбор запроса не должен задерживать остальные запросы
+	const SearchServer::QueryCost full_cost = search_server_.EstimateQueryCost(raw_query, mode);
+	const bool is_reducible = full_cost.plus_word_count > options_.degraded_max_plus_words;
+	const SearchServer::QueryCost degraded_cost = is_reducible
+		? search_server_.EstimateQueryCost(raw_query, mode, SearchServer::QueryLimits{ options_.degraded_max_plus_words })
+		: full_cost;
+	// упрощение могло ничего не отбросить, если почти все слова обязательные
+	const bool can_degrade = degraded_cost.plus_word_count < full_cost.plus_word_count;
+	const bool prefers_full = full_cost.posting_count <= options_.max_query_cost || !can_degrade;
+
+	lock_guard guard(mutex_);
+	Ticket ticket{ AdmissionDecision::REJECTED, 0 };
+	if (prefers_full && Fits(full_cost.posting_count)) {
+		ticket = { AdmissionDecision::ADMITTED, full_cost.posting_count };
+	} else if (can_degrade && Fits(degraded_cost.posting_count)) {
+		ticket = { AdmissionDecision::DEGRADED, degraded_cost.posting_count };
+	} else if (in_flight_queries_ == 0) {
+		ticket = can_degrade
+			? Ticket{ AdmissionDecision::DEGRADED, degraded_cost.posting_count }
+			: Ticket{ AdmissionDecision::ADMITTED, full_cost.posting_count };
+	}
+
+	switch (ticket.decision) {
+	case AdmissionDecision::ADMITTED:
+		++counters_.admitted;
+		break;
+	case AdmissionDecision::DEGRADED:
+		++counters_.degraded;
+		counters_.shed_cost += full_cost.posting_count - degraded_cost.posting_count;
+		break;
+	case AdmissionDecision::REJECTED:
+		++counters_.rejected;
+		if (in_flight_queries_ >= options_.max_concurrent_queries) {
+			++counters_.rejected_by_concurrency;
+		}
+		counters_.shed_cost += full_cost.posting_count;
+		return ticket;
+	}
+
+	++in_flight_queries_;
+	in_flight_cost_ += ticket.cost;
+	counters_.admitted_cost += ticket.cost;
+	counters_.peak_in_flight_queries = max(counters_.peak_in_flight_queries, in_flight_queries_);
+	counters_.peak_in_flight_cost = max(counters_.peak_in_flight_cost, in_flight_cost_);
+	return ticket;
+}
+
+bool AdmissionController::Fits(size_t cost) const {
+	return in_flight_queries_ < options_.max_concurrent_queries
+		&& in_flight_cost_ + cost <= options_.max_in_flight_cost;
+}
+
+void AdmissionController::Release(const Ticket& ticket) {
+	lock_guard guard(mutex_);
+	--in_flight_queries_;
+	in_flight_cost_ -= ticket.cost;
+}
\ No newline at end of file
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+struct AdmissionOptions {
+	// одновременно выполняемые запросы; 0 — по числу аппаратных потоков
+	size_t max_concurrent_queries = 0;
+	// сумма оценок (SearchServer::QueryCost::posting_count) выполняемых запросов
+	size_t max_in_flight_cost = 1 << 20;
+	// под нагрузкой запрос упрощается до стольких плюс-слов; при включённых списках по вкладу
+	// запрос из не более чем 4 слов выполняется с ранней остановкой
+	size_t degraded_max_plus_words = 4;
+	// запрос дороже этого упрощается, даже если бюджет свободен; SIZE_MAX — никогда
+	size_t max_query_cost = SIZE_MAX;
+};
+
+enum class AdmissionDecision {
+	ADMITTED,
+	// выполнен с ограничением SearchServer::QueryLimits
+	DEGRADED,
+	REJECTED,
+};
+
+struct AdmissionCounters {
+	uint64_t admitted = 0;
+	uint64_t degraded = 0;
+	uint64_t rejected = 0;
+	// запросы, отвергнутые из-за лимита одновременных запросов, а не бюджета стоимости
+	uint64_t rejected_by_concurrency = 0;
+	// сумма оценок выполненных запросов (после упрощения) и отброшенная упрощением часть
+	uint64_t admitted_cost = 0;
+	uint64_t shed_cost = 0;
+	size_t peak_in_flight_queries = 0;
+	size_t peak_in_flight_cost = 0;
+};
+
+class QueryRejectedError : public std::runtime_error {
+public:
+	using std::runtime_error::runtime_error;
+};
+
+// Допуск запросов перед выполнением: стоимость запроса оценивается по частотам его слов,
+// выполняемые запросы делят бюджет из числа запросов и суммы стоимостей. Запрос, который не
+// помещается в бюджет, упрощается до самых редких слов, а если не помещается и упрощённым —
+// отвергается сразу, без очереди. Единственный запрос в простаивающей системе всегда
+// выполняется (возможно, упрощённым), чтобы дорогой запрос не отвергался вечно.
+// Потокобезопасен; изменения индекса во время выполнения запросов недопустимы, как и для SearchServer
+class AdmissionController {
+public:
+	explicit AdmissionController(const SearchServer& search_server, const AdmissionOptions& options = {});
+
+	// Бросает QueryRejectedError для отвергнутого запроса и invalid_argument для некорректного
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, QueryMode mode = QueryMode::ANY);
+	// Отвергнутый запрос оставляет result пустым
+	AdmissionDecision FillTopDocuments(std::string_view raw_query, DocumentStatus status, QueryMode mode, std::vector<Document>& result);
+
+	AdmissionCounters GetCounters() const;
+	size_t GetInFlightQueries() const;
+	size_t GetInFlightCost() const;
+	const AdmissionOptions& GetOptions() const;
+
+private:
+	struct Ticket {
+		AdmissionDecision decision;
+		size_t cost;
+	};
+
+	const SearchServer& search_server_;
+	AdmissionOptions options_;
+
+	mutable std::mutex mutex_;
+	size_t in_flight_queries_ = 0;
+	size_t in_flight_cost_ = 0;
+	AdmissionCounters counters_;
+
+	Ticket Admit(std::string_view raw_query, QueryMode mode);
+	bool Fits(size_t cost) const;
+	void Release(const Ticket& ticket);
+};
\ No newline at end of file
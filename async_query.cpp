@@ -0,0 +1,274 @@
+#include "async_query.h"
+
+#include <algorithm>
+
+using namespace std;
+
+QueryExecutor::QueryExecutor(size_t thread_count) {
+	if (thread_count == 0) {
+		thread_count = max(1u, thread::hardware_concurrency());
+	}
+	for (size_t i = 0; i < thread_count; ++i) {
+		threads_.emplace_back([this] { RunTasks(); });
+	}
+	timer_thread_ = thread([this] { RunTimers(); });
+}
+
+QueryExecutor::~QueryExecutor() {
+	{
+		lock_guard guard(timer_mutex_);
+		timers_stopping_ = true;
+	}
+	timers_changed_.notify_one();
+	timer_thread_.join();
+
+	{
+		lock_guard guard(mutex_);
+		stopping_ = true;
+	}
+	task_available_.notify_all();
+	for (thread& worker : threads_) {
+		worker.join();
+	}
+}
+
+void QueryExecutor::Post(function<void()> task) {
+	{
+		lock_guard guard(mutex_);
+		tasks_.push_back(move(task));
+	}
+	task_available_.notify_one();
+}
+
+QueryExecutor::TimerId QueryExecutor::PostAt(Clock::time_point time, function<void()> task) {
+	TimerId timer;
+	{
+		lock_guard guard(timer_mutex_);
+		timer = { time, next_timer_id_++ };
+		timers_.emplace(timer, move(task));
+	}
+	timers_changed_.notify_one();
+	return timer;
+}
+
+void QueryExecutor::CancelTimer(const TimerId& timer) {
+	lock_guard guard(timer_mutex_);
+	timers_.erase(timer);
+}
+
+size_t QueryExecutor::GetThreadCount() const {
+	return threads_.size();
+}
+
+void QueryExecutor::RunTasks() {
+	while (true) {
+		function<void()> task;
+		{
+			unique_lock lock(mutex_);
+			task_available_.wait(lock, [this] {
+				return stopping_ || !tasks_.empty();
+			});
+			if (tasks_.empty()) {
+				return;
+			}
+			task = move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+	}
+}
+
+void QueryExecutor::RunTimers() {
+	unique_lock lock(timer_mutex_);
+	while (!timers_stopping_) {
+		if (timers_.empty()) {
+			timers_changed_.wait(lock);
+			continue;
+		}
+		const auto first = timers_.begin();
+		if (Clock::now() < first->first.first) {
+			timers_changed_.wait_until(lock, first->first.first);
+			continue;
+		}
+		function<void()> task = move(first->second);
+		timers_.erase(first);
+		lock.unlock();
+		task();
+		lock.lock();
+	}
+}
+
+CancellationToken::CancellationToken(shared_ptr<const atomic<bool>> cancelled)
+	: cancelled_(move(cancelled))
+{
+}
+
+bool CancellationToken::IsCancelled() const {
+	return cancelled_ != nullptr && cancelled_->load();
+}
+
+CancellationSource::CancellationSource()
+	: cancelled_(make_shared<atomic<bool>>(false))
+{
+}
+
+CancellationToken CancellationSource::GetToken() const {
+	return CancellationToken(cancelled_);
+}
+
+void CancellationSource::Cancel() {
+	cancelled_->store(true);
+}
+
+bool CancellationSource::IsCancelled() const {
+	return cancelled_->load();
+}
+
+QueryCancelledError::QueryCancelledError()
+	: runtime_error("Query was cancelled"s)
+{
+}
+
+QueryDeadlineExceededError::QueryDeadlineExceededError()
+	: runtime_error("Query deadline exceeded"s)
+{
+}
+
+namespace {
+
+struct AsyncQuery {
+	AsyncQuery(QueryExecutor& executor, const SearchServer& search_server, string raw_query, const AsyncQueryOptions& options, AsyncQueryCallback on_complete)
+		: executor(executor)
+		, search_server(search_server)
+		, raw_query(move(raw_query))
+		, options(options)
+		, on_complete(move(on_complete))
+	{
+	}
+
+	QueryExecutor& executor;
+	const SearchServer& search_server;
+	string raw_query;
+	AsyncQueryOptions options;
+	AsyncQueryCallback on_complete;
+	// запрос завершает тот, кто первым его заберёт: поток исполнителя или таймер дедлайна
+	atomic<bool> claimed{ false };
+	optional<QueryExecutor::TimerId> timer;
+};
+
+void Complete(AsyncQuery& query, vector<Document> documents, exception_ptr error) {
+	if (query.options.post_completion) {
+		query.options.post_completion([on_complete = move(query.on_complete), documents = move(documents), error]() mutable {
+			on_complete(move(documents), error);
+		});
+	} else {
+		query.on_complete(move(documents), error);
+	}
+}
+
+void RunQuery(AsyncQuery& query) {
+	if (query.claimed.exchange(true)) {
+		return;
+	}
+	if (query.timer) {
+		query.executor.CancelTimer(*query.timer);
+	}
+	const auto is_late = [&query] {
+		return query.options.deadline && QueryExecutor::Clock::now() >= *query.options.deadline;
+	};
+	if (query.options.cancellation.IsCancelled()) {
+		Complete(query, {}, make_exception_ptr(QueryCancelledError()));
+		return;
+	}
+	if (is_late()) {
+		Complete(query, {}, make_exception_ptr(QueryDeadlineExceededError()));
+		return;
+	}
+
+	vector<Document> documents;
+	exception_ptr error;
+	try {
+		const DocumentStatus status = query.options.status;
+		query.search_server.FillTopDocuments(execution::seq, query.raw_query, query.options.mode,
+			[status](int, DocumentStatus document_status, int) {
+				return document_status == status;
+			},
+			nullptr, documents);
+	} catch (...) {
+		error = current_exception();
+	}
+	if (!error && query.options.cancellation.IsCancelled()) {
+		error = make_exception_ptr(QueryCancelledError());
+	} else if (!error && is_late()) {
+		error = make_exception_ptr(QueryDeadlineExceededError());
+	}
+	if (error) {
+		documents.clear();
+	}
+	Complete(query, move(documents), error);
+}
+
+}
+
+void FindTopDocumentsAsync(QueryExecutor& executor, const SearchServer& search_server, string raw_query,
+	const AsyncQueryOptions& options, AsyncQueryCallback on_complete) {
+	auto query = make_shared<AsyncQuery>(executor, search_server, move(raw_query), options, move(on_complete));
+	// таймер ставится до задачи, чтобы поток исполнителя всегда видел его id
+	if (options.deadline) {
+		query->timer = executor.PostAt(*options.deadline, [query] {
+			if (!query->claimed.exchange(true)) {
+				Complete(*query, {}, make_exception_ptr(QueryDeadlineExceededError()));
+			}
+		});
+	}
+	executor.Post([query] {
+		RunQuery(*query);
+	});
+}
+
+future<vector<Document>> FindTopDocumentsAsync(QueryExecutor& executor, const SearchServer& search_server, string raw_query,
+	const AsyncQueryOptions& options) {
+	auto promise = make_shared<std::promise<vector<Document>>>();
+	auto result = promise->get_future();
+	FindTopDocumentsAsync(executor, search_server, move(raw_query), options,
+		[promise](vector<Document> documents, exception_ptr error) {
+			if (error) {
+				promise->set_exception(error);
+			} else {
+				promise->set_value(move(documents));
+			}
+		}
+	);
+	return result;
+}
+
+#ifdef __cpp_impl_coroutine
+TopDocumentsAwaiter::TopDocumentsAwaiter(QueryExecutor& executor, const SearchServer& search_server, string raw_query, AsyncQueryOptions options)
+	: executor_(executor)
+	, search_server_(search_server)
+	, raw_query_(move(raw_query))
+	, options_(move(options))
+{
+}
+
+void TopDocumentsAwaiter::await_suspend(coroutine_handle<> handle) {
+	FindTopDocumentsAsync(executor_, search_server_, move(raw_query_), options_,
+		[this, handle](vector<Document> documents, exception_ptr error) {
+			documents_ = move(documents);
+			error_ = error;
+			handle.resume();
+		}
+	);
+}
+
+vector<Document> TopDocumentsAwaiter::await_resume() {
+	if (error_) {
+		rethrow_exception(error_);
+	}
+	return move(documents_);
+}
+
+TopDocumentsAwaiter AwaitTopDocuments(QueryExecutor& executor, const SearchServer& search_server, string raw_query, AsyncQueryOptions options) {
+	return TopDocumentsAwaiter(executor, search_server, move(raw_query), move(options));
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#ifdef __cpp_impl_coroutine
+#include <coroutine>
+#endif
+
+#include "document.h"
+#include "search_server.h"
+
+// Пул потоков для асинхронных запросов и поток таймеров для их дедлайнов.
+// Задачи выполняются в порядке поступления; при уничтожении исполнитель выполняет
+// уже поставленные задачи, а ещё не сработавшие таймеры отбрасывает
+class QueryExecutor {
+public:
+	// 0 — по числу аппаратных потоков
+	explicit QueryExecutor(size_t thread_count = 0);
+	QueryExecutor(const QueryExecutor&) = delete;
+	QueryExecutor& operator=(const QueryExecutor&) = delete;
+	~QueryExecutor();
+
+	void Post(std::function<void()> task);
+
+	using Clock = std::chrono::steady_clock;
+	using TimerId = std::pair<Clock::time_point, uint64_t>;
+
+	// task выполняется в потоке таймеров не раньше time
+	TimerId PostAt(Clock::time_point time, std::function<void()> task);
+	// Несработавший таймер больше не сработает; сработавший не затрагивается
+	void CancelTimer(const TimerId& timer);
+
+	size_t GetThreadCount() const;
+
+private:
+	std::mutex mutex_;
+	std::condition_variable task_available_;
+	std::deque<std::function<void()>> tasks_;
+	bool stopping_ = false;
+	std::vector<std::thread> threads_;
+
+	std::mutex timer_mutex_;
+	std::condition_variable timers_changed_;
+	std::map<TimerId, std::function<void()>> timers_;
+	uint64_t next_timer_id_ = 0;
+	bool timers_stopping_ = false;
+	std::thread timer_thread_;
+
+	void RunTasks();
+	void RunTimers();
+};
+
+// Флаг отмены, общий для источника и его токенов
+class CancellationToken {
+public:
+	// Токен, который никогда не отменяется
+	CancellationToken() = default;
+
+	bool IsCancelled() const;
+
+private:
+	friend class CancellationSource;
+
+	std::shared_ptr<const std::atomic<bool>> cancelled_;
+
+	explicit CancellationToken(std::shared_ptr<const std::atomic<bool>> cancelled);
+};
+
+class CancellationSource {
+public:
+	CancellationSource();
+
+	CancellationToken GetToken() const;
+	void Cancel();
+	bool IsCancelled() const;
+
+private:
+	std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+class QueryCancelledError : public std::runtime_error {
+public:
+	QueryCancelledError();
+};
+
+class QueryDeadlineExceededError : public std::runtime_error {
+public:
+	QueryDeadlineExceededError();
+};
+
+struct AsyncQueryOptions {
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	QueryMode mode = QueryMode::ANY;
+	// запрос, не успевший завершиться к дедлайну, завершается QueryDeadlineExceededError;
+	// если он ещё в очереди — в момент дедлайна, не дожидаясь свободного потока
+	std::optional<QueryExecutor::Clock::time_point> deadline;
+	// проверяется перед выполнением и после него: начатый запрос доводится до конца,
+	// но его результат заменяется QueryCancelledError
+	CancellationToken cancellation;
+	// куда передаётся завершение (обратный вызов, продолжение корутины), например в
+	// очередь цикла событий; пусто — завершение выполняется в потоке исполнителя или таймера
+	std::function<void(std::function<void()>)> post_completion;
+};
+
+// error — nullptr при успехе, иначе исключение запроса, QueryCancelledError или QueryDeadlineExceededError
+using AsyncQueryCallback = std::function<void(std::vector<Document> documents, std::exception_ptr error)>;
+
+// Запрос выполняется FillTopDocuments(execution::seq, ...) в потоке executor, вызывающий
+// поток не блокируется. on_complete вызывается ровно один раз. server и executor должны
+// пережить завершение запроса, изменения индекса до завершения недопустимы
+void FindTopDocumentsAsync(QueryExecutor& executor, const SearchServer& search_server, std::string raw_query,
+	const AsyncQueryOptions& options, AsyncQueryCallback on_complete);
+
+std::future<std::vector<Document>> FindTopDocumentsAsync(QueryExecutor& executor, const SearchServer& search_server, std::string raw_query,
+	const AsyncQueryOptions& options = {});
+
+#ifdef __cpp_impl_coroutine
+// co_await AwaitTopDocuments(...) приостанавливает корутину до завершения запроса;
+// продолжение выполняется там же, где выполнилось бы завершение (см. post_completion)
+class TopDocumentsAwaiter {
+public:
+	TopDocumentsAwaiter(QueryExecutor& executor, const SearchServer& search_server, std::string raw_query, AsyncQueryOptions options);
+
+	bool await_ready() const noexcept {
+		return false;
+	}
+
+	void await_suspend(std::coroutine_handle<> handle);
+	std::vector<Document> await_resume();
+
+private:
+	QueryExecutor& executor_;
+	const SearchServer& search_server_;
+	std::string raw_query_;
+	AsyncQueryOptions options_;
+	std::vector<Document> documents_;
+	std::exception_ptr error_;
+};
+
+TopDocumentsAwaiter AwaitTopDocuments(QueryExecutor& executor, const SearchServer& search_server, std::string raw_query,
+	AsyncQueryOptions options = {});
+#endif
\ No newline at end of file
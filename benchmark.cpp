@@ -0,0 +1,611 @@
+#include "admission_controller.h"
+#include "async_query.h"
+#include "benchmark.h"
+#include "corpus_loader.h"
+#include "durable_search_server.h"
+#include "process_queries.h"
+#include "query_profiler.h"
+#include "query_session.h"
+#include "remove_duplicates.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <chrono>
+#include <execution>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+double ToSeconds(Clock::duration duration) {
+	return chrono::duration<double>(duration).count();
+}
+
+uint64_t ToNanoseconds(Clock::duration duration) {
+	return static_cast<uint64_t>(chrono::duration_cast<chrono::nanoseconds>(duration).count());
+}
+
+void AddLatencyMetrics(BenchmarkReport& report, const string& prefix, const LatencyHistogram& histogram, Clock::duration total) {
+	report.Add(prefix + ".p50"s, static_cast<double>(histogram.GetPercentile(0.5)), "ns"s);
+	report.Add(prefix + ".p90"s, static_cast<double>(histogram.GetPercentile(0.9)), "ns"s);
+	report.Add(prefix + ".p99"s, static_cast<double>(histogram.GetPercentile(0.99)), "ns"s);
+	report.Add(prefix + ".p999"s, static_cast<double>(histogram.GetPercentile(0.999)), "ns"s);
+	report.Add(prefix + ".mean"s, histogram.GetMean(), "ns"s);
+	report.Add(prefix + ".throughput"s, histogram.GetCount() / ToSeconds(total), "queries/s"s);
+}
+
+// Подавляет вывод RemoveDuplicates о каждом найденном дубликате
+class CoutSilencer {
+public:
+	CoutSilencer()
+		: old_buffer_(cout.rdbuf(nullptr))
+	{}
+
+	~CoutSilencer() {
+		cout.clear();
+		cout.rdbuf(old_buffer_);
+	}
+
+private:
+	streambuf* old_buffer_;
+};
+
+// Заменяет по одной букве в каждом плюс-слове запроса; минус-слова не исправляются, поэтому остаются как есть
+string MakeTypos(mt19937& generator, const string& query) {
+	string result = query;
+	for (size_t begin = 0; begin < result.size();) {
+		size_t end = result.find(' ', begin);
+		if (end == string::npos) {
+			end = result.size();
+		}
+		if (end > begin && result[begin] != '-') {
+			const size_t position = uniform_int_distribution<size_t>(begin, end - 1)(generator);
+			result[position] = static_cast<char>(uniform_int_distribution<int>('a', 'z')(generator));
+		}
+		begin = end + 1;
+	}
+	return result;
+}
+
+void PrintJsonString(ostream& os, const string& value) {
+	os << '"';
+	for (const char c : value) {
+		if (c == '"' || c == '\\') {
+			os << '\\';
+		}
+		os << c;
+	}
+	os << '"';
+}
+
+}
+
+void BenchmarkReport::Add(string name, double value, string unit) {
+	metrics_.push_back({ move(name), value, move(unit) });
+}
+
+const vector<BenchmarkMetric>& BenchmarkReport::GetMetrics() const {
+	return metrics_;
+}
+
+const BenchmarkMetric* BenchmarkReport::Find(const string& name) const {
+	const auto it = find_if(metrics_.begin(), metrics_.end(),
+		[&name](const BenchmarkMetric& metric) {
+			return metric.name == name;
+		}
+	);
+
+	return it == metrics_.end() ? nullptr : &*it;
+}
+
+void BenchmarkReport::PrintText(ostream& os) const {
+	os << setprecision(12);
+	for (const BenchmarkMetric& metric : metrics_) {
+		os << metric.name << ": "s << metric.value << ' ' << metric.unit << endl;
+	}
+}
+
+void BenchmarkReport::PrintJson(ostream& os, const BenchmarkOptions& options) const {
+	os << setprecision(12);
+	os << "{\n  \"config\": {"s
+		<< "\"documents\": "s << options.corpus.document_count
+		<< ", \"vocabulary\": "s << options.corpus.vocabulary_size
+		<< ", \"corpus_zipf\": "s << options.corpus.zipf_exponent
+		<< ", \"duplicate_fraction\": "s << options.corpus.duplicate_fraction
+		<< ", \"corpus_seed\": "s << options.corpus.seed
+		<< ", \"queries\": "s << options.queries.query_count
+		<< ", \"query_zipf\": "s << options.queries.zipf_exponent
+		<< ", \"query_seed\": "s << options.queries.seed
+		<< ", \"stop_words\": "s << options.stop_word_count
+		<< ", \"hardware_threads\": "s << thread::hardware_concurrency()
+		<< "},\n  \"metrics\": ["s;
+	bool is_first = true;
+	for (const BenchmarkMetric& metric : metrics_) {
+		os << (is_first ? "\n    {"s : ",\n    {"s) << "\"name\": "s;
+		PrintJsonString(os, metric.name);
+		os << ", \"value\": "s << metric.value << ", \"unit\": "s;
+		PrintJsonString(os, metric.unit);
+		os << "}"s;
+		is_first = false;
+	}
+	os << "\n  ],\n  \"query_profile\": "s;
+	PrintQueryProfileJson(os, GetQueryProfileSnapshot());
+	os << "\n}"s << endl;
+}
+
+BenchmarkReport RunBenchmarks(const BenchmarkOptions& options, ostream& log) {
+	BenchmarkReport report;
+	CorpusGenerator corpus(options.corpus);
+	const vector<string>& vocabulary = corpus.GetVocabulary();
+
+	// самые частые слова корпуса — естественные кандидаты в стоп-слова
+	const vector<string> stop_words(vocabulary.begin(), vocabulary.begin() + min(options.stop_word_count, vocabulary.size()));
+	SearchServer search_server(stop_words);
+
+	log << "Ingesting "s << options.corpus.document_count << " documents"s << endl;
+	const uint64_t rss_before_ingest = GetProcessResidentBytes();
+	Clock::duration ingest_time{};
+	size_t ingested_bytes = 0;
+	vector<GeneratedDocument> batch(max<size_t>(1, options.ingest_batch_size));
+	while (true) {
+		size_t batch_size = 0;
+		while (batch_size < batch.size() && corpus.Next(batch[batch_size])) {
+			ingested_bytes += batch[batch_size].text.size();
+			++batch_size;
+		}
+		if (batch_size == 0) {
+			break;
+		}
+		const Clock::time_point start = Clock::now();
+		for (size_t i = 0; i < batch_size; ++i) {
+			const GeneratedDocument& document = batch[i];
+			search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+		}
+		ingest_time += Clock::now() - start;
+	}
+	batch.clear();
+	batch.shrink_to_fit();
+	const uint64_t rss_after_ingest = GetProcessResidentBytes();
+
+	report.Add("ingest.documents_per_second"s, search_server.GetDocumentCount() / ToSeconds(ingest_time), "documents/s"s);
+	report.Add("ingest.megabytes_per_second"s, ingested_bytes / 1e6 / ToSeconds(ingest_time), "MB/s"s);
+	report.Add("ingest.total_time"s, ToSeconds(ingest_time), "s"s);
+	report.Add("memory.rss_after_ingest"s, static_cast<double>(rss_after_ingest), "bytes"s);
+	report.Add("memory.index_growth"s, static_cast<double>(rss_after_ingest > rss_before_ingest ? rss_after_ingest - rss_before_ingest : 0), "bytes"s);
+	report.Add("memory.index_growth_per_document"s,
+		static_cast<double>(rss_after_ingest > rss_before_ingest ? rss_after_ingest - rss_before_ingest : 0) / max(1, search_server.GetDocumentCount()),
+		"bytes"s);
+
+	{
+		const SearchServer::MemoryStats memory_stats = search_server.GetMemoryStats();
+		report.Add("memory.index.dictionary"s, static_cast<double>(memory_stats.dictionary), "bytes"s);
+		report.Add("memory.index.postings"s, static_cast<double>(memory_stats.postings), "bytes"s);
+		report.Add("memory.index.documents"s, static_cast<double>(memory_stats.documents), "bytes"s);
+		report.Add("memory.index.caches"s, static_cast<double>(memory_stats.caches), "bytes"s);
+		report.Add("memory.index.slack"s, static_cast<double>(memory_stats.slack), "bytes"s);
+		report.Add("memory.index.total"s, static_cast<double>(memory_stats.GetTotal()), "bytes"s);
+		report.Add("memory.index.bytes_per_document"s, static_cast<double>(memory_stats.GetTotal()) / max(1, search_server.GetDocumentCount()), "bytes"s);
+	}
+
+	const vector<string> queries = GenerateQueryLog(vocabulary, options.queries);
+	ResetQueryProfile();
+
+	log << "Running "s << queries.size() << " sequential queries"s << endl;
+	{
+		LatencyHistogram histogram;
+		vector<Document> result;
+		size_t found = 0;
+		const Clock::time_point start = Clock::now();
+		for (const string& query : queries) {
+			const Clock::time_point query_start = Clock::now();
+			search_server.FillTopDocuments(query, result);
+			histogram.Record(ToNanoseconds(Clock::now() - query_start));
+			found += result.size();
+		}
+		AddLatencyMetrics(report, "query.seq"s, histogram, Clock::now() - start);
+		report.Add("query.seq.average_results"s, static_cast<double>(found) / max<size_t>(1, queries.size()), "documents"s);
+	}
+
+	log << "Running "s << queries.size() << " queries with execution::par"s << endl;
+	{
+		LatencyHistogram histogram;
+		vector<Document> result;
+		const Clock::time_point start = Clock::now();
+		for (const string& query : queries) {
+			const Clock::time_point query_start = Clock::now();
+			search_server.FillTopDocuments(
+				execution::par,
+				query,
+				[](int, DocumentStatus status, int) {
+					return status == DocumentStatus::ACTUAL;
+				},
+				result
+			);
+			histogram.Record(ToNanoseconds(Clock::now() - query_start));
+		}
+		AddLatencyMetrics(report, "query.par"s, histogram, Clock::now() - start);
+	}
+	const double seq_p50 = report.Find("query.seq.p50"s)->value;
+	const double par_p50 = report.Find("query.par.p50"s)->value;
+	report.Add("query.par_speedup_p50"s, par_p50 > 0 ? seq_p50 / par_p50 : 0.0, "x"s);
+
+	log << "Running "s << queries.size() << " aggregation queries"s << endl;
+	{
+		LatencyHistogram histogram;
+		const Clock::time_point start = Clock::now();
+		for (const string& query : queries) {
+			const Clock::time_point query_start = Clock::now();
+			search_server.AggregateDocuments(query);
+			histogram.Record(ToNanoseconds(Clock::now() - query_start));
+		}
+		AddLatencyMetrics(report, "aggregate"s, histogram, Clock::now() - start);
+	}
+
+	log << "Running "s << queries.size() << " queries in QueryMode::ALL"s << endl;
+	{
+		LatencyHistogram histogram;
+		vector<Document> result;
+		size_t found = 0;
+		const Clock::time_point start = Clock::now();
+		for (const string& query : queries) {
+			const Clock::time_point query_start = Clock::now();
+			search_server.FillTopDocuments(
+				execution::seq,
+				query,
+				QueryMode::ALL,
+				[](int, DocumentStatus status, int) {
+					return status == DocumentStatus::ACTUAL;
+				},
+				nullptr,
+				result
+			);
+			histogram.Record(ToNanoseconds(Clock::now() - query_start));
+			found += result.size();
+		}
+		AddLatencyMetrics(report, "query.all"s, histogram, Clock::now() - start);
+		report.Add("query.all.average_results"s, static_cast<double>(found) / max<size_t>(1, queries.size()), "documents"s);
+		const double all_p50 = report.Find("query.all.p50"s)->value;
+		report.Add("query.all_speedup_p50"s, all_p50 > 0 ? seq_p50 / all_p50 : 0.0, "x"s);
+	}
+
+	for (const bool use_huge_pages : { false, true }) {
+		const string prefix = use_huge_pages ? "query.reorganized_huge_pages"s : "query.reorganized"s;
+		log << "Running "s << queries.size() << " queries over a reorganized index"s << (use_huge_pages ? " on huge pages"s : ""s) << endl;
+		SearchServer::ReorganizeOptions reorganize_options;
+		reorganize_options.query_sample = queries;
+		reorganize_options.use_huge_pages = use_huge_pages;
+		Clock::time_point start = Clock::now();
+		const SearchServer reorganized = SearchServer::Reorganize(search_server, reorganize_options);
+		report.Add(prefix + ".build_time"s, ToSeconds(Clock::now() - start), "s"s);
+
+		LatencyHistogram histogram;
+		vector<Document> result;
+		start = Clock::now();
+		for (const string& query : queries) {
+			const Clock::time_point query_start = Clock::now();
+			reorganized.FillTopDocuments(query, result);
+			histogram.Record(ToNanoseconds(Clock::now() - query_start));
+		}
+		AddLatencyMetrics(report, prefix, histogram, Clock::now() - start);
+		const double reorganized_p50 = report.Find(prefix + ".p50"s)->value;
+		report.Add(prefix + ".speedup_p50"s, reorganized_p50 > 0 ? seq_p50 / reorganized_p50 : 0.0, "x"s);
+	}
+
+	log << "Running "s << queries.size() << " queries over impact-ordered postings"s << endl;
+	{
+		Clock::time_point start = Clock::now();
+		search_server.SetImpactOrderedPostings(true);
+		report.Add("query.impact.build_time"s, ToSeconds(Clock::now() - start), "s"s);
+
+		LatencyHistogram histogram;
+		vector<Document> result;
+		start = Clock::now();
+		for (const string& query : queries) {
+			const Clock::time_point query_start = Clock::now();
+			search_server.FillTopDocuments(query, result);
+			histogram.Record(ToNanoseconds(Clock::now() - query_start));
+		}
+		AddLatencyMetrics(report, "query.impact"s, histogram, Clock::now() - start);
+		search_server.SetImpactOrderedPostings(false);
+	}
+	const double impact_p50 = report.Find("query.impact.p50"s)->value;
+	report.Add("query.impact_speedup_p50"s, impact_p50 > 0 ? seq_p50 / impact_p50 : 0.0, "x"s);
+
+	log << "Running "s << queries.size() << " queries with a typo in every word at fuzzy edit distances 1 and 2"s << endl;
+	{
+		mt19937 generator(static_cast<mt19937::result_type>(options.queries.seed));
+		vector<string> typo_queries;
+		typo_queries.reserve(queries.size());
+		for (const string& query : queries) {
+			typo_queries.push_back(MakeTypos(generator, query));
+		}
+		// точные запросы — query.seq; отношение p50 показывает, во сколько раз исправление дороже
+		for (const int max_distance : { 1, 2 }) {
+			const string prefix = "query.fuzzy"s + to_string(max_distance);
+			Clock::time_point start = Clock::now();
+			search_server.SetFuzzyEditDistance(max_distance);
+			report.Add(prefix + ".build_time"s, ToSeconds(Clock::now() - start), "s"s);
+
+			LatencyHistogram histogram;
+			vector<Document> result;
+			size_t found = 0;
+			start = Clock::now();
+			for (const string& query : typo_queries) {
+				const Clock::time_point query_start = Clock::now();
+				search_server.FillTopDocuments(query, result);
+				histogram.Record(ToNanoseconds(Clock::now() - query_start));
+				found += result.size();
+			}
+			AddLatencyMetrics(report, prefix, histogram, Clock::now() - start);
+			report.Add(prefix + ".average_results"s, static_cast<double>(found) / max<size_t>(1, typo_queries.size()), "documents"s);
+			const double fuzzy_p50 = report.Find(prefix + ".p50"s)->value;
+			report.Add(prefix + ".exact_ratio_p50"s, seq_p50 > 0 ? fuzzy_p50 / seq_p50 : 0.0, "x"s);
+		}
+		search_server.SetFuzzyEditDistance(0);
+	}
+
+	log << "Typing "s << min<size_t>(queries.size(), 500) << " queries keystroke by keystroke"s << endl;
+	{
+		LatencyHistogram session_histogram;
+		LatencyHistogram full_query_histogram;
+		QuerySession session(search_server);
+		vector<Document> result;
+		Clock::duration session_total{};
+		Clock::duration full_query_total{};
+		for (size_t i = 0; i < min<size_t>(queries.size(), 500); ++i) {
+			const string& query = queries[i];
+			session.Reset();
+			for (size_t length = 1; length <= query.size(); ++length) {
+				const string_view typed = string_view(query).substr(0, length);
+				const Clock::time_point session_start = Clock::now();
+				session.Update(typed);
+				const Clock::duration session_latency = Clock::now() - session_start;
+				session_histogram.Record(ToNanoseconds(session_latency));
+				session_total += session_latency;
+
+				// без сессии каждое нажатие — полный запрос; незавершённые пробел и минус он не принимает
+				if (typed.back() == ' ' || typed.back() == '-') {
+					continue;
+				}
+				const Clock::time_point query_start = Clock::now();
+				search_server.FillTopDocuments(typed, result);
+				const Clock::duration full_query_latency = Clock::now() - query_start;
+				full_query_histogram.Record(ToNanoseconds(full_query_latency));
+				full_query_total += full_query_latency;
+			}
+		}
+		AddLatencyMetrics(report, "typing.session"s, session_histogram, session_total);
+		AddLatencyMetrics(report, "typing.full_query"s, full_query_histogram, full_query_total);
+		const double session_p50 = report.Find("typing.session.p50"s)->value;
+		report.Add("typing.speedup_p50"s, session_p50 > 0 ? report.Find("typing.full_query.p50"s)->value / session_p50 : 0.0, "x"s);
+	}
+
+	log << "Running ProcessQueries"s << endl;
+	{
+		vector<vector<Document>> documents_lists;
+		const Clock::time_point start = Clock::now();
+		ProcessQueriesInto(search_server, queries, documents_lists);
+		const Clock::duration total = Clock::now() - start;
+		report.Add("process_queries.throughput"s, queries.size() / ToSeconds(total), "queries/s"s);
+		const double seq_throughput = report.Find("query.seq.throughput"s)->value;
+		report.Add("process_queries.speedup"s, seq_throughput > 0 ? queries.size() / ToSeconds(total) / seq_throughput : 0.0, "x"s);
+	}
+
+	log << "Running ProcessQueries through admission control with a budget of the median query cost"s << endl;
+	{
+		vector<size_t> costs;
+		const Clock::time_point estimate_start = Clock::now();
+		for (const string& query : queries) {
+			costs.push_back(search_server.EstimateQueryCost(query).posting_count);
+		}
+		report.Add("admission.estimate.per_query"s, static_cast<double>(ToNanoseconds(Clock::now() - estimate_start)) / max<size_t>(queries.size(), 1), "ns"s);
+		nth_element(costs.begin(), costs.begin() + costs.size() / 2, costs.end());
+
+		AdmissionOptions options;
+		options.max_in_flight_cost = costs.empty() ? 0 : costs[costs.size() / 2];
+		AdmissionController controller(search_server, options);
+		vector<vector<Document>> documents_lists;
+		const Clock::time_point start = Clock::now();
+		ProcessQueriesInto(controller, queries, documents_lists);
+		const Clock::duration total = Clock::now() - start;
+		const AdmissionCounters counters = controller.GetCounters();
+		report.Add("admission.throughput"s, queries.size() / ToSeconds(total), "queries/s"s);
+		const double process_throughput = report.Find("process_queries.throughput"s)->value;
+		report.Add("admission.speedup"s, process_throughput > 0 ? queries.size() / ToSeconds(total) / process_throughput : 0.0, "x"s);
+		report.Add("admission.admitted"s, static_cast<double>(counters.admitted), "queries"s);
+		report.Add("admission.degraded"s, static_cast<double>(counters.degraded), "queries"s);
+		report.Add("admission.rejected"s, static_cast<double>(counters.rejected), "queries"s);
+		report.Add("admission.shed_cost_share"s,
+			counters.admitted_cost + counters.shed_cost > 0 ? static_cast<double>(counters.shed_cost) / (counters.admitted_cost + counters.shed_cost) : 0.0, "ratio"s);
+	}
+
+	log << "Running "s << queries.size() << " asynchronous queries in flight at once"s << endl;
+	{
+		QueryExecutor executor;
+		vector<future<vector<Document>>> results;
+		results.reserve(queries.size());
+		const Clock::time_point start = Clock::now();
+		for (const string& query : queries) {
+			results.push_back(FindTopDocumentsAsync(executor, search_server, query));
+		}
+		for (auto& result : results) {
+			result.get();
+		}
+		const Clock::duration total = Clock::now() - start;
+		report.Add("query.async.throughput"s, queries.size() / ToSeconds(total), "queries/s"s);
+		report.Add("query.async.threads"s, static_cast<double>(executor.GetThreadCount()), "threads"s);
+	}
+
+	log << "Running MatchDocument"s << endl;
+	{
+		const vector<int> document_ids(search_server.begin(), search_server.begin() + min(search_server.GetDocumentCount(), 100));
+		size_t match_count = 0;
+		Clock::time_point start = Clock::now();
+		for (const string& query : queries) {
+			for (const int document_id : document_ids) {
+				match_count += get<0>(search_server.MatchDocument(query, document_id)).size();
+			}
+		}
+		const double single_time = ToSeconds(Clock::now() - start);
+		report.Add("match.single.throughput"s, queries.size() * document_ids.size() / single_time, "documents/s"s);
+
+		start = Clock::now();
+		for (const string& query : queries) {
+			for (const auto& [words, status] : search_server.MatchDocuments(query, document_ids)) {
+				match_count -= words.size();
+			}
+		}
+		const double batch_time = ToSeconds(Clock::now() - start);
+		report.Add("match.batch.throughput"s, queries.size() * document_ids.size() / batch_time, "documents/s"s);
+		if (match_count != 0) {
+			log << "MatchDocuments disagrees with MatchDocument"s << endl;
+		}
+	}
+
+	if (options.run_remove_duplicates) {
+		log << "Running RemoveDuplicates"s << endl;
+		const int document_count = search_server.GetDocumentCount();
+		const Clock::time_point start = Clock::now();
+		{
+			CoutSilencer silencer;
+			RemoveDuplicates(search_server);
+		}
+		const Clock::duration total = Clock::now() - start;
+		report.Add("remove_duplicates.time"s, ToSeconds(total), "s"s);
+		report.Add("remove_duplicates.removed"s, static_cast<double>(document_count - search_server.GetDocumentCount()), "documents"s);
+	}
+	report.Add("memory.rss_peak_sample"s, static_cast<double>(max(rss_after_ingest, GetProcessResidentBytes())), "bytes"s);
+
+	if (options.run_corpus_loader) {
+		// тот же корпус в TSV: сравнение с поштучным AddDocument показывает выигрыш от параллельного разбора
+		ostringstream tsv;
+		CorpusGenerator loader_corpus(options.corpus);
+		GeneratedDocument document;
+		while (loader_corpus.Next(document)) {
+			tsv << document.id << '\t' << static_cast<int>(document.status) << '\t';
+			for (size_t i = 0; i < document.ratings.size(); ++i) {
+				tsv << (i > 0 ? ","s : ""s) << document.ratings[i];
+			}
+			tsv << '\t' << document.text << '\n';
+		}
+		istringstream input(tsv.str());
+		tsv.str({});
+
+		log << "Loading the corpus through the streaming loader"s << endl;
+		SearchServer loaded_server(stop_words);
+		const CorpusLoadStats stats = LoadCorpus(loaded_server, input);
+		report.Add("loader.documents_per_second"s, stats.document_count / ToSeconds(stats.elapsed), "documents/s"s);
+		report.Add("loader.megabytes_per_second"s, stats.byte_count / 1e6 / ToSeconds(stats.elapsed), "MB/s"s);
+		report.Add("loader.worker_count"s, max(1u, thread::hardware_concurrency()), "threads"s);
+	}
+
+	log << "Verifying index consistency"s << endl;
+	{
+		Clock::time_point start = Clock::now();
+		const SearchServer::VerificationReport seq_report = search_server.Verify(execution::seq);
+		const double seq_time = ToSeconds(Clock::now() - start);
+		start = Clock::now();
+		const SearchServer::VerificationReport par_report = search_server.Verify(execution::par);
+		const double par_time = ToSeconds(Clock::now() - start);
+		report.Add("verify.seq.time"s, seq_time, "s"s);
+		report.Add("verify.par.time"s, par_time, "s"s);
+		report.Add("verify.par.postings_per_second"s, par_report.posting_count / par_time, "postings/s"s);
+		report.Add("verify.speedup"s, par_time > 0 ? seq_time / par_time : 0.0, "x"s);
+		report.Add("verify.violations"s, static_cast<double>(max(seq_report.violation_count, par_report.violation_count)), "violations"s);
+	}
+
+	{
+		// журнал пишется в каталог ОС для временных файлов; fsync на каждую запись ограничивает выборку
+		const size_t document_count = min<size_t>(options.corpus.document_count, 2'000);
+		vector<GeneratedDocument> documents(document_count);
+		CorpusGenerator wal_corpus(options.corpus);
+		for (GeneratedDocument& document : documents) {
+			wal_corpus.Next(document);
+		}
+		const filesystem::path directory = filesystem::temp_directory_path() / ("search_server_benchmark_wal_"s + to_string(random_device{}()));
+
+		log << "Ingesting "s << document_count << " documents through the write-ahead log"s << endl;
+		const auto ingest = [&](size_t writer_count, optional<size_t> sync_every_records) {
+			SearchServer server(stop_words);
+			filesystem::remove_all(directory);
+			optional<DurableSearchServer> durable;
+			if (sync_every_records) {
+				DurableSearchServerOptions durable_options;
+				durable_options.log.sync_every_records = *sync_every_records;
+				durable.emplace(server, directory.string(), durable_options);
+			}
+			const Clock::time_point start = Clock::now();
+			vector<thread> writers;
+			for (size_t writer = 0; writer < writer_count; ++writer) {
+				writers.emplace_back([&, writer] {
+					for (size_t i = writer; i < documents.size(); i += writer_count) {
+						const GeneratedDocument& document = documents[i];
+						if (durable) {
+							durable->AddDocument(document.id, document.text, document.status, document.ratings);
+						} else {
+							server.AddDocument(document.id, document.text, document.status, document.ratings);
+						}
+					}
+				});
+			}
+			for (thread& writer : writers) {
+				writer.join();
+			}
+			if (durable) {
+				durable->Sync();
+			}
+			return documents.size() / ToSeconds(Clock::now() - start);
+		};
+
+		const double memory_throughput = ingest(1, nullopt);
+		report.Add("wal.memory.documents_per_second"s, memory_throughput, "documents/s"s);
+		const auto add_mode = [&](const string& name, size_t writer_count, size_t sync_every_records) {
+			const double throughput = ingest(writer_count, sync_every_records);
+			report.Add("wal."s + name + ".documents_per_second"s, throughput, "documents/s"s);
+			report.Add("wal."s + name + ".slowdown"s, throughput > 0 ? memory_throughput / throughput : 0.0, "x"s);
+		};
+		add_mode("sync_each"s, 1, 1);
+		add_mode("sync_each_8_writers"s, 8, 1);
+		add_mode("sync_256"s, 1, 256);
+		add_mode("no_sync"s, 1, 0);
+		filesystem::remove_all(directory);
+	}
+
+	return report;
+}
+
+uint64_t GetProcessResidentBytes() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+		return counters.WorkingSetSize;
+	}
+	return 0;
+#else
+	ifstream statm("/proc/self/statm"s);
+	uint64_t total_pages = 0;
+	uint64_t resident_pages = 0;
+	if (!(statm >> total_pages >> resident_pages)) {
+		return 0;
+	}
+	return resident_pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "corpus_generator.h"
+
+struct BenchmarkOptions {
+	CorpusOptions corpus;
+	QueryLogOptions queries;
+	size_t stop_word_count = 0;
+	size_t ingest_batch_size = 10'000;
+	bool run_remove_duplicates = true;
+	bool run_corpus_loader = true;
+};
+
+struct BenchmarkMetric {
+	std::string name;
+	double value = 0.0;
+	std::string unit;
+};
+
+class BenchmarkReport {
+public:
+	void Add(std::string name, double value, std::string unit);
+	const std::vector<BenchmarkMetric>& GetMetrics() const;
+	const BenchmarkMetric* Find(const std::string& name) const;
+
+	void PrintText(std::ostream& os) const;
+	// Машиночитаемый отчёт для отслеживания регрессий
+	void PrintJson(std::ostream& os, const BenchmarkOptions& options) const;
+
+private:
+	std::vector<BenchmarkMetric> metrics_;
+};
+
+BenchmarkReport RunBenchmarks(const BenchmarkOptions& options, std::ostream& log = std::cerr);
+
+// Резидентная память процесса в байтах; 0, если платформа не поддерживается
+uint64_t GetProcessResidentBytes();
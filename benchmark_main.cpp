@@ -0,0 +1,77 @@
+#include "benchmark.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void PrintUsage() {
+	cerr << "Usage: Benchmark [--documents=N] [--vocabulary=N] [--queries=N] [--zipf=S] [--query-zipf=S]\n"s
+		<< "                 [--duplicates=F] [--stop-words=N] [--seed=N] [--no-remove-duplicates]\n"s
+		<< "                 [--no-loader] [--output=results.json]"s << endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	BenchmarkOptions options;
+	string output_path;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const string argument = argv[i];
+			const size_t equals = argument.find('=');
+			const string key = argument.substr(0, equals);
+			const string value = equals == string::npos ? ""s : argument.substr(equals + 1);
+
+			if (key == "--documents"s) {
+				options.corpus.document_count = stoull(value);
+			} else if (key == "--vocabulary"s) {
+				options.corpus.vocabulary_size = stoull(value);
+			} else if (key == "--queries"s) {
+				options.queries.query_count = stoull(value);
+			} else if (key == "--zipf"s) {
+				options.corpus.zipf_exponent = stod(value);
+			} else if (key == "--query-zipf"s) {
+				options.queries.zipf_exponent = stod(value);
+			} else if (key == "--duplicates"s) {
+				options.corpus.duplicate_fraction = stod(value);
+			} else if (key == "--stop-words"s) {
+				options.stop_word_count = stoull(value);
+			} else if (key == "--seed"s) {
+				options.corpus.seed = stoull(value);
+				options.queries.seed = options.corpus.seed + 1;
+			} else if (key == "--no-remove-duplicates"s) {
+				options.run_remove_duplicates = false;
+			} else if (key == "--no-loader"s) {
+				options.run_corpus_loader = false;
+			} else if (key == "--output"s) {
+				output_path = value;
+			} else {
+				PrintUsage();
+				return 1;
+			}
+		}
+	} catch (const exception& e) {
+		cerr << "Invalid argument: "s << e.what() << endl;
+		PrintUsage();
+		return 1;
+	}
+
+	const BenchmarkReport report = RunBenchmarks(options);
+	report.PrintText(cout);
+	if (!output_path.empty()) {
+		ofstream output(output_path);
+		if (!output) {
+			cerr << "Cannot open "s << output_path << endl;
+			return 1;
+		}
+		report.PrintJson(output, options);
+	}
+
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include "corpus_generator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace std;
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent)
+	: cumulative_(size)
+{
+	if (size == 0) {
+		throw invalid_argument("ZipfDistribution: size must be positive"s);
+	}
+
+	double sum = 0.0;
+	for (size_t rank = 0; rank < size; ++rank) {
+		sum += 1.0 / pow(static_cast<double>(rank + 1), exponent);
+		cumulative_[rank] = sum;
+	}
+	for (double& value : cumulative_) {
+		value /= sum;
+	}
+}
+
+size_t ZipfDistribution::operator()(mt19937_64& generator) const {
+	const double point = uniform_real_distribution<double>(0.0, 1.0)(generator);
+	const auto it = lower_bound(cumulative_.begin(), cumulative_.end(), point);
+
+	return min(static_cast<size_t>(it - cumulative_.begin()), cumulative_.size() - 1);
+}
+
+vector<string> GenerateVocabulary(mt19937_64& generator, size_t word_count) {
+	vector<string> words;
+	words.reserve(word_count);
+	unordered_set<string> unique_words;
+	// длины близки к естественным: короткие слова встречаются чаще длинных
+	binomial_distribution<int> length_distribution(14, 0.4);
+	uniform_int_distribution<int> letter_distribution('a', 'z');
+	while (words.size() < word_count) {
+		const int length = max(2, length_distribution(generator));
+		string word(length, ' ');
+		for (char& c : word) {
+			c = static_cast<char>(letter_distribution(generator));
+		}
+		if (unique_words.insert(word).second) {
+			words.push_back(move(word));
+		}
+	}
+
+	return words;
+}
+
+CorpusGenerator::CorpusGenerator(const CorpusOptions& options)
+	: options_(options)
+	, generator_(options.seed)
+	, vocabulary_(GenerateVocabulary(generator_, options.vocabulary_size))
+	, word_distribution_(options.vocabulary_size, options.zipf_exponent)
+{
+	if (options.min_document_words <= 0 || options.min_document_words > options.max_document_words) {
+		throw invalid_argument("CorpusGenerator: invalid document length range"s);
+	}
+}
+
+const vector<string>& CorpusGenerator::GetVocabulary() const {
+	return vocabulary_;
+}
+
+size_t CorpusGenerator::GetGeneratedCount() const {
+	return generated_count_;
+}
+
+bool CorpusGenerator::Next(GeneratedDocument& document) {
+	if (generated_count_ == options_.document_count) {
+		return false;
+	}
+
+	vector<size_t> ranks;
+	const bool is_duplicate = !recent_documents_.empty()
+		&& uniform_real_distribution<double>(0.0, 1.0)(generator_) < options_.duplicate_fraction;
+	if (is_duplicate) {
+		ranks = recent_documents_[uniform_int_distribution<size_t>(0, recent_documents_.size() - 1)(generator_)];
+		shuffle(ranks.begin(), ranks.end(), generator_);
+	} else {
+		const int word_count = uniform_int_distribution<int>(options_.min_document_words, options_.max_document_words)(generator_);
+		ranks.reserve(word_count);
+		for (int i = 0; i < word_count; ++i) {
+			ranks.push_back(word_distribution_(generator_));
+		}
+	}
+
+	document.id = static_cast<int>(generated_count_);
+	document.text.clear();
+	for (const size_t rank : ranks) {
+		if (!document.text.empty()) {
+			document.text.push_back(' ');
+		}
+		document.text += vocabulary_[rank];
+	}
+
+	const int status_roll = uniform_int_distribution<int>(0, 99)(generator_);
+	document.status = status_roll < 85 ? DocumentStatus::ACTUAL
+		: status_roll < 92 ? DocumentStatus::IRRELEVANT
+		: status_roll < 97 ? DocumentStatus::BANNED
+		: DocumentStatus::REMOVED;
+
+	document.ratings.resize(uniform_int_distribution<int>(1, 5)(generator_));
+	for (int& rating : document.ratings) {
+		rating = uniform_int_distribution<int>(-10, 10)(generator_);
+	}
+
+	if (recent_documents_.size() < RECENT_DOCUMENT_COUNT) {
+		recent_documents_.push_back(move(ranks));
+	} else {
+		recent_documents_[generated_count_ % RECENT_DOCUMENT_COUNT] = move(ranks);
+	}
+	++generated_count_;
+
+	return true;
+}
+
+vector<string> GenerateQueryLog(const vector<string>& vocabulary, const QueryLogOptions& options) {
+	if (options.min_query_words <= 0 || options.min_query_words > options.max_query_words) {
+		throw invalid_argument("GenerateQueryLog: invalid query length range"s);
+	}
+
+	mt19937_64 generator(options.seed);
+	const ZipfDistribution word_distribution(vocabulary.size(), options.zipf_exponent);
+	vector<string> queries;
+	queries.reserve(options.query_count);
+	for (size_t i = 0; i < options.query_count; ++i) {
+		const int word_count = uniform_int_distribution<int>(options.min_query_words, options.max_query_words)(generator);
+		string query;
+		for (int j = 0; j < word_count; ++j) {
+			if (!query.empty()) {
+				query.push_back(' ');
+			}
+			if (uniform_real_distribution<double>(0.0, 1.0)(generator) < options.minus_word_probability) {
+				query.push_back('-');
+			}
+			query += vocabulary[word_distribution(generator)];
+		}
+		queries.push_back(move(query));
+	}
+
+	return queries;
+}
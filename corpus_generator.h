@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "document.h"
+
+// Распределение Ципфа по рангам [0, size): вероятность ранга k пропорциональна 1 / (k + 1)^exponent
+class ZipfDistribution {
+public:
+	ZipfDistribution(size_t size, double exponent);
+
+	size_t operator()(std::mt19937_64& generator) const;
+
+private:
+	std::vector<double> cumulative_;
+};
+
+struct CorpusOptions {
+	size_t document_count = 10'000;
+	size_t vocabulary_size = 20'000;
+	double zipf_exponent = 1.0;
+	int min_document_words = 5;
+	int max_document_words = 40;
+	// доля документов, повторяющих набор слов одного из недавних документов
+	double duplicate_fraction = 0.01;
+	uint64_t seed = 42;
+};
+
+struct QueryLogOptions {
+	size_t query_count = 5'000;
+	double zipf_exponent = 1.0;
+	int min_query_words = 1;
+	int max_query_words = 5;
+	double minus_word_probability = 0.1;
+	uint64_t seed = 4242;
+};
+
+struct GeneratedDocument {
+	int id = 0;
+	std::string text;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+};
+
+// Детерминированный генератор корпуса: при одинаковых опциях выдаёт одинаковую
+// последовательность документов (в пределах одной стандартной библиотеки —
+// распределения <random> реализованы по-разному). Документы создаются по одному, поэтому корпус
+// любого размера не нужно держать в памяти целиком.
+class CorpusGenerator {
+public:
+	explicit CorpusGenerator(const CorpusOptions& options);
+
+	const std::vector<std::string>& GetVocabulary() const;
+	size_t GetGeneratedCount() const;
+
+	// false, когда все options.document_count документов уже выданы
+	bool Next(GeneratedDocument& document);
+
+private:
+	static constexpr size_t RECENT_DOCUMENT_COUNT = 1024;
+
+	CorpusOptions options_;
+	std::mt19937_64 generator_;
+	std::vector<std::string> vocabulary_;
+	ZipfDistribution word_distribution_;
+	std::vector<std::vector<size_t>> recent_documents_;
+	size_t generated_count_ = 0;
+};
+
+// Словарь из уникальных псевдослов; ранг слова совпадает с индексом
+std::vector<std::string> GenerateVocabulary(std::mt19937_64& generator, size_t word_count);
+std::vector<std::string> GenerateQueryLog(const std::vector<std::string>& vocabulary, const QueryLogOptions& options);
@@ -0,0 +1,625 @@
+#include "corpus_loader.h"
+
+#include <cctype>
+#include <charconv>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+struct ParsedDocument {
+	// номер строки внутри блока, с нуля
+	size_t line = 0;
+	bool has_id = false;
+	int id = 0;
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	vector<int> ratings;
+	vector<string_view> words;
+	string error;
+};
+
+struct Chunk {
+	size_t sequence = 0;
+	// слова документов указывают в text или в decoded, поэтому оба хранилища
+	// не должны перемещать символы при перемещении блока
+	unique_ptr<string> text;
+	deque<string> decoded;
+	vector<ParsedDocument> documents;
+	size_t line_count = 0;
+};
+
+string_view Trim(string_view text) {
+	while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r')) {
+		text.remove_prefix(1);
+	}
+	while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+		text.remove_suffix(1);
+	}
+	return text;
+}
+
+int ParseInt(string_view text) {
+	text = Trim(text);
+	if (!text.empty() && text.front() == '+') {
+		text.remove_prefix(1);
+	}
+	int value = 0;
+	const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+	if (text.empty() || error != errc() || end != text.data() + text.size()) {
+		throw invalid_argument("invalid integer '"s + string(text) + "'"s);
+	}
+	return value;
+}
+
+DocumentStatus ParseStatus(string_view text) {
+	text = Trim(text);
+	if (text.empty() || text == "ACTUAL"sv) {
+		return DocumentStatus::ACTUAL;
+	}
+	if (text == "IRRELEVANT"sv) {
+		return DocumentStatus::IRRELEVANT;
+	}
+	if (text == "BANNED"sv) {
+		return DocumentStatus::BANNED;
+	}
+	if (text == "REMOVED"sv) {
+		return DocumentStatus::REMOVED;
+	}
+	const int value = ParseInt(text);
+	if (value < static_cast<int>(DocumentStatus::ACTUAL) || value > static_cast<int>(DocumentStatus::REMOVED)) {
+		throw invalid_argument("invalid status '"s + string(text) + "'"s);
+	}
+	return static_cast<DocumentStatus>(value);
+}
+
+vector<int> ParseRatings(string_view text) {
+	vector<int> ratings;
+	while (!text.empty()) {
+		const size_t end = min(text.find_first_of(" ,"sv), text.size());
+		if (end > 0) {
+			ratings.push_back(ParseInt(text.substr(0, end)));
+		}
+		text.remove_prefix(min(end + 1, text.size()));
+	}
+	return ratings;
+}
+
+// Разбор одной строки JSON: поддерживается ровно то, что нужно для объекта документа,
+// значения неизвестных полей пропускаются целиком
+class JsonLineParser {
+public:
+	JsonLineParser(string_view line, deque<string>& decoded)
+		: line_(line)
+		, decoded_(decoded)
+	{
+	}
+
+	string_view Parse(const CorpusLoaderOptions& options, ParsedDocument& document) {
+		string_view text;
+		Expect('{');
+		SkipSpaces();
+		if (Peek() == '}') {
+			++pos_;
+		} else {
+			while (true) {
+				const string_view key = ParseString();
+				Expect(':');
+				SkipSpaces();
+				if (key == options.id_field && !options.id_field.empty()) {
+					document.id = ParseInt(ParseNumber());
+					document.has_id = true;
+				} else if (key == options.status_field) {
+					document.status = ParseStatus(Peek() == '"' ? ParseString() : ParseNumber());
+				} else if (key == options.ratings_field) {
+					document.ratings = ParseIntArray();
+				} else if (key == options.text_field) {
+					text = ParseString();
+				} else {
+					SkipValue();
+				}
+				SkipSpaces();
+				if (Peek() == ',') {
+					++pos_;
+					continue;
+				}
+				Expect('}');
+				break;
+			}
+		}
+		SkipSpaces();
+		if (pos_ != line_.size()) {
+			throw invalid_argument("unexpected characters after JSON object"s);
+		}
+		return text;
+	}
+
+private:
+	string_view line_;
+	deque<string>& decoded_;
+	size_t pos_ = 0;
+
+	char Peek() const {
+		if (pos_ >= line_.size()) {
+			throw invalid_argument("unexpected end of JSON line"s);
+		}
+		return line_[pos_];
+	}
+
+	void SkipSpaces() {
+		while (pos_ < line_.size() && (line_[pos_] == ' ' || line_[pos_] == '\t' || line_[pos_] == '\r')) {
+			++pos_;
+		}
+	}
+
+	void Expect(char c) {
+		SkipSpaces();
+		if (Peek() != c) {
+			throw invalid_argument("expected '"s + c + "' in JSON line"s);
+		}
+		++pos_;
+	}
+
+	string_view ParseNumber() {
+		const size_t begin = pos_;
+		while (pos_ < line_.size() && (isdigit(static_cast<unsigned char>(line_[pos_])) || line_[pos_] == '-' || line_[pos_] == '+'
+			|| line_[pos_] == '.' || line_[pos_] == 'e' || line_[pos_] == 'E')) {
+			++pos_;
+		}
+		if (begin == pos_) {
+			throw invalid_argument("expected a number in JSON line"s);
+		}
+		return line_.substr(begin, pos_ - begin);
+	}
+
+	vector<int> ParseIntArray() {
+		vector<int> values;
+		Expect('[');
+		SkipSpaces();
+		if (Peek() == ']') {
+			++pos_;
+			return values;
+		}
+		while (true) {
+			SkipSpaces();
+			values.push_back(ParseInt(ParseNumber()));
+			SkipSpaces();
+			if (Peek() == ',') {
+				++pos_;
+				continue;
+			}
+			Expect(']');
+			return values;
+		}
+	}
+
+	// Строка без escape-последовательностей возвращается как string_view на исходную строку.
+	// Управляющие пробельные символы (\n, \t, \r) заменяются пробелом: иначе сервер отверг бы документ
+	string_view ParseString() {
+		Expect('"');
+		const size_t begin = pos_;
+		while (pos_ < line_.size() && line_[pos_] != '"' && line_[pos_] != '\\') {
+			++pos_;
+		}
+		if (Peek() == '"') {
+			return line_.substr(begin, pos_++ - begin);
+		}
+
+		string& result = decoded_.emplace_back(line_.substr(begin, pos_ - begin));
+		while (Peek() != '"') {
+			const char c = line_[pos_++];
+			if (c != '\\') {
+				result += c;
+				continue;
+			}
+			const char escaped = Peek();
+			++pos_;
+			switch (escaped) {
+			case '"': case '\\': case '/':
+				result += escaped;
+				break;
+			case 'b': case 'f':
+				break;
+			case 'n': case 'r': case 't':
+				result += ' ';
+				break;
+			case 'u':
+				AppendUtf8(result, ParseCodePoint());
+				break;
+			default:
+				throw invalid_argument("invalid escape sequence in JSON string"s);
+			}
+		}
+		++pos_;
+		return result;
+	}
+
+	uint32_t ParseHex4() {
+		if (pos_ + 4 > line_.size()) {
+			throw invalid_argument("truncated \\u escape in JSON string"s);
+		}
+		uint32_t value = 0;
+		const auto [end, error] = from_chars(line_.data() + pos_, line_.data() + pos_ + 4, value, 16);
+		if (error != errc() || end != line_.data() + pos_ + 4) {
+			throw invalid_argument("invalid \\u escape in JSON string"s);
+		}
+		pos_ += 4;
+		return value;
+	}
+
+	uint32_t ParseCodePoint() {
+		const uint32_t high = ParseHex4();
+		if (high >= 0xD800 && high < 0xDC00 && line_.substr(pos_, 2) == "\\u"sv) {
+			pos_ += 2;
+			const uint32_t low = ParseHex4();
+			if (low >= 0xDC00 && low < 0xE000) {
+				return 0x10000 + ((high - 0xD800) << 10) + (low - 0xDC00);
+			}
+			throw invalid_argument("invalid surrogate pair in JSON string"s);
+		}
+		return high;
+	}
+
+	static void AppendUtf8(string& out, uint32_t code_point) {
+		if (code_point < ' ') {
+			out += ' ';
+		} else if (code_point < 0x80) {
+			out += static_cast<char>(code_point);
+		} else if (code_point < 0x800) {
+			out += static_cast<char>(0xC0 | (code_point >> 6));
+			out += static_cast<char>(0x80 | (code_point & 0x3F));
+		} else if (code_point < 0x10000) {
+			out += static_cast<char>(0xE0 | (code_point >> 12));
+			out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (code_point & 0x3F));
+		} else {
+			out += static_cast<char>(0xF0 | (code_point >> 18));
+			out += static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+			out += static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+			out += static_cast<char>(0x80 | (code_point & 0x3F));
+		}
+	}
+
+	void SkipValue() {
+		SkipSpaces();
+		const char c = Peek();
+		if (c == '"') {
+			ParseString();
+		} else if (c == '{' || c == '[') {
+			int depth = 0;
+			do {
+				const char current = Peek();
+				if (current == '"') {
+					ParseString();
+					continue;
+				}
+				if (current == '{' || current == '[') {
+					++depth;
+				} else if (current == '}' || current == ']') {
+					--depth;
+				}
+				++pos_;
+			} while (depth > 0);
+		} else {
+			while (pos_ < line_.size() && line_[pos_] != ',' && line_[pos_] != '}' && line_[pos_] != ' ') {
+				++pos_;
+			}
+		}
+	}
+};
+
+string_view ParseTsvLine(string_view line, ParsedDocument& document) {
+	size_t tabs[3];
+	size_t pos = 0;
+	for (size_t& tab : tabs) {
+		tab = line.find('\t', pos);
+		if (tab == string_view::npos) {
+			throw invalid_argument("expected 4 tab-separated fields: id, status, ratings, text"s);
+		}
+		pos = tab + 1;
+	}
+	const string_view id = Trim(line.substr(0, tabs[0]));
+	if (!id.empty()) {
+		document.id = ParseInt(id);
+		document.has_id = true;
+	}
+	document.status = ParseStatus(line.substr(tabs[0] + 1, tabs[1] - tabs[0] - 1));
+	document.ratings = ParseRatings(line.substr(tabs[1] + 1, tabs[2] - tabs[1] - 1));
+	return line.substr(tabs[2] + 1);
+}
+
+void ParseChunk(Chunk& chunk, const SearchServer& search_server, const CorpusLoaderOptions& options) {
+	const string_view text = *chunk.text;
+	size_t pos = 0;
+	while (pos < text.size()) {
+		const size_t end = min(text.find('\n', pos), text.size());
+		string_view line = text.substr(pos, end - pos);
+		pos = end + 1;
+		const size_t line_index = chunk.line_count++;
+		if (!line.empty() && line.back() == '\r') {
+			line.remove_suffix(1);
+		}
+		if (Trim(line).empty()) {
+			continue;
+		}
+
+		ParsedDocument& document = chunk.documents.emplace_back();
+		document.line = line_index;
+		try {
+			// декодированный JSON-текст живёт в chunk.decoded до индексации
+			const string_view document_text = options.format == CorpusFormat::TSV
+				? ParseTsvLine(line, document)
+				: JsonLineParser(line, chunk.decoded).Parse(options, document);
+			document.words = search_server.TokenizeDocument(document_text);
+		} catch (const invalid_argument& e) {
+			document.error = e.what();
+		}
+	}
+}
+
+// Состояние конвейера «чтение → разбор → индексация». Число блоков между чтением
+// и индексацией ограничено, поэтому медленная индексация притормаживает чтение
+struct Pipeline {
+	mutex state_mutex;
+	condition_variable reader_cv;
+	condition_variable worker_cv;
+	condition_variable indexer_cv;
+
+	deque<Chunk> raw_chunks;
+	map<size_t, Chunk> parsed_chunks;
+	size_t chunks_in_flight = 0;
+	size_t max_chunks_in_flight = 0;
+
+	bool input_done = false;
+	size_t chunk_count = 0;
+	size_t byte_count = 0;
+	bool stopped = false;
+	exception_ptr error;
+
+	void Fail(exception_ptr e) {
+		lock_guard guard(state_mutex);
+		if (!error) {
+			error = e;
+		}
+		stopped = true;
+		reader_cv.notify_all();
+		worker_cv.notify_all();
+		indexer_cv.notify_all();
+	}
+};
+
+void ReadChunks(istream& input, Pipeline& pipeline, size_t chunk_size) {
+	string carry;
+	size_t sequence = 0;
+	size_t byte_count = 0;
+	bool eof = false;
+	while (!eof) {
+		{
+			unique_lock lock(pipeline.state_mutex);
+			pipeline.reader_cv.wait(lock, [&pipeline] {
+				return pipeline.stopped || pipeline.chunks_in_flight < pipeline.max_chunks_in_flight;
+			});
+			if (pipeline.stopped) {
+				return;
+			}
+		}
+
+		auto text = make_unique<string>(move(carry));
+		carry.clear();
+		// дочитываем хотя бы до одного конца строки, даже если строка длиннее блока
+		size_t last_line_end = string::npos;
+		while (!eof && last_line_end == string::npos) {
+			const size_t old_size = text->size();
+			const size_t to_read = old_size < chunk_size ? chunk_size - old_size : chunk_size;
+			text->resize(old_size + to_read);
+			input.read(text->data() + old_size, static_cast<streamsize>(to_read));
+			const size_t read = static_cast<size_t>(input.gcount());
+			text->resize(old_size + read);
+			if (read < to_read) {
+				if (input.bad()) {
+					throw ios_base::failure("Failed to read corpus input"s);
+				}
+				eof = true;
+			}
+			for (size_t i = text->size(); i > old_size; --i) {
+				if ((*text)[i - 1] == '\n') {
+					last_line_end = i;
+					break;
+				}
+			}
+		}
+		if (!eof) {
+			carry.assign(*text, last_line_end, string::npos);
+			text->resize(last_line_end);
+		}
+		if (text->empty()) {
+			continue;
+		}
+
+		byte_count += text->size();
+		{
+			lock_guard guard(pipeline.state_mutex);
+			Chunk& chunk = pipeline.raw_chunks.emplace_back();
+			chunk.sequence = sequence++;
+			chunk.text = move(text);
+			++pipeline.chunks_in_flight;
+		}
+		pipeline.worker_cv.notify_one();
+	}
+
+	{
+		lock_guard guard(pipeline.state_mutex);
+		pipeline.input_done = true;
+		pipeline.chunk_count = sequence;
+		pipeline.byte_count = byte_count;
+	}
+	pipeline.worker_cv.notify_all();
+	pipeline.indexer_cv.notify_all();
+}
+
+void ParseChunks(const SearchServer& search_server, const CorpusLoaderOptions& options, Pipeline& pipeline) {
+	while (true) {
+		Chunk chunk;
+		{
+			unique_lock lock(pipeline.state_mutex);
+			pipeline.worker_cv.wait(lock, [&pipeline] {
+				return pipeline.stopped || pipeline.input_done || !pipeline.raw_chunks.empty();
+			});
+			if (pipeline.stopped || pipeline.raw_chunks.empty()) {
+				return;
+			}
+			chunk = move(pipeline.raw_chunks.front());
+			pipeline.raw_chunks.pop_front();
+		}
+
+		ParseChunk(chunk, search_server, options);
+
+		{
+			lock_guard guard(pipeline.state_mutex);
+			const size_t sequence = chunk.sequence;
+			pipeline.parsed_chunks.emplace(sequence, move(chunk));
+		}
+		pipeline.indexer_cv.notify_one();
+	}
+}
+
+// Останавливает и дожидается потоков конвейера при любом выходе из LoadCorpus
+class PipelineThreads {
+public:
+	explicit PipelineThreads(Pipeline& pipeline)
+		: pipeline_(pipeline)
+	{
+	}
+
+	~PipelineThreads() {
+		{
+			lock_guard guard(pipeline_.state_mutex);
+			pipeline_.stopped = true;
+		}
+		pipeline_.reader_cv.notify_all();
+		pipeline_.worker_cv.notify_all();
+		for (thread& worker : threads_) {
+			worker.join();
+		}
+	}
+
+	template <typename Function>
+	void Start(Function function) {
+		threads_.emplace_back([this, function] {
+			try {
+				function();
+			} catch (...) {
+				pipeline_.Fail(current_exception());
+			}
+		});
+	}
+
+private:
+	Pipeline& pipeline_;
+	vector<thread> threads_;
+};
+
+} // namespace
+
+CorpusLoadStats LoadCorpus(SearchServer& search_server, istream& input, const CorpusLoaderOptions& options) {
+	if (options.chunk_size == 0) {
+		throw invalid_argument("Corpus chunk size must be positive"s);
+	}
+	const auto start = chrono::steady_clock::now();
+	const size_t worker_count = options.worker_count > 0
+		? options.worker_count
+		: max<size_t>(1, thread::hardware_concurrency());
+
+	Pipeline pipeline;
+	pipeline.max_chunks_in_flight = options.max_chunks_in_flight > 0 ? options.max_chunks_in_flight : 2 * worker_count;
+
+	CorpusLoadStats stats;
+	{
+		PipelineThreads threads(pipeline);
+		threads.Start([&] {
+			ReadChunks(input, pipeline, options.chunk_size);
+		});
+		for (size_t i = 0; i < worker_count; ++i) {
+			threads.Start([&] {
+				ParseChunks(search_server, options, pipeline);
+			});
+		}
+
+		const auto reject = [&stats, &options](size_t line_number, const string& message) {
+			if (!options.skip_invalid_lines) {
+				throw invalid_argument("Corpus line "s + to_string(line_number) + ": "s + message);
+			}
+			++stats.skipped_line_count;
+		};
+
+		// индексация идёт строго в порядке блоков: порядок документов не зависит от числа потоков
+		size_t line_offset = 0;
+		int next_auto_id = 0;
+		for (size_t sequence = 0;; ++sequence) {
+			Chunk chunk;
+			{
+				unique_lock lock(pipeline.state_mutex);
+				pipeline.indexer_cv.wait(lock, [&pipeline, sequence] {
+					return pipeline.error || pipeline.parsed_chunks.count(sequence) > 0
+						|| (pipeline.input_done && sequence == pipeline.chunk_count);
+				});
+				if (pipeline.error) {
+					rethrow_exception(pipeline.error);
+				}
+				const auto it = pipeline.parsed_chunks.find(sequence);
+				if (it == pipeline.parsed_chunks.end()) {
+					stats.chunk_count = pipeline.chunk_count;
+					stats.byte_count = pipeline.byte_count;
+					break;
+				}
+				chunk = move(it->second);
+				pipeline.parsed_chunks.erase(it);
+			}
+
+			for (const ParsedDocument& document : chunk.documents) {
+				const size_t line_number = line_offset + document.line + 1;
+				if (!document.error.empty()) {
+					reject(line_number, document.error);
+					continue;
+				}
+				const int document_id = document.has_id ? document.id : next_auto_id++;
+				if (options.document_filter && !options.document_filter(document_id)) {
+					continue;
+				}
+				try {
+					search_server.AddTokenizedDocument(document_id, document.words, document.status, document.ratings);
+					++stats.document_count;
+				} catch (const invalid_argument& e) {
+					reject(line_number, e.what());
+				}
+			}
+			line_offset += chunk.line_count;
+
+			{
+				lock_guard guard(pipeline.state_mutex);
+				--pipeline.chunks_in_flight;
+			}
+			pipeline.reader_cv.notify_one();
+		}
+	}
+
+	stats.elapsed = chrono::steady_clock::now() - start;
+	return stats;
+}
+
+CorpusLoadStats LoadCorpusFile(SearchServer& search_server, const string& path, const CorpusLoaderOptions& options) {
+	ifstream input(path, ios::binary);
+	if (!input) {
+		throw invalid_argument("Cannot open corpus file "s + path);
+	}
+	return LoadCorpus(search_server, input, options);
+}
\ No newline at end of file
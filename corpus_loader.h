@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <istream>
+#include <string>
+
+#include "search_server.h"
+
+enum class CorpusFormat {
+	// id \t status \t ratings \t text; рейтинги через пробел или запятую, статус — имя или число
+	TSV,
+	// по одному JSON-объекту в строке: {"id": 1, "status": "ACTUAL", "ratings": [1, 2], "text": "..."}
+	JSON_LINES,
+};
+
+struct CorpusLoaderOptions {
+	CorpusFormat format = CorpusFormat::TSV;
+	// файл читается блоками такого размера, граница блока сдвигается к концу строки
+	size_t chunk_size = 4 << 20;
+	// 0 — по числу аппаратных потоков
+	size_t worker_count = 0;
+	// сколько блоков одновременно может находиться между чтением и индексацией; 0 — 2 * worker_count.
+	// Ограничивает память конвейера, когда индексация отстаёт от разбора
+	size_t max_chunks_in_flight = 0;
+	// false — первая ошибочная строка прерывает загрузку исключением invalid_argument
+	bool skip_invalid_lines = false;
+	// если задан, индексируются только документы, для которых он вернул true (например, документы одного шарда)
+	std::function<bool(int)> document_filter;
+
+	// имена полей JSON_LINES; при пустом или отсутствующем поле id документы нумеруются подряд с нуля
+	std::string id_field = "id";
+	std::string status_field = "status";
+	std::string ratings_field = "ratings";
+	std::string text_field = "text";
+};
+
+struct CorpusLoadStats {
+	size_t document_count = 0;
+	size_t skipped_line_count = 0;
+	size_t chunk_count = 0;
+	size_t byte_count = 0;
+	std::chrono::steady_clock::duration elapsed{};
+};
+
+// Потоковая загрузка корпуса: чтение блоков, параллельный разбор и токенизация
+// в worker_count потоках, индексация в вызывающем потоке в порядке строк файла.
+// Документы добавляются в том же порядке, что и при последовательном AddDocument
+CorpusLoadStats LoadCorpus(SearchServer& search_server, std::istream& input, const CorpusLoaderOptions& options = {});
+CorpusLoadStats LoadCorpusFile(SearchServer& search_server, const std::string& path, const CorpusLoaderOptions& options = {});
\ No newline at end of file
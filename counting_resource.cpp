@@ -0,0 +1,33 @@
+#include "counting_resource.h"
+
+using namespace std;
+
+CountingResource::CountingResource(pmr::memory_resource* upstream)
+	: upstream_(upstream)
+{
+}
+
+size_t CountingResource::GetAllocatedBytes() const {
+	return allocated_bytes_;
+}
+
+size_t CountingResource::GetAllocationCount() const {
+	return allocation_count_;
+}
+
+void* CountingResource::do_allocate(size_t bytes, size_t alignment) {
+	void* p = upstream_->allocate(bytes, alignment);
+	allocated_bytes_ += bytes;
+	++allocation_count_;
+	return p;
+}
+
+void CountingResource::do_deallocate(void* p, size_t bytes, size_t alignment) {
+	upstream_->deallocate(p, bytes, alignment);
+	allocated_bytes_ -= bytes;
+	--allocation_count_;
+}
+
+bool CountingResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+	return this == &other;
+}
\ No newline at end of file
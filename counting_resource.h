@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Передаёт выделения upstream и считает байты, которые сейчас выделены через неё.
+// Не потокобезопасна, как и монотонная арена, поверх которой обычно стоит
+class CountingResource : public std::pmr::memory_resource {
+public:
+	explicit CountingResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+
+	size_t GetAllocatedBytes() const;
+	size_t GetAllocationCount() const;
+
+private:
+	std::pmr::memory_resource* upstream_;
+	size_t allocated_bytes_ = 0;
+	size_t allocation_count_ = 0;
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "deletion_index.h"
+#include "string_processing.h"
+
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <tuple>
+#include <unordered_set>
+
+using namespace std;
+
+DeletionIndex::DeletionIndex(int max_distance)
+	: max_distance_(max_distance)
+{
+	if (max_distance < 1 || max_distance > 2) {
+		throw invalid_argument("DeletionIndex: max distance must be 1 or 2"s);
+	}
+}
+
+int DeletionIndex::GetMaxDistance() const {
+	return max_distance_;
+}
+
+size_t DeletionIndex::GetTermCount() const {
+	return term_count_;
+}
+
+size_t DeletionIndex::GetMemoryBytes() const {
+	// узел хранит элемент, указатель на следующий и хеш
+	constexpr size_t NODE_OVERHEAD = 2 * sizeof(void*);
+	size_t bytes = deletes_to_terms_.bucket_count() * sizeof(void*);
+	for (const auto& [_, terms] : deletes_to_terms_) {
+		bytes += sizeof(*deletes_to_terms_.begin()) + NODE_OVERHEAD + terms.capacity() * sizeof(string_view);
+	}
+	return bytes;
+}
+
+void DeletionIndex::AddTerm(string_view term) {
+	ForEachDelete(term, max_distance_, [this, term](size_t hash) {
+		auto& terms = deletes_to_terms_[hash];
+		if (terms.empty() || terms.back() != term) {
+			terms.push_back(term);
+		}
+	});
+	++term_count_;
+}
+
+void DeletionIndex::Clear() {
+	deletes_to_terms_.clear();
+	term_count_ = 0;
+}
+
+vector<DeletionIndex::TermDistance> DeletionIndex::FindTerms(string_view word) const {
+	vector<TermDistance> result;
+	if (max_distance_ == 0) {
+		return result;
+	}
+
+	unordered_set<string_view> checked;
+	ForEachDelete(word, max_distance_, [&](size_t hash) {
+		const auto it = deletes_to_terms_.find(hash);
+		if (it == deletes_to_terms_.end()) {
+			return;
+		}
+		for (const string_view term : it->second) {
+			if (!checked.insert(term).second) {
+				continue;
+			}
+			// совпадение хэшей не гарантирует совпадение удалений, поэтому расстояние считаем честно
+			const int distance = ComputeEditDistance(word, term, max_distance_);
+			if (distance <= max_distance_) {
+				result.push_back({ term, distance });
+			}
+		}
+	});
+	sort(result.begin(), result.end(),
+		[](const TermDistance& lhs, const TermDistance& rhs) {
+			return tie(lhs.distance, lhs.term) < tie(rhs.distance, rhs.term);
+		}
+	);
+
+	return result;
+}
+
+template <typename Callback>
+void DeletionIndex::ForEachDelete(string_view word, int max_distance, Callback callback) {
+	const hash<string_view> hasher;
+	unordered_set<string> level = { string(word) };
+	callback(hasher(word));
+	for (int distance = 1; distance <= max_distance; ++distance) {
+		unordered_set<string> next_level;
+		for (const string& variant : level) {
+			for (size_t i = 0; i < variant.size(); ++i) {
+				string shorter = variant.substr(0, i) + variant.substr(i + 1);
+				if (next_level.insert(shorter).second) {
+					callback(hasher(shorter));
+				}
+			}
+		}
+		level = move(next_level);
+	}
+}
\ No newline at end of file
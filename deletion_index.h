@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Индекс удалений (SymSpell): каждый термин словаря регистрируется под всеми
+// вариантами, полученными удалением до max_distance символов. Кандидаты для
+// слова с опечаткой ищутся по вариантам удалений самого слова, без обхода словаря.
+class DeletionIndex {
+public:
+	DeletionIndex() = default;
+	explicit DeletionIndex(int max_distance);
+
+	int GetMaxDistance() const;
+	size_t GetTermCount() const;
+	// Оценка занятой памяти: корзины и узлы хеш-таблицы, списки терминов
+	size_t GetMemoryBytes() const;
+
+	// Термин должен жить дольше индекса: хранится только string_view
+	void AddTerm(std::string_view term);
+	void Clear();
+
+	struct TermDistance {
+		std::string_view term;
+		int distance;
+	};
+
+	// Все термины на расстоянии не больше max_distance, ближайшие первыми
+	std::vector<TermDistance> FindTerms(std::string_view word) const;
+
+private:
+	int max_distance_ = 0;
+	size_t term_count_ = 0;
+	std::unordered_map<size_t, std::vector<std::string_view>> deletes_to_terms_;
+
+	template <typename Callback>
+	static void ForEachDelete(std::string_view word, int max_distance, Callback callback);
+};
\ No newline at end of file
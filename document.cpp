@@ -2,6 +2,6 @@
 
 Document::Document(int id, double relevance, int rating)
 	: id(id)
-	, relevance(relevance)
-	, rating(rating) 
+	, rating(rating)
+	, relevance(relevance) 
 {}
\ No newline at end of file
@@ -12,7 +12,8 @@ struct Document {
 
 	Document(int id, double relevance, int rating);
 
+	// id и rating рядом, чтобы структура занимала 16 байт без выравнивания
 	int    id        = 0;
-	double relevance = 0.0;
 	int    rating    = 0;
+	double relevance = 0.0;
 };
\ No newline at end of file
@@ -0,0 +1,293 @@
+#include "document_id_bitmap.h"
+
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+int CountBits(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_popcountll(bits);
+#else
+	int count = 0;
+	for (; bits != 0; bits &= bits - 1) {
+		++count;
+	}
+	return count;
+#endif
+}
+
+}
+
+void DocumentIdBitmap::Chunk::Set(uint16_t low) {
+	if (IsBitmap()) {
+		uint64_t& word = bits[low / 64];
+		const uint64_t mask = uint64_t(1) << (low % 64);
+		count += (word & mask) == 0 ? 1 : 0;
+		word |= mask;
+		return;
+	}
+	// id по возрастанию дописываются без поиска
+	const auto it = values.empty() || values.back() < low ? values.end() : lower_bound(values.begin(), values.end(), low);
+	if (it != values.end() && *it == low) {
+		return;
+	}
+	values.insert(it, low);
+	++count;
+	if (values.size() > MAX_ARRAY_SIZE) {
+		ConvertToBitmap();
+	}
+}
+
+void DocumentIdBitmap::Chunk::Reset(uint16_t low) {
+	if (IsBitmap()) {
+		uint64_t& word = bits[low / 64];
+		const uint64_t mask = uint64_t(1) << (low % 64);
+		count -= (word & mask) != 0 ? 1 : 0;
+		word &= ~mask;
+		// запас вдвое, чтобы чередование Set и Reset на границе не перестраивало блок каждый раз
+		if (count <= MAX_ARRAY_SIZE / 2) {
+			ConvertToArray();
+		}
+		return;
+	}
+	const auto it = lower_bound(values.begin(), values.end(), low);
+	if (it != values.end() && *it == low) {
+		values.erase(it);
+		--count;
+	}
+}
+
+void DocumentIdBitmap::Chunk::Intersect(const Chunk& other) {
+	if (IsBitmap() && other.IsBitmap()) {
+		for (size_t i = 0; i < CHUNK_WORDS; ++i) {
+			bits[i] &= other.bits[i];
+		}
+	} else if (!IsBitmap()) {
+		values.erase(remove_if(values.begin(), values.end(), [&other](uint16_t low) { return !other.Test(low); }), values.end());
+	} else {
+		vector<uint16_t> common;
+		copy_if(other.values.begin(), other.values.end(), back_inserter(common), [this](uint16_t low) { return Test(low); });
+		vector<uint64_t>().swap(bits);
+		values = move(common);
+	}
+	Normalize();
+}
+
+void DocumentIdBitmap::Chunk::Unite(const Chunk& other) {
+	if (other.IsBitmap()) {
+		if (!IsBitmap()) {
+			ConvertToBitmap();
+		}
+		for (size_t i = 0; i < CHUNK_WORDS; ++i) {
+			bits[i] |= other.bits[i];
+		}
+	} else if (IsBitmap()) {
+		for (const uint16_t low : other.values) {
+			bits[low / 64] |= uint64_t(1) << (low % 64);
+		}
+	} else {
+		vector<uint16_t> united;
+		united.reserve(values.size() + other.values.size());
+		set_union(values.begin(), values.end(), other.values.begin(), other.values.end(), back_inserter(united));
+		values = move(united);
+	}
+	Normalize();
+}
+
+void DocumentIdBitmap::Chunk::Subtract(const Chunk& other) {
+	if (IsBitmap() && other.IsBitmap()) {
+		for (size_t i = 0; i < CHUNK_WORDS; ++i) {
+			bits[i] &= ~other.bits[i];
+		}
+	} else if (IsBitmap()) {
+		for (const uint16_t low : other.values) {
+			bits[low / 64] &= ~(uint64_t(1) << (low % 64));
+		}
+	} else {
+		values.erase(remove_if(values.begin(), values.end(), [&other](uint16_t low) { return other.Test(low); }), values.end());
+	}
+	Normalize();
+}
+
+size_t DocumentIdBitmap::Chunk::CountIntersection(const Chunk& other) const {
+	if (IsBitmap() && other.IsBitmap()) {
+		size_t result = 0;
+		for (size_t i = 0; i < CHUNK_WORDS; ++i) {
+			result += CountBits(bits[i] & other.bits[i]);
+		}
+		return result;
+	}
+	// перебирается массив, проверяется другой блок
+	const Chunk& array = IsBitmap() ? other : *this;
+	const Chunk& probe = IsBitmap() ? *this : other;
+	return static_cast<size_t>(count_if(array.values.begin(), array.values.end(), [&probe](uint16_t low) { return probe.Test(low); }));
+}
+
+void DocumentIdBitmap::Chunk::Normalize() {
+	if (IsBitmap()) {
+		count = 0;
+		for (const uint64_t word : bits) {
+			count += CountBits(word);
+		}
+		if (count <= MAX_ARRAY_SIZE) {
+			ConvertToArray();
+		}
+	} else {
+		count = static_cast<uint32_t>(values.size());
+		if (count > MAX_ARRAY_SIZE) {
+			ConvertToBitmap();
+		}
+	}
+}
+
+void DocumentIdBitmap::Chunk::ConvertToBitmap() {
+	bits.assign(CHUNK_WORDS, 0);
+	for (const uint16_t low : values) {
+		bits[low / 64] |= uint64_t(1) << (low % 64);
+	}
+	vector<uint16_t>().swap(values);
+}
+
+void DocumentIdBitmap::Chunk::ConvertToArray() {
+	vector<uint16_t> result;
+	result.reserve(count);
+	for (size_t word = 0; word < bits.size(); ++word) {
+		for (uint64_t word_bits = bits[word]; word_bits != 0; word_bits &= word_bits - 1) {
+			result.push_back(static_cast<uint16_t>(word * 64 + CountTrailingZeros(word_bits)));
+		}
+	}
+	vector<uint64_t>().swap(bits);
+	values = move(result);
+}
+
+void DocumentIdBitmap::Set(int document_id) {
+	if (document_id < 0) {
+		throw invalid_argument("DocumentIdBitmap: negative document id"s);
+	}
+	const uint32_t key = static_cast<uint32_t>(document_id) >> CHUNK_BITS;
+	auto it = !chunks_.empty() && chunks_.back().key <= key ? chunks_.end() - 1 : lower_bound(chunks_.begin(), chunks_.end(), key, [](const Chunk& chunk, uint32_t value) {
+		return chunk.key < value;
+	});
+	if (it != chunks_.end() && it->key < key) {
+		++it;
+	}
+	if (it == chunks_.end() || it->key != key) {
+		it = chunks_.insert(it, Chunk{});
+		it->key = key;
+	}
+	it->Set(static_cast<uint16_t>(document_id));
+}
+
+void DocumentIdBitmap::Reset(int document_id) {
+	if (document_id < 0) {
+		return;
+	}
+	const uint32_t key = static_cast<uint32_t>(document_id) >> CHUNK_BITS;
+	const auto it = lower_bound(chunks_.begin(), chunks_.end(), key, [](const Chunk& chunk, uint32_t value) {
+		return chunk.key < value;
+	});
+	if (it != chunks_.end() && it->key == key) {
+		it->Reset(static_cast<uint16_t>(document_id));
+		if (it->count == 0) {
+			chunks_.erase(it);
+		}
+	}
+}
+
+bool DocumentIdBitmap::IsEmpty() const {
+	return chunks_.empty();
+}
+
+size_t DocumentIdBitmap::Count() const {
+	size_t count = 0;
+	for (const Chunk& chunk : chunks_) {
+		count += chunk.count;
+	}
+	return count;
+}
+
+void DocumentIdBitmap::Clear() {
+	chunks_.clear();
+}
+
+size_t DocumentIdBitmap::GetMemoryBytes() const {
+	size_t bytes = chunks_.capacity() * sizeof(Chunk);
+	for (const Chunk& chunk : chunks_) {
+		bytes += chunk.values.capacity() * sizeof(uint16_t) + chunk.bits.capacity() * sizeof(uint64_t);
+	}
+	return bytes;
+}
+
+DocumentIdBitmap& DocumentIdBitmap::operator&=(const DocumentIdBitmap& other) {
+	for (Chunk& chunk : chunks_) {
+		if (const Chunk* other_chunk = other.FindChunk(chunk.key)) {
+			chunk.Intersect(*other_chunk);
+		} else {
+			chunk.count = 0;
+		}
+	}
+	EraseEmptyChunks();
+	return *this;
+}
+
+DocumentIdBitmap& DocumentIdBitmap::operator|=(const DocumentIdBitmap& other) {
+	// слияние списков блоков по key
+	vector<Chunk> united;
+	united.reserve(chunks_.size() + other.chunks_.size());
+	auto it = chunks_.begin();
+	for (const Chunk& other_chunk : other.chunks_) {
+		for (; it != chunks_.end() && it->key < other_chunk.key; ++it) {
+			united.push_back(move(*it));
+		}
+		if (it != chunks_.end() && it->key == other_chunk.key) {
+			it->Unite(other_chunk);
+			united.push_back(move(*it++));
+		} else {
+			united.push_back(other_chunk);
+		}
+	}
+	move(it, chunks_.end(), back_inserter(united));
+	chunks_ = move(united);
+	return *this;
+}
+
+DocumentIdBitmap& DocumentIdBitmap::operator-=(const DocumentIdBitmap& other) {
+	for (Chunk& chunk : chunks_) {
+		if (const Chunk* other_chunk = other.FindChunk(chunk.key)) {
+			chunk.Subtract(*other_chunk);
+		}
+	}
+	EraseEmptyChunks();
+	return *this;
+}
+
+size_t DocumentIdBitmap::CountIntersection(const DocumentIdBitmap& other) const {
+	size_t count = 0;
+	for (const Chunk& chunk : chunks_) {
+		if (const Chunk* other_chunk = other.FindChunk(chunk.key)) {
+			count += chunk.CountIntersection(*other_chunk);
+		}
+	}
+	return count;
+}
+
+void DocumentIdBitmap::EraseEmptyChunks() {
+	chunks_.erase(remove_if(chunks_.begin(), chunks_.end(), [](const Chunk& chunk) { return chunk.count == 0; }), chunks_.end());
+}
+
+int DocumentIdBitmap::CountTrailingZeros(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(bits);
+#else
+	int count = 0;
+	while ((bits & 1) == 0) {
+		bits >>= 1;
+		++count;
+	}
+	return count;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Множество неотрицательных id документов в духе roaring bitmap: id делятся на блоки
+// по 2^16, блок хранит отсортированный массив младших 16 бит id, пока их не больше
+// MAX_ARRAY_SIZE, и bitmap на 8 КБ после. Память пропорциональна числу id, а не
+// наибольшему id, поэтому единичный документ с id около 2^31 не раздувает множество
+class DocumentIdBitmap {
+public:
+	void Set(int document_id);
+	void Reset(int document_id);
+	// отрицательные id считаются отсутствующими
+	bool Test(int document_id) const {
+		if (document_id < 0) {
+			return false;
+		}
+		const Chunk* chunk = FindChunk(static_cast<uint32_t>(document_id) >> CHUNK_BITS);
+		return chunk != nullptr && chunk->Test(static_cast<uint16_t>(document_id));
+	}
+
+	bool IsEmpty() const;
+	size_t Count() const;
+	void Clear();
+	// Байты, занятые блоками
+	size_t GetMemoryBytes() const;
+
+	// Пересечение, объединение и разность на месте; bitmap-блоки обрабатываются по 64 id за операцию
+	DocumentIdBitmap& operator&=(const DocumentIdBitmap& other);
+	DocumentIdBitmap& operator|=(const DocumentIdBitmap& other);
+	DocumentIdBitmap& operator-=(const DocumentIdBitmap& other);
+	// Размер пересечения без построения его bitmap'а
+	size_t CountIntersection(const DocumentIdBitmap& other) const;
+
+	// Вызывает action(document_id) для всех id по возрастанию
+	template <typename Action>
+	void ForEach(Action action) const {
+		for (const Chunk& chunk : chunks_) {
+			const int base = static_cast<int>(chunk.key << CHUNK_BITS);
+			if (!chunk.IsBitmap()) {
+				for (const uint16_t low : chunk.values) {
+					action(base | low);
+				}
+				continue;
+			}
+			for (size_t word = 0; word < chunk.bits.size(); ++word) {
+				for (uint64_t bits = chunk.bits[word]; bits != 0; bits &= bits - 1) {
+					action(base | static_cast<int>(word * 64 + CountTrailingZeros(bits)));
+				}
+			}
+		}
+	}
+
+private:
+	static constexpr uint32_t CHUNK_BITS = 16;
+	static constexpr size_t CHUNK_WORDS = (size_t(1) << CHUNK_BITS) / 64;
+	// массив из стольких uint16_t занимает столько же, сколько bitmap блока
+	static constexpr size_t MAX_ARRAY_SIZE = 4096;
+
+	struct Chunk {
+		uint32_t key = 0;
+		uint32_t count = 0;
+		// младшие 16 бит id по возрастанию; пусто, если блок хранится bitmap'ом
+		std::vector<uint16_t> values;
+		std::vector<uint64_t> bits;
+
+		bool IsBitmap() const {
+			return !bits.empty();
+		}
+		bool Test(uint16_t low) const {
+			if (IsBitmap()) {
+				return (bits[low / 64] >> (low % 64) & 1) != 0;
+			}
+			return std::binary_search(values.begin(), values.end(), low);
+		}
+
+		void Set(uint16_t low);
+		void Reset(uint16_t low);
+		void Intersect(const Chunk& other);
+		void Unite(const Chunk& other);
+		void Subtract(const Chunk& other);
+		size_t CountIntersection(const Chunk& other) const;
+		// Пересчитывает count и выбирает представление по нему
+		void Normalize();
+		void ConvertToBitmap();
+		void ConvertToArray();
+	};
+
+	// по возрастанию key, пустых блоков нет
+	std::vector<Chunk> chunks_;
+
+	const Chunk* FindChunk(uint32_t key) const {
+		// у плотных id, начинающихся с нуля, блок key лежит на месте key
+		if (key < chunks_.size() && chunks_[key].key == key) {
+			return &chunks_[key];
+		}
+		const auto it = std::lower_bound(chunks_.begin(), chunks_.end(), key, [](const Chunk& chunk, uint32_t value) {
+			return chunk.key < value;
+		});
+		return it != chunks_.end() && it->key == key ? &*it : nullptr;
+	}
+	void EraseEmptyChunks();
+
+	static int CountTrailingZeros(uint64_t bits);
+};
\ No newline at end of file
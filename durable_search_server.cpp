@@ -0,0 +1,233 @@
+#include "durable_search_server.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const string SNAPSHOT_PREFIX = "snapshot."s;
+const string SNAPSHOT_SUFFIX = ".tsv"s;
+const string LOG_PREFIX = "wal."s;
+const string LOG_SUFFIX = ".log"s;
+const string TEMPORARY_SUFFIX = ".tmp"s;
+
+// Поколение из имени вида <prefix><G><suffix>; nullopt — имя другого вида
+optional<uint64_t> ParseGeneration(const string& name, const string& prefix, const string& suffix) {
+	if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0
+		|| name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+		return nullopt;
+	}
+	const string digits = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+	if (digits.find_first_not_of("0123456789"s) != string::npos) {
+		return nullopt;
+	}
+	return stoull(digits);
+}
+
+// fsync файла или, кроме Windows, каталога: без него переименование может не пережить сбой ОС
+void SyncPath(const string& path, bool is_directory) {
+#ifdef _WIN32
+	if (is_directory) {
+		return;
+	}
+	const int descriptor = _open(path.c_str(), _O_RDWR | _O_BINARY);
+	const bool succeeded = descriptor >= 0 && _commit(descriptor) == 0;
+	if (descriptor >= 0) {
+		_close(descriptor);
+	}
+#else
+	const int descriptor = open(path.c_str(), (is_directory ? O_RDONLY : O_RDWR) | O_CLOEXEC);
+	const bool succeeded = descriptor >= 0 && fsync(descriptor) == 0;
+	if (descriptor >= 0) {
+		close(descriptor);
+	}
+#endif
+	if (!succeeded) {
+		throw runtime_error("Cannot sync "s + path);
+	}
+}
+
+void ApplyRecord(SearchServer& search_server, const LogRecord& record) {
+	if (record.type == LogRecordType::ADD_DOCUMENT) {
+		search_server.AddDocument(record.document_id, record.text, record.status, record.ratings);
+	} else {
+		search_server.RemoveDocument(record.document_id);
+	}
+}
+
+}
+
+DurableSearchServer::DurableSearchServer(SearchServer& search_server, const string& directory, const DurableSearchServerOptions& options)
+	: search_server_(search_server)
+	, directory_(directory)
+	, options_(options)
+{
+	options_.snapshot_loader.format = CorpusFormat::TSV;
+	options_.snapshot_loader.skip_invalid_lines = false;
+	Recover();
+}
+
+void DurableSearchServer::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+	shared_ptr<WriteAheadLog> log;
+	uint64_t sequence = 0;
+	{
+		lock_guard guard(mutex_);
+		search_server_.AddDocument(document_id, document, status, ratings);
+		log = log_;
+		try {
+			sequence = log->Enqueue({ LogRecordType::ADD_DOCUMENT, document_id, status, ratings, document });
+		} catch (...) {
+			// отказавший журнал или слишком длинная запись: индекс не должен расходиться с тем, что восстановится
+			search_server_.RemoveDocument(document_id);
+			throw;
+		}
+	}
+	log->WaitDurable(sequence);
+}
+
+void DurableSearchServer::RemoveDocument(int document_id) {
+	shared_ptr<WriteAheadLog> log;
+	uint64_t sequence = 0;
+	{
+		lock_guard guard(mutex_);
+		log = log_;
+		sequence = log->Enqueue({ LogRecordType::REMOVE_DOCUMENT, document_id, DocumentStatus::ACTUAL, {}, {} });
+		search_server_.RemoveDocument(document_id);
+	}
+	log->WaitDurable(sequence);
+}
+
+void DurableSearchServer::Sync() {
+	lock_guard guard(mutex_);
+	log_->Sync();
+}
+
+void DurableSearchServer::Checkpoint() {
+	lock_guard guard(mutex_);
+	// после Sync писатели, ждущие старый журнал, возвращаются сразу
+	log_->Sync();
+	WriteNextSnapshot();
+	const uint64_t old_generation = generation_++;
+	log_ = make_shared<WriteAheadLog>(GetLogPath(generation_), options_.log);
+	SyncPath(directory_, true);
+
+	filesystem::remove(GetSnapshotPath(old_generation));
+	// старый журнал может быть ещё открыт ждущим писателем, и Windows не даст его удалить;
+	// тогда его удалит следующее восстановление
+	error_code error;
+	filesystem::remove(GetLogPath(old_generation), error);
+}
+
+const RecoveryStats& DurableSearchServer::GetRecoveryStats() const {
+	return recovery_stats_;
+}
+
+uint64_t DurableSearchServer::GetGeneration() const {
+	return generation_;
+}
+
+const WriteAheadLog& DurableSearchServer::GetLog() const {
+	return *log_;
+}
+
+string DurableSearchServer::GetSnapshotPath(uint64_t generation) const {
+	return (filesystem::path(directory_) / (SNAPSHOT_PREFIX + to_string(generation) + SNAPSHOT_SUFFIX)).string();
+}
+
+string DurableSearchServer::GetLogPath(uint64_t generation) const {
+	return (filesystem::path(directory_) / (LOG_PREFIX + to_string(generation) + LOG_SUFFIX)).string();
+}
+
+void DurableSearchServer::Recover() {
+	filesystem::create_directories(directory_);
+	for (const auto& entry : filesystem::directory_iterator(directory_)) {
+		if (const auto generation = ParseGeneration(entry.path().filename().string(), SNAPSHOT_PREFIX, SNAPSHOT_SUFFIX)) {
+			generation_ = max(generation_, *generation);
+		}
+	}
+	// остатки прерванных контрольных точек и пары предыдущих поколений
+	for (const auto& entry : filesystem::directory_iterator(directory_)) {
+		const string name = entry.path().filename().string();
+		const auto snapshot_generation = ParseGeneration(name, SNAPSHOT_PREFIX, SNAPSHOT_SUFFIX);
+		const auto log_generation = ParseGeneration(name, LOG_PREFIX, LOG_SUFFIX);
+		const bool is_temporary = name.size() > TEMPORARY_SUFFIX.size()
+			&& name.compare(name.size() - TEMPORARY_SUFFIX.size(), TEMPORARY_SUFFIX.size(), TEMPORARY_SUFFIX) == 0;
+		if (is_temporary || (snapshot_generation && *snapshot_generation != generation_) || (log_generation && *log_generation != generation_)) {
+			filesystem::remove(entry.path());
+		}
+	}
+
+	recovery_stats_.generation = generation_;
+	const string snapshot_path = GetSnapshotPath(generation_);
+	if (filesystem::exists(snapshot_path)) {
+		recovery_stats_.snapshot_document_count = LoadCorpusFile(search_server_, snapshot_path, options_.snapshot_loader).document_count;
+	}
+
+	const string log_path = GetLogPath(generation_);
+	recovery_stats_.log = WriteAheadLog::Replay(log_path, [this](const LogRecord& record) {
+		ApplyRecord(search_server_, record);
+	});
+	if (recovery_stats_.log.discarded_bytes > 0) {
+		// новые записи не должны оказаться за мусором, который следующее восстановление отбросит вместе с ними
+		filesystem::resize_file(log_path, recovery_stats_.log.valid_bytes);
+	}
+	log_ = make_shared<WriteAheadLog>(log_path, options_.log);
+	if (recovery_stats_.log.discarded_bytes > 0) {
+		log_->Sync();
+	}
+}
+
+void DurableSearchServer::WriteNextSnapshot() {
+	// последнее изменение каждого документа из журнала: номер записи и было ли это добавление
+	map<int, pair<size_t, bool>> last_changes;
+	size_t record_index = 0;
+	WriteAheadLog::Replay(log_->GetPath(), [&](const LogRecord& record) {
+		last_changes[record.document_id] = { record_index++, record.type == LogRecordType::ADD_DOCUMENT };
+	});
+
+	const string temporary_path = GetSnapshotPath(generation_ + 1) + TEMPORARY_SUFFIX;
+	{
+		ofstream output(temporary_path, ios::binary | ios::trunc);
+		ifstream input(GetSnapshotPath(generation_), ios::binary);
+		string line;
+		while (getline(input, line)) {
+			const size_t tab = line.find('\t');
+			if (tab == string::npos || last_changes.count(stoi(line.substr(0, tab))) > 0) {
+				continue;
+			}
+			output << line << '\n';
+		}
+
+		record_index = 0;
+		WriteAheadLog::Replay(log_->GetPath(), [&](const LogRecord& record) {
+			const auto& [last_index, is_add] = last_changes.at(record.document_id);
+			if (record_index++ != last_index || !is_add) {
+				return;
+			}
+			output << record.document_id << '\t' << static_cast<int>(record.status) << '\t';
+			for (size_t i = 0; i < record.ratings.size(); ++i) {
+				output << (i > 0 ? " "s : ""s) << record.ratings[i];
+			}
+			output << '\t' << record.text << '\n';
+		});
+		if (!output.flush()) {
+			throw runtime_error("Cannot write snapshot "s + temporary_path);
+		}
+	}
+	SyncPath(temporary_path, false);
+	filesystem::rename(temporary_path, GetSnapshotPath(generation_ + 1));
+}
\ No newline at end of file
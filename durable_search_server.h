@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "corpus_loader.h"
+#include "search_server.h"
+#include "write_ahead_log.h"
+
+struct DurableSearchServerOptions {
+	WriteAheadLogOptions log;
+	// снимок загружается LoadCorpusFile; format игнорируется, снимок всегда TSV
+	CorpusLoaderOptions snapshot_loader;
+};
+
+struct RecoveryStats {
+	uint64_t generation = 0;
+	size_t snapshot_document_count = 0;
+	LogReplayStats log;
+};
+
+// Изменения индекса, переживающие перезапуск процесса. Каталог хранит снимок snapshot.<G>.tsv
+// (корпус в формате TSV загрузчика) и журнал wal.<G>.log изменений после него. При открытии
+// снимок загружается в пустой search_server, журнал проигрывается поверх, а недописанный или
+// повреждённый хвост журнала отрезается. Checkpoint записывает снимок G + 1 из снимка и журнала G
+// и начинает пустой журнал; переименование снимка атомарно, поэтому падение в любой момент
+// оставляет либо старую пару, либо новую.
+// Изменения сериализуются между собой; запросы к search_server во время изменений, как и для
+// самого SearchServer, недопустимы. Документ применяется к индексу до записи в журнал, так что
+// некорректный документ в журнал не попадает, а если журнал его не принял, документ удаляется
+// из индекса. Удаление, наоборот, сначала ставится в журнал: отменить его было бы нечем
+class DurableSearchServer {
+public:
+	DurableSearchServer(SearchServer& search_server, const std::string& directory, const DurableSearchServerOptions& options = {});
+
+	// Возвращаются, когда изменение записано в журнал с гарантией options.log.sync_every_records.
+	// Ожидание fsync идёт без блокировки индекса, поэтому изменения потоков группируются
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	void RemoveDocument(int document_id);
+
+	void Sync();
+	void Checkpoint();
+
+	const RecoveryStats& GetRecoveryStats() const;
+	uint64_t GetGeneration() const;
+	// Журнал текущего поколения; Checkpoint заменяет его, поэтому одновременно с ним вызывать нельзя
+	const WriteAheadLog& GetLog() const;
+
+private:
+	SearchServer& search_server_;
+	std::string directory_;
+	DurableSearchServerOptions options_;
+	RecoveryStats recovery_stats_;
+
+	std::mutex mutex_;
+	uint64_t generation_ = 0;
+	// Писатель копирует указатель вместе с номером записи и ждёт fsync на этой копии без
+	// блокировки: Checkpoint может тем временем заменить журнал, но старый живёт до последнего ожидающего
+	std::shared_ptr<WriteAheadLog> log_;
+
+	std::string GetSnapshotPath(uint64_t generation) const;
+	std::string GetLogPath(uint64_t generation) const;
+	void Recover();
+	// Снимок generation + 1: строки старого снимка без документов, изменённых журналом, и последние
+	// добавления из журнала. Пишется во временный файл, синхронизируется и переименовывается
+	void WriteNextSnapshot();
+};
\ No newline at end of file
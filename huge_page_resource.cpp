@@ -0,0 +1,39 @@
+#include "huge_page_resource.h"
+
+#include <algorithm>
+#include <new>
+
+#ifdef __linux__
+#include <cstdlib>
+#include <sys/mman.h>
+#endif
+
+using namespace std;
+
+void* HugePageResource::do_allocate(size_t bytes, size_t alignment) {
+#ifdef __linux__
+	// размер кратен большой странице, иначе ядро не сможет отобразить хвост блока
+	const size_t size = (max<size_t>(bytes, 1) + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	void* p = aligned_alloc(max(alignment, HUGE_PAGE_SIZE), size);
+	if (p == nullptr) {
+		throw bad_alloc();
+	}
+	// отказ madvise не ошибка: память остаётся обычной
+	madvise(p, size, MADV_HUGEPAGE);
+	return p;
+#else
+	return ::operator new(bytes, align_val_t(alignment));
+#endif
+}
+
+void HugePageResource::do_deallocate(void* p, [[maybe_unused]] size_t bytes, [[maybe_unused]] size_t alignment) {
+#ifdef __linux__
+	free(p);
+#else
+	::operator delete(p, bytes, align_val_t(alignment));
+#endif
+}
+
+bool HugePageResource::do_is_equal(const pmr::memory_resource& other) const noexcept {
+	return this == &other;
+}
\ No newline at end of file
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Источник крупных блоков для арены индекса. На Linux блоки выравниваются по 2 МБ и
+// помечаются madvise(MADV_HUGEPAGE), чтобы ядро отдало их прозрачными большими
+// страницами и обход индекса реже промахивался мимо TLB. На других системах и при
+// отключённых huge pages память выделяется обычным operator new
+class HugePageResource : public std::pmr::memory_resource {
+public:
+	static constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
\ No newline at end of file
@@ -7,35 +7,63 @@
 using namespace std;
 
 vector<vector<Document>> ProcessQueries(const SearchServer& search_server, const vector<string>& queries) {
-	vector<vector<Document>> result(queries.size());
+	vector<vector<Document>> result;
+	ProcessQueriesInto(search_server, queries, result);
 
-	transform(
+	return result;
+}
+
+vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries) {
+	vector<vector<Document>> documents_lists;
+	vector<Document> result;
+	ProcessQueriesJoinedInto(search_server, queries, documents_lists, result);
+
+	return result;
+}
+
+void ProcessQueriesInto(const SearchServer& search_server, const vector<string>& queries, vector<vector<Document>>& result) {
+	result.resize(queries.size());
+
+	for_each(
 		execution::par,
 		queries.begin(),
 		queries.end(),
-		result.begin(),
-		[&search_server](const string& item) {
-			return search_server.FindTopDocuments(item);
+		[&search_server, &queries, &result](const string& item) {
+			search_server.FillTopDocuments(item, result[&item - queries.data()]);
 		}
 	);
+}
 
-	return result;
+void ProcessQueriesInto(AdmissionController& controller, const vector<string>& queries, vector<vector<Document>>& result, vector<AdmissionDecision>* decisions) {
+	result.resize(queries.size());
+	if (decisions != nullptr) {
+		decisions->assign(queries.size(), AdmissionDecision::REJECTED);
+	}
+
+	for_each(
+		execution::par,
+		queries.begin(),
+		queries.end(),
+		[&controller, &queries, &result, decisions](const string& item) {
+			const size_t index = &item - queries.data();
+			const AdmissionDecision decision = controller.FillTopDocuments(item, DocumentStatus::ACTUAL, QueryMode::ANY, result[index]);
+			if (decisions != nullptr) {
+				(*decisions)[index] = decision;
+			}
+		}
+	);
 }
 
-vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const vector<string>& queries) {
-	vector<Document> result;
+void ProcessQueriesJoinedInto(const SearchServer& search_server, const vector<string>& queries, vector<vector<Document>>& documents_lists, vector<Document>& result) {
+	ProcessQueriesInto(search_server, queries, documents_lists);
 
-	auto tmp = ProcessQueries(search_server, queries);
 	size_t sz = 0;
-	for (const auto& elem : tmp) {
+	for (const auto& elem : documents_lists) {
 		sz += elem.size();
 	}
+	result.clear();
 	result.reserve(sz);
-	for (auto& vec_doc : tmp) {
-		for (auto& doc : vec_doc) {
-			result.push_back(move(doc));
-		}
+	for (const auto& vec_doc : documents_lists) {
+		result.insert(result.end(), vec_doc.begin(), vec_doc.end());
 	}
-
-	return result;
 }
\ No newline at end of file
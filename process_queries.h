@@ -2,9 +2,21 @@
 
 #include <vector>
 
+#include "admission_controller.h"
 #include "search_server.h"
 #include "document.h"
 
 
 std::vector<std::vector<Document>> ProcessQueries(const SearchServer& search_server, const std::vector<std::string>& queries);
-std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
\ No newline at end of file
+std::vector<Document> ProcessQueriesJoined(const SearchServer& search_server, const std::vector<std::string>& queries);
+
+// Перегрузки с буферами результата: внутренние векторы переиспользуются между вызовами.
+// documents_lists — рабочий буфер объединяемых результатов, им тоже владеет вызывающий
+void ProcessQueriesInto(const SearchServer& search_server, const std::vector<std::string>& queries, std::vector<std::vector<Document>>& result);
+void ProcessQueriesJoinedInto(const SearchServer& search_server, const std::vector<std::string>& queries,
+	std::vector<std::vector<Document>>& documents_lists, std::vector<Document>& result);
+
+// Пакет через контроль допуска: каждый запрос проходит controller, отвергнутый даёт пустой результат.
+// decisions, если задан, получает решение по каждому запросу
+void ProcessQueriesInto(AdmissionController& controller, const std::vector<std::string>& queries, std::vector<std::vector<Document>>& result,
+	std::vector<AdmissionDecision>* decisions = nullptr);
\ No newline at end of file
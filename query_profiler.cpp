@@ -0,0 +1,291 @@
+#include "query_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+
+using namespace std;
+
+namespace {
+
+struct ThreadStageHistograms {
+	array<array<atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT>, QUERY_STAGE_COUNT> buckets{};
+};
+
+// Замеры завершившегося потока сливаются в общий итог, а его гистограммы освобождаются:
+// иначе короткоживущие потоки (соединения шардов, исполнители запросов) копили бы память без предела
+struct ProfileRegistry {
+	mutex registry_mutex;
+	vector<ThreadStageHistograms*> threads;
+	array<array<uint64_t, LatencyHistogram::BUCKET_COUNT>, QUERY_STAGE_COUNT> retired{};
+};
+
+ProfileRegistry& GetProfileRegistry() {
+	static ProfileRegistry registry;
+	return registry;
+}
+
+class ThreadHistogramsOwner {
+public:
+	ThreadHistogramsOwner()
+		: registry_(GetProfileRegistry())
+	{
+		lock_guard guard(registry_.registry_mutex);
+		registry_.threads.push_back(&histograms_);
+	}
+
+	ThreadHistogramsOwner(const ThreadHistogramsOwner&) = delete;
+	ThreadHistogramsOwner& operator=(const ThreadHistogramsOwner&) = delete;
+
+	~ThreadHistogramsOwner() {
+		lock_guard guard(registry_.registry_mutex);
+		for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+			for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+				registry_.retired[stage][i] += histograms_.buckets[stage][i].load(memory_order_relaxed);
+			}
+		}
+		registry_.threads.erase(find(registry_.threads.begin(), registry_.threads.end(), &histograms_));
+	}
+
+	ThreadStageHistograms& Get() {
+		return histograms_;
+	}
+
+private:
+	ProfileRegistry& registry_;
+	ThreadStageHistograms histograms_;
+};
+
+ThreadStageHistograms& GetThreadHistograms() {
+	thread_local ThreadHistogramsOwner owner;
+	return owner.Get();
+}
+
+int GetBitWidth(uint64_t value) {
+	int width = 0;
+	while (value != 0) {
+		value >>= 1;
+		++width;
+	}
+
+	return width;
+}
+
+}
+
+string_view GetQueryStageName(QueryStage stage) {
+	switch (stage) {
+	case QueryStage::PARSE:
+		return "parse"sv;
+	case QueryStage::POSTING_FETCH:
+		return "posting_fetch"sv;
+	case QueryStage::SCORE:
+		return "score"sv;
+	case QueryStage::FILTER:
+		return "filter"sv;
+	case QueryStage::TOP_K:
+		return "top_k"sv;
+	case QueryStage::MATERIALIZE:
+		return "materialize"sv;
+	case QueryStage::TOTAL:
+		return "total"sv;
+	}
+
+	return "unknown"sv;
+}
+
+LatencyHistogram::LatencyHistogram()
+	: buckets_(BUCKET_COUNT)
+{}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value) {
+	constexpr uint64_t sub_bucket_count = uint64_t(1) << SUB_BUCKET_BITS;
+	if (value < 2 * sub_bucket_count) {
+		return static_cast<size_t>(value);
+	}
+
+	const int shift = min(GetBitWidth(value), MAX_VALUE_BITS) - SUB_BUCKET_BITS - 1;
+	const uint64_t top = min(value >> shift, 2 * sub_bucket_count - 1);
+
+	return static_cast<size_t>(2 * sub_bucket_count + (shift - 1) * sub_bucket_count + (top - sub_bucket_count));
+}
+
+uint64_t LatencyHistogram::GetBucketUpperBound(size_t index) {
+	constexpr uint64_t sub_bucket_count = uint64_t(1) << SUB_BUCKET_BITS;
+	if (index < 2 * sub_bucket_count) {
+		return index;
+	}
+
+	const uint64_t shift = (index - 2 * sub_bucket_count) / sub_bucket_count + 1;
+	const uint64_t top = (index - 2 * sub_bucket_count) % sub_bucket_count + sub_bucket_count;
+
+	return ((top + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64_t value, uint64_t count) {
+	if (count == 0) {
+		return;
+	}
+	buckets_[GetBucketIndex(value)] += count;
+	count_ += count;
+	total_ += value * count;
+	min_ = min(min_, value);
+	max_ = max(max_, value);
+}
+
+void LatencyHistogram::RecordWithExpectedInterval(uint64_t value, uint64_t expected_interval) {
+	Record(value);
+	if (expected_interval == 0) {
+		return;
+	}
+	for (uint64_t missed = value - min(value, expected_interval); missed >= expected_interval; missed -= expected_interval) {
+		Record(missed);
+	}
+}
+
+void LatencyHistogram::AddBucket(size_t index, uint64_t count) {
+	if (count == 0) {
+		return;
+	}
+	const uint64_t lower_bound = index == 0 ? 0 : GetBucketUpperBound(index - 1) + 1;
+	const uint64_t upper_bound = GetBucketUpperBound(index);
+	buckets_[index] += count;
+	count_ += count;
+	total_ += (lower_bound + upper_bound) / 2 * count;
+	min_ = min(min_, lower_bound);
+	max_ = max(max_, upper_bound);
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+	for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+		buckets_[i] += other.buckets_[i];
+	}
+	count_ += other.count_;
+	total_ += other.total_;
+	min_ = min(min_, other.min_);
+	max_ = max(max_, other.max_);
+}
+
+void LatencyHistogram::Clear() {
+	fill(buckets_.begin(), buckets_.end(), 0);
+	count_ = 0;
+	total_ = 0;
+	min_ = UINT64_MAX;
+	max_ = 0;
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+	return count_;
+}
+
+uint64_t LatencyHistogram::GetTotal() const {
+	return total_;
+}
+
+uint64_t LatencyHistogram::GetMin() const {
+	return count_ == 0 ? 0 : min_;
+}
+
+uint64_t LatencyHistogram::GetMax() const {
+	return max_;
+}
+
+double LatencyHistogram::GetMean() const {
+	return count_ == 0 ? 0.0 : static_cast<double>(total_) / count_;
+}
+
+uint64_t LatencyHistogram::GetPercentile(double rank) const {
+	if (count_ == 0) {
+		return 0;
+	}
+
+	const uint64_t target = max<uint64_t>(1, static_cast<uint64_t>(rank * count_ + 0.5));
+	uint64_t seen = 0;
+	for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+		seen += buckets_[i];
+		if (seen >= target) {
+			return min(GetBucketUpperBound(i), max_);
+		}
+	}
+
+	return max_;
+}
+
+void RecordQueryStage(QueryStage stage, chrono::steady_clock::duration duration) {
+	const auto nanoseconds = chrono::duration_cast<chrono::nanoseconds>(duration).count();
+	auto& bucket = GetThreadHistograms().buckets[static_cast<size_t>(stage)][LatencyHistogram::GetBucketIndex(nanoseconds < 0 ? 0 : nanoseconds)];
+	// у гистограммы потока один писатель, атомарность нужна только читающему снимок
+	bucket.store(bucket.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+QueryProfileSnapshot GetQueryProfileSnapshot() {
+	QueryProfileSnapshot snapshot;
+	auto& registry = GetProfileRegistry();
+	lock_guard guard(registry.registry_mutex);
+	for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+		for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i) {
+			uint64_t count = registry.retired[stage][i];
+			for (const ThreadStageHistograms* thread_histograms : registry.threads) {
+				count += thread_histograms->buckets[stage][i].load(memory_order_relaxed);
+			}
+			snapshot.stages[stage].AddBucket(i, count);
+		}
+	}
+
+	return snapshot;
+}
+
+size_t GetQueryProfileThreadCount() {
+	auto& registry = GetProfileRegistry();
+	lock_guard guard(registry.registry_mutex);
+	return registry.threads.size();
+}
+
+void ResetQueryProfile() {
+	auto& registry = GetProfileRegistry();
+	lock_guard guard(registry.registry_mutex);
+	for (auto& stage_buckets : registry.retired) {
+		stage_buckets.fill(0);
+	}
+	for (ThreadStageHistograms* thread_histograms : registry.threads) {
+		for (auto& stage_buckets : thread_histograms->buckets) {
+			for (auto& bucket : stage_buckets) {
+				bucket.store(0, memory_order_relaxed);
+			}
+		}
+	}
+}
+
+ostream& operator<<(ostream& os, const QueryProfileSnapshot& snapshot) {
+	for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+		const LatencyHistogram& histogram = snapshot.stages[stage];
+		os << GetQueryStageName(static_cast<QueryStage>(stage)) << ": "s
+			<< "count = "s << histogram.GetCount()
+			<< ", mean = "s << histogram.GetMean() << " ns"s
+			<< ", p50 = "s << histogram.GetPercentile(0.5) << " ns"s
+			<< ", p99 = "s << histogram.GetPercentile(0.99) << " ns"s
+			<< ", max = "s << histogram.GetMax() << " ns"s << endl;
+	}
+
+	return os;
+}
+
+void PrintQueryProfileJson(ostream& os, const QueryProfileSnapshot& snapshot) {
+	os << "{"s;
+	for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+		const LatencyHistogram& histogram = snapshot.stages[stage];
+		if (stage > 0) {
+			os << ", "s;
+		}
+		os << "\""s << GetQueryStageName(static_cast<QueryStage>(stage)) << "\": {"s
+			<< "\"count\": "s << histogram.GetCount()
+			<< ", \"total_ns\": "s << histogram.GetTotal()
+			<< ", \"min_ns\": "s << histogram.GetMin()
+			<< ", \"p50_ns\": "s << histogram.GetPercentile(0.5)
+			<< ", \"p90_ns\": "s << histogram.GetPercentile(0.9)
+			<< ", \"p99_ns\": "s << histogram.GetPercentile(0.99)
+			<< ", \"p999_ns\": "s << histogram.GetPercentile(0.999)
+			<< ", \"max_ns\": "s << histogram.GetMax() << "}"s;
+	}
+	os << "}"s;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+#include <vector>
+
+// Инструментирование стадий запроса. Замеры в горячем пути включаются
+// макросом SEARCH_SERVER_PROFILE; без него макросы ниже раскрываются в пустоту.
+// Макрос задают проект Benchmark и отладочные конфигурации SearchServer, где его проверяют тесты
+#define QUERY_PROFILE_CONCAT_INTERNAL(X, Y) X ## Y
+#define QUERY_PROFILE_CONCAT(X, Y) QUERY_PROFILE_CONCAT_INTERNAL(X, Y)
+
+#ifdef SEARCH_SERVER_PROFILE
+#define PROFILE_QUERY_STAGE(stage) ScopedQueryStage QUERY_PROFILE_CONCAT(queryStageGuard, __LINE__)(stage)
+#define PROFILE_QUERY_STAGES(name) QueryStageSequence name
+#define PROFILE_NEXT_STAGE(name, stage) name.Next(stage)
+#else
+#define PROFILE_QUERY_STAGE(stage)
+#define PROFILE_QUERY_STAGES(name)
+#define PROFILE_NEXT_STAGE(name, stage)
+#endif
+
+enum class QueryStage {
+	PARSE,
+	POSTING_FETCH,
+	SCORE,
+	FILTER,
+	TOP_K,
+	MATERIALIZE,
+	TOTAL,
+};
+
+constexpr size_t QUERY_STAGE_COUNT = 7;
+
+std::string_view GetQueryStageName(QueryStage stage);
+
+// Гистограмма с логарифмически-линейными корзинами (как в HdrHistogram):
+// 32 корзины на каждую степень двойки, относительная погрешность около 3%
+class LatencyHistogram {
+public:
+	static constexpr int SUB_BUCKET_BITS = 5;
+	static constexpr int MAX_VALUE_BITS = 40;
+	static constexpr size_t BUCKET_COUNT = (2 << SUB_BUCKET_BITS) + (MAX_VALUE_BITS - SUB_BUCKET_BITS - 1) * (1 << SUB_BUCKET_BITS);
+
+	LatencyHistogram();
+
+	static size_t GetBucketIndex(uint64_t value);
+	static uint64_t GetBucketUpperBound(size_t index);
+
+	void Record(uint64_t value, uint64_t count = 1);
+	// Поправка на coordinated omission для замкнутой нагрузки: если замер дольше ожидаемого
+	// интервала между запросами, досчитываются запросы, которые не были отправлены, пока клиент ждал
+	void RecordWithExpectedInterval(uint64_t value, uint64_t expected_interval);
+	void AddBucket(size_t index, uint64_t count);
+	void Merge(const LatencyHistogram& other);
+	void Clear();
+
+	uint64_t GetCount() const;
+	uint64_t GetTotal() const;
+	uint64_t GetMin() const;
+	uint64_t GetMax() const;
+	double GetMean() const;
+	// rank из [0, 1]; возвращает верхнюю границу корзины, но не больше максимума
+	uint64_t GetPercentile(double rank) const;
+
+private:
+	std::vector<uint64_t> buckets_;
+	uint64_t count_ = 0;
+	uint64_t total_ = 0;
+	uint64_t min_ = UINT64_MAX;
+	uint64_t max_ = 0;
+};
+
+void RecordQueryStage(QueryStage stage, std::chrono::steady_clock::duration duration);
+
+class ScopedQueryStage {
+public:
+	explicit ScopedQueryStage(QueryStage stage)
+		: stage_(stage)
+	{}
+
+	~ScopedQueryStage() {
+		RecordQueryStage(stage_, std::chrono::steady_clock::now() - start_time_);
+	}
+
+private:
+	const QueryStage stage_;
+	const std::chrono::steady_clock::time_point start_time_ = std::chrono::steady_clock::now();
+};
+
+// Последовательные стадии внутри одной функции: Next закрывает текущую стадию и открывает новую
+class QueryStageSequence {
+public:
+	QueryStageSequence() = default;
+	QueryStageSequence(const QueryStageSequence&) = delete;
+	QueryStageSequence& operator=(const QueryStageSequence&) = delete;
+
+	~QueryStageSequence() {
+		Stop();
+	}
+
+	void Next(QueryStage stage) {
+		const auto now = std::chrono::steady_clock::now();
+		if (active_) {
+			RecordQueryStage(stage_, now - start_time_);
+		}
+		active_ = true;
+		stage_ = stage;
+		start_time_ = now;
+	}
+
+	void Stop() {
+		if (active_) {
+			RecordQueryStage(stage_, std::chrono::steady_clock::now() - start_time_);
+			active_ = false;
+		}
+	}
+
+private:
+	bool active_ = false;
+	QueryStage stage_ = QueryStage::TOTAL;
+	std::chrono::steady_clock::time_point start_time_;
+};
+
+struct QueryProfileSnapshot {
+	// индекс — static_cast<size_t>(QueryStage), значения в наносекундах
+	std::array<LatencyHistogram, QUERY_STAGE_COUNT> stages;
+};
+
+// Сводит гистограммы всех потоков; можно вызывать параллельно с замерами
+QueryProfileSnapshot GetQueryProfileSnapshot();
+void ResetQueryProfile();
+// Число потоков, чьи гистограммы ещё не слиты в общий итог
+size_t GetQueryProfileThreadCount();
+
+std::ostream& operator<<(std::ostream& os, const QueryProfileSnapshot& snapshot);
+void PrintQueryProfileJson(std::ostream& os, const QueryProfileSnapshot& snapshot);
\ No newline at end of file
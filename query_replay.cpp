@@ -0,0 +1,215 @@
+#include "query_replay.h"
+#include "process_queries.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+uint64_t ToNanoseconds(Clock::duration duration) {
+	const auto nanoseconds = chrono::duration_cast<chrono::nanoseconds>(duration).count();
+	return nanoseconds < 0 ? 0 : static_cast<uint64_t>(nanoseconds);
+}
+
+struct ClientResult {
+	LatencyHistogram service_time;
+	LatencyHistogram response_time;
+	size_t query_count = 0;
+	size_t no_result_count = 0;
+	size_t failed_count = 0;
+};
+
+void PrintHistogram(ostream& os, string_view name, const LatencyHistogram& histogram) {
+	os << name << ": mean = "s << histogram.GetMean() / 1000.0 << " us"s
+		<< ", p50 = "s << histogram.GetPercentile(0.5) / 1000.0 << " us"s
+		<< ", p90 = "s << histogram.GetPercentile(0.9) / 1000.0 << " us"s
+		<< ", p99 = "s << histogram.GetPercentile(0.99) / 1000.0 << " us"s
+		<< ", p999 = "s << histogram.GetPercentile(0.999) / 1000.0 << " us"s
+		<< ", max = "s << histogram.GetMax() / 1000.0 << " us"s << endl;
+}
+
+void PrintHistogramJson(ostream& os, const LatencyHistogram& histogram) {
+	os << "{\"count\": "s << histogram.GetCount()
+		<< ", \"mean_ns\": "s << histogram.GetMean()
+		<< ", \"p50_ns\": "s << histogram.GetPercentile(0.5)
+		<< ", \"p90_ns\": "s << histogram.GetPercentile(0.9)
+		<< ", \"p99_ns\": "s << histogram.GetPercentile(0.99)
+		<< ", \"p999_ns\": "s << histogram.GetPercentile(0.999)
+		<< ", \"max_ns\": "s << histogram.GetMax() << "}"s;
+}
+
+}
+
+vector<string> ReadQueryLog(istream& input) {
+	vector<string> queries;
+	string line;
+	while (getline(input, line)) {
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (line.find_first_not_of(' ') != string::npos) {
+			queries.push_back(move(line));
+		}
+	}
+	return queries;
+}
+
+ReplayReport ReplayQueries(const SearchServer& search_server, const vector<string>& queries, const ReplayOptions& options) {
+	if (queries.empty()) {
+		throw invalid_argument("Query log is empty"s);
+	}
+	if (options.client_count == 0 || options.batch_size == 0) {
+		throw invalid_argument("Client count and batch size must be positive"s);
+	}
+	const bool open_loop = options.mode == ReplayMode::OPEN_LOOP;
+	if (open_loop && !(options.target_qps > 0.0)) {
+		throw invalid_argument("Open-loop replay needs a positive target QPS"s);
+	}
+
+	// запрос клиента — один вызов API: один запрос FindTopDocuments или пачка ProcessQueries
+	const size_t queries_per_request = options.api == ReplayApi::PROCESS_QUERIES ? options.batch_size : 1;
+	const bool timed = options.duration > Clock::duration::zero();
+	const chrono::duration<double> request_interval(queries_per_request / options.target_qps);
+	size_t request_count = (queries.size() + queries_per_request - 1) / queries_per_request;
+	if (timed) {
+		request_count = open_loop
+			? static_cast<size_t>(chrono::duration<double>(options.duration) / request_interval) + 1
+			: SIZE_MAX;
+	}
+	const uint64_t expected_interval = ToNanoseconds(options.expected_interval);
+
+	// исключение из пачки ProcessQueries под execution::par завершает программу, поэтому
+	// некорректные запросы находятся до запуска клиентов и серверу не отправляются
+	vector<bool> is_malformed(queries.size(), false);
+	for (size_t i = 0; i < queries.size(); ++i) {
+		try {
+			search_server.EstimateQueryCost(queries[i]);
+		} catch (const invalid_argument&) {
+			is_malformed[i] = true;
+		}
+	}
+
+	vector<ClientResult> results(options.client_count);
+	atomic<size_t> next_request{ 0 };
+	// небольшой запас, чтобы запуск потоков не выглядел как задержка первых запросов
+	const Clock::time_point start = Clock::now() + 10ms;
+	const Clock::time_point deadline = timed ? start + options.duration : Clock::time_point::max();
+
+	const auto run_client = [&](size_t client) {
+		ClientResult& result = results[client];
+		vector<Document> documents;
+		vector<string> batch;
+		vector<vector<Document>> batch_results;
+		for (size_t k = 0;; ++k) {
+			// в открытом цикле расписание общее: клиент c отвечает за запросы c, c + N, c + 2N...
+			const size_t request = open_loop ? client + k * options.client_count : next_request.fetch_add(1);
+			if (request >= request_count) {
+				break;
+			}
+			const Clock::time_point intended = open_loop
+				? start + chrono::duration_cast<Clock::duration>(request_interval * static_cast<double>(request))
+				: max(Clock::now(), start);
+			if (intended >= deadline) {
+				break;
+			}
+			this_thread::sleep_until(intended);
+
+			const size_t first_query = request * queries_per_request;
+			const size_t request_query_count = timed ? queries_per_request : min(queries_per_request, queries.size() - first_query);
+			size_t query_count = 0;
+			batch.clear();
+			for (size_t i = 0; i < request_query_count; ++i) {
+				const size_t query = (first_query + i) % queries.size();
+				if (is_malformed[query]) {
+					++result.failed_count;
+				} else if (options.api == ReplayApi::PROCESS_QUERIES) {
+					batch.push_back(queries[query]);
+					++query_count;
+				} else {
+					++query_count;
+				}
+			}
+			if (query_count == 0) {
+				continue;
+			}
+
+			const Clock::time_point issued = Clock::now();
+			size_t no_result_count = 0;
+			if (options.api == ReplayApi::FIND_TOP_DOCUMENTS) {
+				search_server.FillTopDocuments(queries[first_query % queries.size()], documents);
+				no_result_count = documents.empty() ? 1 : 0;
+			} else {
+				ProcessQueriesInto(search_server, batch, batch_results);
+				no_result_count = count_if(batch_results.begin(), batch_results.end(),
+					[](const vector<Document>& documents) { return documents.empty(); });
+			}
+			const Clock::time_point finished = Clock::now();
+
+			const uint64_t service_time = ToNanoseconds(finished - issued);
+			const uint64_t response_time = ToNanoseconds(finished - intended);
+			result.service_time.Record(service_time, query_count);
+			if (open_loop) {
+				result.response_time.Record(response_time, query_count);
+			} else {
+				for (size_t i = 0; i < query_count; ++i) {
+					result.response_time.RecordWithExpectedInterval(response_time, expected_interval);
+				}
+			}
+			result.query_count += query_count;
+			result.no_result_count += no_result_count;
+		}
+	};
+
+	vector<thread> clients;
+	clients.reserve(options.client_count - 1);
+	for (size_t client = 1; client < options.client_count; ++client) {
+		clients.emplace_back(run_client, client);
+	}
+	run_client(0);
+	for (thread& client : clients) {
+		client.join();
+	}
+
+	ReplayReport report;
+	report.elapsed = Clock::now() - start;
+	for (const ClientResult& result : results) {
+		report.query_count += result.query_count;
+		report.no_result_count += result.no_result_count;
+		report.failed_count += result.failed_count;
+		report.service_time.Merge(result.service_time);
+		report.response_time.Merge(result.response_time);
+	}
+	report.achieved_qps = report.query_count / chrono::duration<double>(report.elapsed).count();
+	report.offered_qps = open_loop ? options.target_qps : report.achieved_qps;
+
+	return report;
+}
+
+void PrintReplayReport(ostream& os, const ReplayReport& report) {
+	os << "queries: "s << report.query_count << ", no results: "s << report.no_result_count << ", malformed: "s << report.failed_count << endl;
+	os << "elapsed: "s << chrono::duration<double>(report.elapsed).count() << " s"s
+		<< ", offered: "s << report.offered_qps << " q/s"s
+		<< ", achieved: "s << report.achieved_qps << " q/s"s << endl;
+	PrintHistogram(os, "service time"sv, report.service_time);
+	PrintHistogram(os, "response time"sv, report.response_time);
+}
+
+void PrintReplayReportJson(ostream& os, const ReplayReport& report) {
+	os << "{\"query_count\": "s << report.query_count
+		<< ", \"no_result_count\": "s << report.no_result_count
+		<< ", \"failed_count\": "s << report.failed_count
+		<< ", \"elapsed_s\": "s << chrono::duration<double>(report.elapsed).count()
+		<< ", \"offered_qps\": "s << report.offered_qps
+		<< ", \"achieved_qps\": "s << report.achieved_qps
+		<< ", \"service_time\": "s;
+	PrintHistogramJson(os, report.service_time);
+	os << ", \"response_time\": "s;
+	PrintHistogramJson(os, report.response_time);
+	os << "}"s << endl;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "query_profiler.h"
+#include "search_server.h"
+
+enum class ReplayMode {
+	// запросы отправляются по расписанию с заданной суммарной частотой, независимо от ответов
+	OPEN_LOOP,
+	// каждый клиент отправляет следующий запрос сразу после ответа на предыдущий
+	CLOSED_LOOP,
+};
+
+enum class ReplayApi {
+	FIND_TOP_DOCUMENTS,
+	// клиент отправляет запросы пачками через ProcessQueriesInto
+	PROCESS_QUERIES,
+};
+
+struct ReplayOptions {
+	ReplayMode mode = ReplayMode::CLOSED_LOOP;
+	ReplayApi api = ReplayApi::FIND_TOP_DOCUMENTS;
+	size_t client_count = 1;
+	// суммарная предлагаемая нагрузка для OPEN_LOOP, запросов в секунду
+	double target_qps = 1000.0;
+	// ноль — журнал проигрывается один раз; иначе по кругу в течение этого времени
+	std::chrono::steady_clock::duration duration{};
+	size_t batch_size = 16;
+	// ожидаемый интервал между запросами клиента для поправки CLOSED_LOOP; ноль — без поправки
+	std::chrono::steady_clock::duration expected_interval{};
+};
+
+struct ReplayReport {
+	// обработанные сервером запросы; некорректные в query_count и замеры не входят
+	size_t query_count = 0;
+	size_t no_result_count = 0;
+	// запросы журнала, которые сервер отвергает как некорректные, например "cat --dog"
+	size_t failed_count = 0;
+	std::chrono::steady_clock::duration elapsed{};
+	double offered_qps = 0.0;
+	double achieved_qps = 0.0;
+	// время обработки запроса сервером, нс
+	LatencyHistogram service_time;
+	// время от запланированной отправки до ответа, нс: включает ожидание в очереди
+	// клиента, поэтому не занижает хвосты при перегрузке (coordinated omission)
+	LatencyHistogram response_time;
+};
+
+// Журнал запросов: по одному запросу в строке, пустые строки пропускаются.
+// Некорректные запросы остаются в журнале: ReplayQueries считает их в failed_count
+std::vector<std::string> ReadQueryLog(std::istream& input);
+
+ReplayReport ReplayQueries(const SearchServer& search_server, const std::vector<std::string>& queries, const ReplayOptions& options);
+
+void PrintReplayReport(std::ostream& os, const ReplayReport& report);
+void PrintReplayReportJson(std::ostream& os, const ReplayReport& report);
\ No newline at end of file
@@ -0,0 +1,351 @@
+#include "query_session.h"
+#include "string_processing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <tuple>
+
+using namespace std;
+
+namespace {
+
+bool StartsWith(string_view text, string_view prefix) {
+	return text.substr(0, prefix.size()) == prefix;
+}
+
+bool IsRankedBefore(const Document& lhs, const Document& rhs) {
+	if (abs(lhs.relevance - rhs.relevance) < 1e-6) {
+		return lhs.rating > rhs.rating;
+	} else {
+		return lhs.relevance > rhs.relevance;
+	}
+}
+
+const Document* FindById(const vector<Document>& documents, int document_id) {
+	const auto it = lower_bound(documents.begin(), documents.end(), document_id,
+		[](const Document& document, int id) {
+			return document.id < id;
+		}
+	);
+	return it != documents.end() && it->id == document_id ? &*it : nullptr;
+}
+
+}
+
+QuerySession::QuerySession(const SearchServer& search_server, DocumentStatus status, QueryMode mode)
+	: search_server_(search_server)
+	, status_(status)
+	, mode_(mode)
+	, server_change_count_(search_server.GetChangeCount())
+{
+}
+
+const vector<Document>& QuerySession::Update(string_view raw_query) {
+	if (search_server_.GetChangeCount() != server_change_count_) {
+		Reset();
+	}
+
+	vector<string_view> words;
+	for (const string_view word : SplitIntoWords(raw_query)) {
+		if (!word.empty()) {
+			words.push_back(word);
+		}
+	}
+	string_view open_word;
+	if (!words.empty() && raw_query.back() != ' ') {
+		open_word = words.back();
+		words.pop_back();
+	}
+	if (open_word == "-"sv || open_word == "+"sv) {
+		open_word = {};
+	}
+
+	// завершённые слова сессии должны остаться началом запроса, иначе считаем заново
+	if (committed_words_.size() > words.size() || !equal(committed_words_.begin(), committed_words_.end(), words.begin())) {
+		Reset();
+	}
+	try {
+		for (size_t i = committed_words_.size(); i < words.size(); ++i) {
+			CommitWord(words[i]);
+		}
+		ComputeOpenWord(open_word);
+	} catch (...) {
+		Reset();
+		throw;
+	}
+
+	if (!is_ranked_valid_) {
+		RankAccumulated();
+	}
+	CollectResult();
+
+	return result_;
+}
+
+void QuerySession::Reset() {
+	server_change_count_ = search_server_.GetChangeCount();
+	committed_words_.clear();
+	plus_words_.clear();
+	excluded_documents_.Clear();
+	has_required_words_ = false;
+	required_documents_.Clear();
+	accumulated_.clear();
+	ranked_.clear();
+	is_ranked_valid_ = false;
+	ClearOpenWord();
+	open_word_position_ = 0;
+	// списки документов могли измениться вместе с индексом
+	open_prefix_.clear();
+	open_postings_.clear();
+}
+
+size_t QuerySession::GetCommittedWordCount() const {
+	return committed_words_.size();
+}
+
+void QuerySession::CommitWord(string_view word) {
+	// пробел после недописанного слова: его вклад уже посчитан
+	if (!open_word_.empty() && word == open_word_ && open_word_position_ == committed_words_.size()) {
+		MergeInto(accumulated_, open_contribution_);
+		excluded_documents_ |= open_excluded_documents_;
+		plus_words_.insert(open_plus_words_.begin(), open_plus_words_.end());
+		if (open_is_required_) {
+			AddRequiredDocuments(open_required_documents_);
+		}
+		ClearOpenWord();
+	} else {
+		vector<Document> contribution;
+		bool is_required = false;
+		DocumentIdBitmap required_documents;
+		const vector<string> new_plus_words = CollectWord(word, contribution, excluded_documents_, is_required, required_documents);
+		MergeInto(accumulated_, contribution);
+		plus_words_.insert(new_plus_words.begin(), new_plus_words.end());
+		if (is_required) {
+			AddRequiredDocuments(required_documents);
+		}
+	}
+	committed_words_.emplace_back(word);
+	is_ranked_valid_ = false;
+}
+
+void QuerySession::ComputeOpenWord(string_view word) {
+	if (word == open_word_ && open_word_position_ == committed_words_.size()) {
+		return;
+	}
+	ClearOpenWord();
+	if (word.empty()) {
+		return;
+	}
+
+	const auto query_word = search_server_.ParseQueryWord(execution::seq, word);
+	if (!query_word.is_stop) {
+		NarrowOpenPostings(query_word.data);
+	}
+	open_plus_words_ = CollectWord(word, open_contribution_, open_excluded_documents_, open_is_required_, open_required_documents_);
+	open_word_ = word;
+	open_word_position_ = committed_words_.size();
+}
+
+void QuerySession::ClearOpenWord() {
+	open_word_.clear();
+	open_plus_words_.clear();
+	open_contribution_.clear();
+	open_excluded_documents_.Clear();
+	open_is_required_ = false;
+	open_required_documents_.Clear();
+}
+
+void QuerySession::NarrowOpenPostings(string_view prefix) {
+	if (!open_prefix_.empty() && StartsWith(prefix, open_prefix_)) {
+		// слова с более длинным префиксом — непрерывная часть уже найденного диапазона
+		const auto first = lower_bound(open_postings_.begin(), open_postings_.end(), prefix,
+			[](const pair<string_view, const Postings*>& entry, string_view value) {
+				return entry.first < value;
+			}
+		);
+		const auto last = partition_point(first, open_postings_.end(),
+			[prefix](const pair<string_view, const Postings*>& entry) {
+				return StartsWith(entry.first, prefix);
+			}
+		);
+		open_postings_.erase(last, open_postings_.end());
+		open_postings_.erase(open_postings_.begin(), first);
+	} else {
+		open_postings_.clear();
+		const auto& word_to_document_freqs = search_server_.word_to_document_freqs_;
+		for (auto it = word_to_document_freqs.lower_bound(prefix); it != word_to_document_freqs.end() && StartsWith(it->first, prefix); ++it) {
+			open_postings_.emplace_back(it->first, &it->second);
+		}
+	}
+	open_prefix_ = prefix;
+}
+
+const QuerySession::Postings* QuerySession::FindPostings(string_view word) const {
+	if (!open_prefix_.empty() && StartsWith(word, open_prefix_)) {
+		const auto it = lower_bound(open_postings_.begin(), open_postings_.end(), word,
+			[](const pair<string_view, const Postings*>& entry, string_view value) {
+				return entry.first < value;
+			}
+		);
+		return it != open_postings_.end() && it->first == word ? it->second : nullptr;
+	}
+	const auto& word_to_document_freqs = search_server_.word_to_document_freqs_;
+	const auto word_it = word_to_document_freqs.find(word);
+	return word_it != word_to_document_freqs.end() ? &word_it->second : nullptr;
+}
+
+void QuerySession::RankAccumulated() {
+	ranked_.clear();
+	for (const Document& document : accumulated_) {
+		if (IsCommittedMatch(document.id)) {
+			ranked_.push_back(document);
+		}
+	}
+	// точный порядок: сравнение с допуском не годится для sort
+	sort(ranked_.begin(), ranked_.end(),
+		[](const Document& lhs, const Document& rhs) {
+			return tie(rhs.relevance, rhs.rating, lhs.id) < tie(lhs.relevance, lhs.rating, rhs.id);
+		}
+	);
+	is_ranked_valid_ = true;
+}
+
+void QuerySession::CollectResult() {
+	result_.clear();
+	if (open_is_required_) {
+		// в выдачу попадают только документы обязательного последнего слова
+		open_required_documents_.ForEach([this](int document_id) {
+			if (!IsCommittedMatch(document_id) || open_excluded_documents_.Test(document_id)) {
+				return;
+			}
+			const Document* accumulated = FindById(accumulated_, document_id);
+			const Document* open = FindById(open_contribution_, document_id);
+			if (accumulated == nullptr && open == nullptr) {
+				return;
+			}
+			Document document = accumulated != nullptr ? *accumulated : *open;
+			if (accumulated != nullptr && open != nullptr) {
+				document.relevance += open->relevance;
+			}
+			result_.push_back(document);
+		});
+	} else {
+		for (const Document& open : open_contribution_) {
+			if (!IsCommittedMatch(open.id) || open_excluded_documents_.Test(open.id)) {
+				continue;
+			}
+			Document document = open;
+			if (const Document* accumulated = FindById(accumulated_, open.id)) {
+				document.relevance += accumulated->relevance;
+			}
+			result_.push_back(document);
+		}
+		// у остальных документов релевантность прежняя: достаточно начала ranked_, включая
+		// документы, равные последнему взятому с точностью 1e-6, которые могут обойти его по рейтингу
+		size_t taken = 0;
+		double last_relevance = 0.0;
+		for (const Document& document : ranked_) {
+			if (taken >= static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT) && document.relevance < last_relevance - 1e-6) {
+				break;
+			}
+			if (open_excluded_documents_.Test(document.id) || FindById(open_contribution_, document.id) != nullptr) {
+				continue;
+			}
+			result_.push_back(document);
+			if (++taken == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+				last_relevance = document.relevance;
+			}
+		}
+	}
+
+	const auto top_end = result_.begin() + min(result_.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+	partial_sort(result_.begin(), top_end, result_.end(), IsRankedBefore);
+	result_.erase(top_end, result_.end());
+}
+
+vector<string> QuerySession::CollectWord(string_view word, vector<Document>& contribution, DocumentIdBitmap& excluded_documents,
+	bool& is_required, DocumentIdBitmap& required_documents) {
+	auto query_word = search_server_.ParseQueryWord(execution::seq, word);
+	if (query_word.is_stop) {
+		return {};
+	}
+
+	if (query_word.is_minus) {
+		if (const Postings* postings = FindPostings(query_word.data)) {
+			for (const auto& [id, _] : *postings) {
+				excluded_documents.Set(id);
+			}
+		}
+		return {};
+	}
+
+	query_word.is_required = query_word.is_required || mode_ == QueryMode::ALL;
+	const vector<string_view> candidates = search_server_.ExpandPlusWord(query_word);
+	if (query_word.is_required) {
+		// обязательное слово раскрывается ровно в одно слово индекса
+		is_required = true;
+		if (const Postings* postings = FindPostings(candidates.front())) {
+			for (const auto& [id, _] : *postings) {
+				required_documents.Set(id);
+			}
+		}
+	}
+
+	vector<string> new_plus_words;
+	vector<Document> word_contribution;
+	for (const string_view candidate : candidates) {
+		if (plus_words_.count(candidate) > 0) {
+			continue;
+		}
+		new_plus_words.emplace_back(candidate);
+		const Postings* postings = FindPostings(candidate);
+		if (postings == nullptr) {
+			continue;
+		}
+
+		const double inverse_document_freq = search_server_.ComputeWordInverseDocumentFreq(candidate, nullptr);
+		word_contribution.clear();
+		for (const auto& [id, term_freq] : *postings) {
+			const auto& data = search_server_.documents_.at(id);
+			if (data.status == status_) {
+				word_contribution.push_back({ id, term_freq * inverse_document_freq, data.rating });
+			}
+		}
+		MergeInto(contribution, word_contribution);
+	}
+	return new_plus_words;
+}
+
+void QuerySession::AddRequiredDocuments(const DocumentIdBitmap& documents) {
+	if (has_required_words_) {
+		required_documents_ &= documents;
+	} else {
+		required_documents_ = documents;
+		has_required_words_ = true;
+	}
+}
+
+bool QuerySession::IsCommittedMatch(int document_id) const {
+	return !excluded_documents_.Test(document_id) && (!has_required_words_ || required_documents_.Test(document_id));
+}
+
+void QuerySession::MergeInto(vector<Document>& target, const vector<Document>& contribution) {
+	if (contribution.empty()) {
+		return;
+	}
+	merge_buffer_.clear();
+	merge_buffer_.reserve(target.size() + contribution.size());
+	auto target_it = target.begin();
+	auto contribution_it = contribution.begin();
+	while (target_it != target.end() || contribution_it != contribution.end()) {
+		if (contribution_it == contribution.end() || (target_it != target.end() && target_it->id < contribution_it->id)) {
+			merge_buffer_.push_back(*target_it++);
+		} else if (target_it == target.end() || contribution_it->id < target_it->id) {
+			merge_buffer_.push_back(*contribution_it++);
+		} else {
+			merge_buffer_.push_back(*target_it++);
+			merge_buffer_.back().relevance += (contribution_it++)->relevance;
+		}
+	}
+	target.swap(merge_buffer_);
+}
\ No newline at end of file
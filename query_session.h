@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "document.h"
+#include "document_id_bitmap.h"
+#include "search_server.h"
+
+// Сессия поиска по мере ввода: запрос приходит целиком после каждого нажатия клавиши.
+// Вклады завершённых слов (за которыми уже набран пробел) копятся между вызовами вместе с
+// их ранжированием, поэтому нажатие клавиши сливает с ним только вклад последнего слова.
+// Слова индекса с префиксом последнего слова хранятся и сужаются, пока слово дописывается.
+// Правка уже завершённого слова или любое изменение индекса (SearchServer::GetChangeCount)
+// сбрасывают накопленное.
+// Результат совпадает с FindTopDocuments(query, status) для запроса без пустых слов;
+// недописанные минус и плюс ("cat -", "cat +") игнорируются. Сессия не потокобезопасна, изменения
+// индекса во время вызова Update недопустимы
+class QuerySession {
+public:
+	explicit QuerySession(const SearchServer& search_server, DocumentStatus status = DocumentStatus::ACTUAL, QueryMode mode = QueryMode::ANY);
+
+	// Бросает invalid_argument, как FindTopDocuments, для некорректных слов запроса
+	const std::vector<Document>& Update(std::string_view raw_query);
+	void Reset();
+
+	// Число слов запроса, вклад которых хранится в сессии
+	size_t GetCommittedWordCount() const;
+
+private:
+	const SearchServer& search_server_;
+	DocumentStatus status_;
+	QueryMode mode_;
+	uint64_t server_change_count_ = 0;
+
+	std::vector<std::string> committed_words_;
+	std::set<std::string, std::less<>> plus_words_;
+	DocumentIdBitmap excluded_documents_;
+	// пересечение документов обязательных слов; действительно, если has_required_words_
+	bool has_required_words_ = false;
+	DocumentIdBitmap required_documents_;
+	// суммы вкладов завершённых плюс-слов, упорядоченные по id; только документы со статусом status_
+	std::vector<Document> accumulated_;
+	// документы accumulated_, прошедшие минус- и обязательные слова, в порядке выдачи;
+	// пересобирается только после завершения слова
+	std::vector<Document> ranked_;
+	bool is_ranked_valid_ = false;
+
+	// последнее недописанное слово и его вклад; действительны, пока не изменились
+	// ни слово, ни число завершённых слов перед ним
+	std::string open_word_;
+	size_t open_word_position_ = 0;
+	std::vector<std::string> open_plus_words_;
+	std::vector<Document> open_contribution_;
+	DocumentIdBitmap open_excluded_documents_;
+	bool open_is_required_ = false;
+	DocumentIdBitmap open_required_documents_;
+
+	using Postings = std::pmr::map<int, double>;
+	// слова индекса, начинающиеся с open_prefix_, со списками документов, по возрастанию слова.
+	// Пока последнее слово дописывается, его слова ищутся в этом диапазоне, и он сужается
+	std::string open_prefix_;
+	std::vector<std::pair<std::string_view, const Postings*>> open_postings_;
+
+	std::vector<Document> merge_buffer_;
+	std::vector<Document> result_;
+
+	void CommitWord(std::string_view word);
+	void ComputeOpenWord(std::string_view word);
+	void ClearOpenWord();
+	// Сужает open_postings_ до слов с префиксом prefix или собирает их заново из индекса
+	void NarrowOpenPostings(std::string_view prefix);
+	const Postings* FindPostings(std::string_view word) const;
+	void RankAccumulated();
+	// Вклад последнего слова, слитый с ranked_, в result_
+	void CollectResult();
+	// Вклад слова запроса: документы плюс-слов, ещё не учтённых в plus_words_, добавляются
+	// в contribution, документы минус-слова — в excluded_documents, документы обязательного
+	// слова — в required_documents (is_required становится true). Возвращает новые плюс-слова
+	std::vector<std::string> CollectWord(std::string_view word, std::vector<Document>& contribution, DocumentIdBitmap& excluded_documents,
+		bool& is_required, DocumentIdBitmap& required_documents);
+	void AddRequiredDocuments(const DocumentIdBitmap& documents);
+	// Проверка минус- и обязательных слов, уже завершённых в сессии
+	bool IsCommittedMatch(int document_id) const;
+	// Слияние упорядоченных по id вкладов с суммированием релевантности
+	void MergeInto(std::vector<Document>& target, const std::vector<Document>& contribution);
+};
\ No newline at end of file
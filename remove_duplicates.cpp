@@ -9,10 +9,10 @@ void RemoveDuplicates(SearchServer& search_server){
 	vector<int> duplicates_ids;
 	set<vector<string>> documents_words;
 	for (const auto id : search_server) {
-		const auto word_freq = search_server.GetWordToFrequencies(id);
+		const auto& word_freq = search_server.GetWordToFrequencies(id);
 		vector<string> words(word_freq.size());
 		int count = 0;
-		for (const auto [word, _] : word_freq) {
+		for (const auto& [word, _] : word_freq) {
 			words[count] = word;
 			++count;
 		}
@@ -0,0 +1,125 @@
+#include "corpus_generator.h"
+#include "corpus_loader.h"
+#include "query_replay.h"
+#include "search_server.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void PrintUsage() {
+	cerr << "Usage: Replay [--corpus=FILE [--format=tsv|jsonl] | --documents=N] [--stop-words=\"a b c\"]\n"s
+		<< "              [--queries=FILE | --query-count=N] [--mode=open|closed] [--qps=N] [--clients=N]\n"s
+		<< "              [--duration=S] [--api=find|process] [--batch=N] [--expected-interval-us=N]\n"s
+		<< "              [--output=results.json]\n"s
+		<< "Without --corpus a synthetic corpus is generated; without --queries a synthetic query log is used."s << endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	CorpusOptions corpus_options;
+	CorpusLoaderOptions loader_options;
+	QueryLogOptions query_options;
+	ReplayOptions replay_options;
+	string corpus_path;
+	string query_path;
+	string stop_words;
+	string output_path;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const string argument = argv[i];
+			const size_t equals = argument.find('=');
+			const string key = argument.substr(0, equals);
+			const string value = equals == string::npos ? ""s : argument.substr(equals + 1);
+
+			if (key == "--corpus"s) {
+				corpus_path = value;
+			} else if (key == "--format"s && (value == "tsv"s || value == "jsonl"s)) {
+				loader_options.format = value == "tsv"s ? CorpusFormat::TSV : CorpusFormat::JSON_LINES;
+			} else if (key == "--documents"s) {
+				corpus_options.document_count = stoull(value);
+			} else if (key == "--stop-words"s) {
+				stop_words = value;
+			} else if (key == "--queries"s) {
+				query_path = value;
+			} else if (key == "--query-count"s) {
+				query_options.query_count = stoull(value);
+			} else if (key == "--mode"s && (value == "open"s || value == "closed"s)) {
+				replay_options.mode = value == "open"s ? ReplayMode::OPEN_LOOP : ReplayMode::CLOSED_LOOP;
+			} else if (key == "--qps"s) {
+				replay_options.target_qps = stod(value);
+			} else if (key == "--clients"s) {
+				replay_options.client_count = stoull(value);
+			} else if (key == "--duration"s) {
+				replay_options.duration = chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(stod(value)));
+			} else if (key == "--api"s && (value == "find"s || value == "process"s)) {
+				replay_options.api = value == "find"s ? ReplayApi::FIND_TOP_DOCUMENTS : ReplayApi::PROCESS_QUERIES;
+			} else if (key == "--batch"s) {
+				replay_options.batch_size = stoull(value);
+			} else if (key == "--expected-interval-us"s) {
+				replay_options.expected_interval = chrono::microseconds(stoull(value));
+			} else if (key == "--output"s) {
+				output_path = value;
+			} else {
+				PrintUsage();
+				return 1;
+			}
+		}
+		if (!corpus_path.empty() && query_path.empty()) {
+			throw invalid_argument("--queries is required together with --corpus"s);
+		}
+	} catch (const exception& e) {
+		cerr << "Invalid argument: "s << e.what() << endl;
+		PrintUsage();
+		return 1;
+	}
+
+	try {
+		SearchServer search_server(stop_words);
+		vector<string> queries;
+		if (corpus_path.empty()) {
+			CorpusGenerator corpus(corpus_options);
+			GeneratedDocument document;
+			while (corpus.Next(document)) {
+				search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+			}
+			if (query_path.empty()) {
+				queries = GenerateQueryLog(corpus.GetVocabulary(), query_options);
+			}
+		} else {
+			const CorpusLoadStats stats = LoadCorpusFile(search_server, corpus_path, loader_options);
+			cerr << "Loaded "s << stats.document_count << " documents in "s
+				<< chrono::duration<double>(stats.elapsed).count() << " s"s << endl;
+		}
+		if (!query_path.empty()) {
+			ifstream input(query_path);
+			if (!input) {
+				throw invalid_argument("Cannot open query log "s + query_path);
+			}
+			queries = ReadQueryLog(input);
+		}
+
+		cerr << "Replaying "s << queries.size() << " queries"s << endl;
+		const ReplayReport report = ReplayQueries(search_server, queries, replay_options);
+		PrintReplayReport(cout, report);
+		if (!output_path.empty()) {
+			ofstream output(output_path);
+			if (!output) {
+				throw invalid_argument("Cannot open "s + output_path);
+			}
+			PrintReplayReportJson(output, report);
+		}
+	} catch (const exception& e) {
+		cerr << "Replay failed: "s << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
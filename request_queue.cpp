@@ -1,39 +1,148 @@
 #include "request_queue.h"
 
+#include <algorithm>
+#include <stdexcept>
+
 using namespace std;
 
-RequestQueue::RequestQueue(const SearchServer& search_server)
-	: num_of_null_query_(0)
-	, search_server_(search_server) 
-{}
+RequestQueue::RequestQueue(const SearchServer& search_server, size_t capacity)
+	: search_server_(search_server)
+	, slots_(capacity)
+{
+	if (capacity == 0) {
+		throw invalid_argument("RequestQueue: capacity must be positive"s);
+	}
+}
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status) {
-	vector<Document> request = search_server_.FindTopDocuments(raw_query, status);
-	AddRequest(QueryResult{ request });
+	vector<Document> request;
+	AddFindRequest(raw_query, status, request);
 
 	return request;
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string& raw_query) {
-	vector<Document> request = search_server_.FindTopDocuments(raw_query);
-	AddRequest(QueryResult{ request });
+	vector<Document> request;
+	AddFindRequest(raw_query, request);
 
 	return request;
 }
 
+void RequestQueue::AddFindRequest(const string& raw_query, DocumentStatus status, vector<Document>& result) {
+	const Clock::time_point start = Clock::now();
+	search_server_.FillTopDocuments(raw_query, status, result);
+	const Clock::time_point finish = Clock::now();
+	AddRequest(result.size(), finish - start, finish);
+}
+
+void RequestQueue::AddFindRequest(const string& raw_query, vector<Document>& result) {
+	const Clock::time_point start = Clock::now();
+	search_server_.FillTopDocuments(raw_query, result);
+	const Clock::time_point finish = Clock::now();
+	AddRequest(result.size(), finish - start, finish);
+}
+
+void RequestQueue::AddRequest(size_t document_count, Clock::duration latency, Clock::time_point finish_time) {
+	const uint64_t request = next_request_.fetch_add(1, memory_order_relaxed);
+	Slot& slot = slots_[request % slots_.size()];
+
+	// слот захватывается только из завершённого состояния и только более новым запросом;
+	// если его держит отставший писатель, запись теряется, а не перемешивается
+	uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+	do {
+		if (sequence % 2 == 1 || sequence >= 2 * (request + 1)) {
+			return;
+		}
+	} while (!slot.sequence.compare_exchange_weak(sequence, 2 * request + 1, memory_order_relaxed));
+	atomic_thread_fence(memory_order_release);
+
+	slot.finish_time.store(finish_time.time_since_epoch().count(), memory_order_relaxed);
+	slot.latency.store(latency.count(), memory_order_relaxed);
+	slot.document_count.store(static_cast<uint32_t>(document_count), memory_order_relaxed);
+	slot.sequence.store(2 * (request + 1), memory_order_release);
+}
+
 int RequestQueue::GetNoResultRequests() const {
-	return num_of_null_query_;
+	int result = 0;
+	ForEachRecord([&result](const Record& record) {
+		if (record.document_count == 0) {
+			++result;
+		}
+	});
+
+	return result;
 }
 
-void RequestQueue::AddRequest(const QueryResult& request) {
-	if (static_cast<int>(requests_.size()) == sec_in_day_) {
-		if (requests_.front().result.empty()) {
-			--num_of_null_query_;
+size_t RequestQueue::GetCapacity() const {
+	return slots_.size();
+}
+
+RequestQueue::Statistics RequestQueue::GetStatistics(Clock::duration window) const {
+	return GetStatistics(window, Clock::now());
+}
+
+RequestQueue::Statistics RequestQueue::GetStatistics(Clock::duration window, Clock::time_point now) const {
+	const int64_t window_end = now.time_since_epoch().count();
+	const int64_t window_begin = window_end - window.count();
+
+	Statistics result;
+	int64_t oldest = window_end;
+	vector<int64_t> latencies;
+	latencies.reserve(slots_.size());
+	ForEachRecord([&](const Record& record) {
+		if (record.finish_time <= window_begin || record.finish_time > window_end) {
+			return;
 		}
-		requests_.pop_front();
+		++result.request_count;
+		if (record.document_count == 0) {
+			++result.no_result_count;
+		}
+		oldest = min(oldest, record.finish_time);
+		latencies.push_back(record.latency);
+	});
+	if (latencies.empty()) {
+		return result;
+	}
+
+	// если всё кольцо попало в окно, начало окна могло быть уже перезаписано
+	result.covered_time = result.request_count == slots_.size()
+		? Clock::duration(window_end - oldest)
+		: window;
+	result.no_result_rate = static_cast<double>(result.no_result_count) / result.request_count;
+	const double covered_seconds = chrono::duration<double>(result.covered_time).count();
+	if (covered_seconds > 0) {
+		result.queries_per_second = result.request_count / covered_seconds;
 	}
-	requests_.push_back(request);
-	if (request.result.empty()) {
-		++num_of_null_query_;
+
+	const auto percentile = [&latencies](double rank) {
+		const size_t index = min(latencies.size() - 1, static_cast<size_t>(rank * latencies.size()));
+		nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+		return Clock::duration(latencies[index]);
+	};
+	result.latency_p50 = percentile(0.5);
+	result.latency_p90 = percentile(0.9);
+	result.latency_p99 = percentile(0.99);
+	result.latency_max = Clock::duration(*max_element(latencies.begin(), latencies.end()));
+
+	return result;
+}
+
+template <typename Callback>
+void RequestQueue::ForEachRecord(Callback callback) const {
+	for (const Slot& slot : slots_) {
+		const uint64_t sequence = slot.sequence.load(memory_order_acquire);
+		if (sequence == 0 || sequence % 2 == 1) {
+			continue;
+		}
+		const Record record{
+			slot.finish_time.load(memory_order_relaxed),
+			slot.latency.load(memory_order_relaxed),
+			slot.document_count.load(memory_order_relaxed)
+		};
+		atomic_thread_fence(memory_order_acquire);
+		if (slot.sequence.load(memory_order_relaxed) != sequence) {
+			continue;
+		}
+		callback(record);
 	}
-}
\ No newline at end of file
+}
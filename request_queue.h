@@ -1,34 +1,84 @@
 #pragma once
 
 #include "search_server.h"
-#include <deque>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <vector>
 #include <string>
 
+// Кольцевой буфер компактных записей о запросах фиксированной ёмкости.
+// Запись и чтение статистики не блокируют друг друга, поэтому очередь
+// можно разделять между потоками (например, воркерами ProcessQueries).
 class RequestQueue {
 public:
-	explicit RequestQueue(const SearchServer& search_server);
+	using Clock = std::chrono::steady_clock;
+
+	struct Statistics {
+		size_t request_count = 0;
+		size_t no_result_count = 0;
+		double no_result_rate = 0.0;
+		double queries_per_second = 0.0;
+		Clock::duration covered_time{};
+		Clock::duration latency_p50{};
+		Clock::duration latency_p90{};
+		Clock::duration latency_p99{};
+		Clock::duration latency_max{};
+	};
+
+	explicit RequestQueue(const SearchServer& search_server, size_t capacity = sec_in_day_);
 
 	template <typename DocumentPredicate>
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate) {
-		std::vector<Document> request = search_server_.FindTopDocuments(raw_query, document_predicate);
-		AddRequest(QueryResult{ request });
+		std::vector<Document> request;
+		AddFindRequest(raw_query, document_predicate, request);
 
 		return request;
 	}
 
+	template <typename DocumentPredicate>
+	void AddFindRequest(const std::string& raw_query, DocumentPredicate document_predicate, std::vector<Document>& result) {
+		const Clock::time_point start = Clock::now();
+		search_server_.FillTopDocuments(std::execution::seq, raw_query, document_predicate, result);
+		const Clock::time_point finish = Clock::now();
+		AddRequest(result.size(), finish - start, finish);
+	}
+
 	std::vector<Document> AddFindRequest(const std::string& raw_query, DocumentStatus status);
 	std::vector<Document> AddFindRequest(const std::string& raw_query);
+	void AddFindRequest(const std::string& raw_query, DocumentStatus status, std::vector<Document>& result);
+	void AddFindRequest(const std::string& raw_query, std::vector<Document>& result);
+
+	// Для запросов, выполненных в обход очереди
+	void AddRequest(size_t document_count, Clock::duration latency, Clock::time_point finish_time);
+
+	// Число пустых ответов среди последних GetCapacity() запросов
 	int GetNoResultRequests() const;
+	size_t GetCapacity() const;
+
+	Statistics GetStatistics(Clock::duration window) const;
+	Statistics GetStatistics(Clock::duration window, Clock::time_point now) const;
 
 private:
-	struct QueryResult {
-		std::vector<Document> result;
+	// Слот защищён счётчиком версий: нечётное значение — запись в процессе,
+	// 2 * (номер запроса + 1) — слот содержит этот запрос
+	struct Slot {
+		std::atomic<uint64_t> sequence{ 0 };
+		std::atomic<int64_t> finish_time{ 0 };
+		std::atomic<int64_t> latency{ 0 };
+		std::atomic<uint32_t> document_count{ 0 };
 	};
-	std::deque<QueryResult> requests_;
+	struct Record {
+		int64_t finish_time;
+		int64_t latency;
+		uint32_t document_count;
+	};
+
 	constexpr static int sec_in_day_ = 1440;
-	int num_of_null_query_;
 	const SearchServer& search_server_;
+	std::vector<Slot> slots_;
+	std::atomic<uint64_t> next_request_{ 0 };
 
-	void AddRequest(const QueryResult& request);
-};
\ No newline at end of file
+	template <typename Callback>
+	void ForEachRecord(Callback callback) const;
+};
@@ -0,0 +1,106 @@
+#include "search_cursor.h"
+
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+
+using namespace std;
+
+SearchCursor::SearchCursor(const SearchServer& search_server, string raw_query, DocumentStatus status, size_t page_size)
+	: SearchCursor(
+		search_server,
+		move(raw_query),
+		[status](int, DocumentStatus document_status, int) {
+			return document_status == status;
+		},
+		page_size)
+{
+}
+
+SearchCursor::SearchCursor(const SearchServer& search_server, string raw_query, Filter filter, size_t page_size)
+	: search_server_(search_server)
+	, raw_query_(move(raw_query))
+	, filter_(move(filter))
+	, page_size_(page_size)
+{
+	if (page_size_ == 0) {
+		throw invalid_argument("Page size must be positive"s);
+	}
+}
+
+const vector<Document>& SearchCursor::NextPage() {
+	return GetPage(next_page_);
+}
+
+const vector<Document>& SearchCursor::GetPage(size_t page_index) {
+	if (page_index <= page_ends_.size()) {
+		FetchPage(page_index);
+	} else if (exhausted_) {
+		page_.clear();
+	} else {
+		FetchPagesThrough(page_index);
+	}
+	next_page_ = page_index + 1;
+	return page_;
+}
+
+optional<SearchServer::SearchPosition> SearchCursor::GetPosition() const {
+	if (next_page_ == 0 || page_ends_.empty()) {
+		return nullopt;
+	}
+	return page_ends_[min(next_page_, page_ends_.size()) - 1];
+}
+
+size_t SearchCursor::GetPageSize() const {
+	return page_size_;
+}
+
+namespace {
+
+SearchServer::SearchPosition GetSearchPosition(const Document& document) {
+	return { document.relevance, document.rating, document.id };
+}
+
+}
+
+void SearchCursor::FetchPage(size_t page_index) {
+	const optional<SearchServer::SearchPosition> after = page_index == 0 ? nullopt : optional(page_ends_[page_index - 1]);
+	search_server_.FindDocumentsAfter(raw_query_, filter_, after, page_size_, page_);
+	if (page_.empty()) {
+		exhausted_ = true;
+		page_ends_.resize(page_index);
+		return;
+	}
+	const SearchServer::SearchPosition end = GetSearchPosition(page_.back());
+	if (page_index == page_ends_.size()) {
+		page_ends_.push_back(end);
+		return;
+	}
+	const SearchServer::SearchPosition& known_end = page_ends_[page_index];
+	if (end.document_id != known_end.document_id || end.relevance != known_end.relevance || end.rating != known_end.rating) {
+		// индекс изменился: следующие страницы начинаются уже не там
+		page_ends_.resize(page_index + 1);
+		page_ends_[page_index] = end;
+		exhausted_ = false;
+	}
+}
+
+void SearchCursor::FetchPagesThrough(size_t page_index) {
+	const size_t first_page = page_ends_.size();
+	const size_t page_count = page_index - first_page + 1;
+	const size_t limit = page_count > SIZE_MAX / page_size_ ? SIZE_MAX : page_count * page_size_;
+	const optional<SearchServer::SearchPosition> after = first_page == 0 ? nullopt : optional(page_ends_.back());
+	search_server_.FindDocumentsAfter(raw_query_, filter_, after, limit, pages_buffer_);
+
+	for (size_t page_begin = 0; page_begin < pages_buffer_.size(); page_begin += page_size_) {
+		const size_t page_end = min(pages_buffer_.size(), page_begin + page_size_);
+		page_ends_.push_back(GetSearchPosition(pages_buffer_[page_end - 1]));
+	}
+	const size_t target_page = page_index - first_page;
+	if (target_page < page_ends_.size() - first_page) {
+		page_.assign(pages_buffer_.begin() + target_page * page_size_, pages_buffer_.end());
+	} else {
+		page_.clear();
+		exhausted_ = true;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Постраничная выдача одного запроса в полном порядке SearchServer::SearchPosition.
+// Каждая страница ищется заново после последнего документа предыдущей (search-after),
+// курсор хранит только позиции концов пройденных страниц. Между страницами индекс может
+// меняться: документы не повторяются, новые документы появляются на своих местах впереди
+class SearchCursor {
+public:
+	using Filter = std::function<bool(int, DocumentStatus, int)>;
+
+	SearchCursor(const SearchServer& search_server, std::string raw_query, DocumentStatus status = DocumentStatus::ACTUAL, size_t page_size = MAX_RESULT_DOCUMENT_COUNT);
+	SearchCursor(const SearchServer& search_server, std::string raw_query, Filter filter, size_t page_size = MAX_RESULT_DOCUMENT_COUNT);
+
+	// Следующая страница; пустая — документы закончились
+	const std::vector<Document>& NextPage();
+	// Страница с номером page_index (с нуля). Непройденные страницы перед ней находятся
+	// вместе с ней за один обход индекса, который держит лучшие документы всех этих страниц.
+	// Повторный запрос пройденной страницы ищет её заново; если её конец сдвинулся,
+	// концы следующих страниц забываются
+	const std::vector<Document>& GetPage(size_t page_index);
+
+	// Позиция после последней выданной страницы; её можно отдать клиенту и продолжить
+	// выдачу через SearchServer::FindDocumentsAfter
+	std::optional<SearchServer::SearchPosition> GetPosition() const;
+	size_t GetPageSize() const;
+
+private:
+	const SearchServer& search_server_;
+	std::string raw_query_;
+	Filter filter_;
+	size_t page_size_;
+	// page_ends_[i] — последний документ страницы i
+	std::vector<SearchServer::SearchPosition> page_ends_;
+	bool exhausted_ = false;
+	size_t next_page_ = 0;
+	std::vector<Document> page_;
+	std::vector<Document> pages_buffer_;
+
+	// Страница, конец предыдущей из которых известен
+	void FetchPage(size_t page_index);
+	// Все страницы от первой непройденной до page_index одним обходом
+	void FetchPagesThrough(size_t page_index);
+};
\ No newline at end of file
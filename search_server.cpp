@@ -1,17 +1,497 @@
 #include "search_server.h"
+#include "huge_page_resource.h"
 
+#include <atomic>
 #include <cmath>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
 
 using namespace std;
 
-SearchServer::SearchServer(const string& stop_words_text)
-	: SearchServer(SplitIntoWords(stop_words_text)) 
+SearchServer::SearchServer()
+	: SearchServer(vector<string>())
 {}
 
-SearchServer::SearchServer(const string_view& stop_words_text)
-	: SearchServer(SplitIntoWords(stop_words_text)) 
+SearchServer::SearchServer(pmr::memory_resource* resource)
+	: SearchServer(vector<string>(), resource)
 {}
 
+SearchServer::SearchServer(const string& stop_words_text, pmr::memory_resource* resource)
+	: SearchServer(SplitIntoWords(stop_words_text), resource) 
+{}
+
+SearchServer::SearchServer(const string_view& stop_words_text, pmr::memory_resource* resource)
+	: SearchServer(SplitIntoWords(stop_words_text), resource) 
+{}
+
+namespace {
+
+// Размер первого блока арены копии: узлы списков и документов с частотами, словарь.
+// Оценка с запасом, чтобы индекс лёг в один непрерывный блок
+size_t EstimateArenaSize(size_t posting_count, size_t document_count, size_t word_count, size_t word_bytes) {
+	constexpr size_t NODE_SIZE = 64;
+	constexpr size_t WORD_FREQ_SIZE = sizeof(pair<string_view, double>);
+	return posting_count * (NODE_SIZE + WORD_FREQ_SIZE) + document_count * NODE_SIZE + word_count * 3 * NODE_SIZE + word_bytes;
+}
+
+// Нарушения из параллельных проверок: считаются все, из текстов хранятся max_count наименьших.
+// Набор не зависит от того, в каком порядке потоки находят нарушения
+class ViolationCollector {
+public:
+	explicit ViolationCollector(size_t max_count)
+		: max_count_(max_count)
+	{
+	}
+
+	template <typename MessageBuilder>
+	void Add(MessageBuilder build_message) {
+		count_.fetch_add(1, memory_order_relaxed);
+		if (max_count_ == 0) {
+			return;
+		}
+		string message = build_message();
+		lock_guard guard(mutex_);
+		// куча с наибольшим из хранимых текстов на вершине
+		if (messages_.size() < max_count_) {
+			messages_.push_back(move(message));
+			push_heap(messages_.begin(), messages_.end());
+		} else if (message < messages_.front()) {
+			pop_heap(messages_.begin(), messages_.end());
+			messages_.back() = move(message);
+			push_heap(messages_.begin(), messages_.end());
+		}
+	}
+
+	size_t GetCount() const {
+		return count_.load(memory_order_relaxed);
+	}
+
+	vector<string> TakeMessages() {
+		sort_heap(messages_.begin(), messages_.end());
+		return move(messages_);
+	}
+
+private:
+	size_t max_count_;
+	atomic<size_t> count_{ 0 };
+	mutex mutex_;
+	vector<string> messages_;
+};
+
+}
+
+unique_ptr<pmr::unsynchronized_pool_resource> SearchServer::MakeArenaPool(pmr::memory_resource* arena) {
+	pmr::pool_options options;
+	options.largest_required_pool_block = ARENA_POOL_LARGEST_BLOCK;
+	return make_unique<pmr::unsynchronized_pool_resource>(options, arena);
+}
+
+SearchServer::SearchServer(const SearchServer& source, const ReorganizeOptions& options)
+	: own_upstream_(options.use_huge_pages ? make_unique<HugePageResource>() : nullptr)
+	, arena_counter_(make_unique<CountingResource>(own_upstream_ != nullptr ? own_upstream_.get() : pmr::get_default_resource()))
+	, own_resource_(make_unique<pmr::monotonic_buffer_resource>(
+		EstimateArenaSize(
+			accumulate(source.documents_.begin(), source.documents_.end(), size_t{ 0 },
+				[](size_t sum, const auto& document) {
+					return sum + document.second.word_freqs.size();
+				}
+			),
+			source.documents_.size(), source.words_.size(), source.word_pool_.GetUsedBytes()),
+		arena_counter_.get()))
+	, own_pool_(MakeArenaPool(own_resource_.get()))
+	, resource_(own_pool_.get())
+	, stop_words_(source.stop_words_)
+{
+	// горячесть списка — число вхождений слова в выборку запросов, затем длина списка
+	map<string_view, size_t> sample_hits;
+	for (const string& raw_query : options.query_sample) {
+		try {
+			const Query query = source.ParseQuery(execution::seq, raw_query);
+			for (const auto* words : { &query.plus_words, &query.minus_words }) {
+				for (const string& word : *words) {
+					const auto word_it = source.word_to_document_freqs_.find(word);
+					if (word_it != source.word_to_document_freqs_.end()) {
+						++sample_hits[word_it->first];
+					}
+				}
+			}
+		} catch (const invalid_argument&) {
+		}
+	}
+	vector<const pair<const string_view, pmr::map<int, double>>*> postings_order;
+	for (const auto& word_postings : source.word_to_document_freqs_) {
+		postings_order.push_back(&word_postings);
+	}
+	const auto get_hits = [&sample_hits](string_view word) {
+		const auto it = sample_hits.find(word);
+		return it == sample_hits.end() ? size_t{ 0 } : it->second;
+	};
+	stable_sort(postings_order.begin(), postings_order.end(),
+		[&get_hits](const auto* lhs, const auto* rhs) {
+			return make_pair(get_hits(lhs->first), lhs->second.size()) > make_pair(get_hits(rhs->first), rhs->second.size());
+		}
+	);
+
+	// словарь в том же порядке, затем слова удалённых документов
+	for (const auto* word_postings : postings_order) {
+		words_.insert(word_pool_.Add(word_postings->first));
+	}
+	for (const string_view word : source.words_) {
+		if (words_.count(word) == 0) {
+			words_.insert(word_pool_.Add(word));
+		}
+	}
+	const auto own_word = [this](string_view word) {
+		return *words_.find(word);
+	};
+
+	for (const auto* word_postings : postings_order) {
+		auto& postings = word_to_document_freqs_[own_word(word_postings->first)];
+		for (const auto& [document_id, term_freq] : word_postings->second) {
+			postings.emplace_hint(postings.end(), document_id, term_freq);
+		}
+	}
+	impact_ordered_postings_ = source.impact_ordered_postings_;
+	if (impact_ordered_postings_) {
+		for (const auto* word_postings : postings_order) {
+			const ImpactPostings& impact_postings = source.word_to_impact_postings_.at(word_postings->first);
+			word_to_impact_postings_.emplace(
+				piecewise_construct,
+				forward_as_tuple(own_word(word_postings->first)),
+				forward_as_tuple(impact_postings.begin(), impact_postings.end())
+			);
+		}
+	}
+
+	// каждый документ вместе со своими частотами, по возрастанию id
+	for (const auto& [document_id, data] : source.documents_) {
+		WordFrequencies word_freqs(&memory_counters_->documents);
+		word_freqs.reserve(data.word_freqs.size());
+		for (const auto& [word, term_freq] : data.word_freqs) {
+			word_freqs.emplace_back(own_word(word), term_freq);
+		}
+		documents_.emplace_hint(documents_.end(), document_id, DocumentData{ data.rating, data.status, move(word_freqs) });
+	}
+	document_ids_ = source.document_ids_;
+	SetFuzzyEditDistance(source.GetFuzzyEditDistance());
+
+	status_documents_ = source.status_documents_;
+	rating_bucket_width_ = source.rating_bucket_width_;
+	rating_bucket_documents_ = source.rating_bucket_documents_;
+
+	// опубликованная статистика переносится как есть, чтобы IDF копии совпадал с source
+	epoch_options_ = source.epoch_options_;
+	statistics_epoch_ = source.statistics_epoch_;
+	change_count_ = source.change_count_;
+	published_document_count_ = source.published_document_count_;
+	for (const auto& [word, document_freq] : source.published_document_freqs_) {
+		published_document_freqs_.emplace_hint(published_document_freqs_.end(), own_word(word), document_freq);
+	}
+	for (const string_view word : source.unpublished_words_) {
+		unpublished_words_.push_back(own_word(word));
+	}
+	unpublished_change_count_ = source.unpublished_change_count_;
+	last_publish_time_ = source.last_publish_time_;
+}
+
+SearchServer::MemoryStats SearchServer::GetMemoryStats() const {
+	MemoryStats stats;
+	// хвост текущего блока пула выделен, но словом не занят
+	const size_t word_pool_slack = word_pool_.GetAllocatedBytes() - word_pool_.GetUsedBytes();
+	stats.dictionary = memory_counters_->dictionary.GetAllocatedBytes() - word_pool_slack
+		+ fuzzy_index_.GetMemoryBytes() + stop_words_.GetMemoryBytes();
+	stats.postings = memory_counters_->postings.GetAllocatedBytes();
+	stats.documents = memory_counters_->documents.GetAllocatedBytes() + document_ids_.capacity() * sizeof(int);
+
+	// узел std::map: три указателя и цвет перед элементом
+	constexpr size_t MAP_NODE_OVERHEAD = 4 * sizeof(void*);
+	stats.caches = memory_counters_->caches.GetAllocatedBytes();
+	for (const DocumentIdBitmap& documents : status_documents_) {
+		stats.caches += documents.GetMemoryBytes();
+	}
+	for (const auto& [_, documents] : rating_bucket_documents_) {
+		stats.caches += MAP_NODE_OVERHEAD + sizeof(*rating_bucket_documents_.begin()) + documents.GetMemoryBytes();
+	}
+	stats.caches += unpublished_words_.capacity() * sizeof(string_view);
+
+	stats.slack = word_pool_slack;
+	if (arena_counter_ != nullptr) {
+		const size_t live_bytes = memory_counters_->dictionary.GetAllocatedBytes() + memory_counters_->postings.GetAllocatedBytes()
+			+ memory_counters_->documents.GetAllocatedBytes() + memory_counters_->caches.GetAllocatedBytes();
+		stats.slack += arena_counter_->GetAllocatedBytes() - live_bytes;
+	}
+	return stats;
+}
+
+SearchServer::VerificationReport SearchServer::Verify(size_t max_violations) const {
+	return VerifyIndex(execution::par, max_violations);
+}
+
+SearchServer::VerificationReport SearchServer::Verify(const execution::sequenced_policy& policy, size_t max_violations) const {
+	return VerifyIndex(policy, max_violations);
+}
+
+SearchServer::VerificationReport SearchServer::Verify(const execution::parallel_policy& policy, size_t max_violations) const {
+	return VerifyIndex(policy, max_violations);
+}
+
+template <typename Policy>
+SearchServer::VerificationReport SearchServer::VerifyIndex(const Policy& policy, size_t max_violations) const {
+	ViolationCollector violations(max_violations);
+	const auto document_name = [](int document_id) {
+		return "document "s + to_string(document_id);
+	};
+	const auto word_name = [](string_view word) {
+		return "word '"s + string(word) + "'"s;
+	};
+
+	using DocumentEntry = const pair<const int, DocumentData>*;
+	using WordEntry = const pair<const string_view, pmr::map<int, double>>*;
+	vector<DocumentEntry> documents;
+	documents.reserve(documents_.size());
+	for (const auto& document : documents_) {
+		documents.push_back(&document);
+	}
+	// номер слова — его место в word_to_document_freqs_; слова документов находятся по адресу в пуле,
+	// поэтому неинтернированное слово тоже окажется без номера
+	vector<WordEntry> words;
+	words.reserve(word_to_document_freqs_.size());
+	unordered_map<const char*, uint32_t> word_ranks;
+	word_ranks.reserve(word_to_document_freqs_.size());
+	for (const auto& word_postings : word_to_document_freqs_) {
+		word_ranks.emplace(word_postings.first.data(), static_cast<uint32_t>(words.size()));
+		words.push_back(&word_postings);
+	}
+
+	// порядок добавления — перестановка ключей таблицы документов
+	{
+		vector<int> ordered_ids = document_ids_;
+		sort(policy, ordered_ids.begin(), ordered_ids.end());
+		for (auto it = adjacent_find(ordered_ids.begin(), ordered_ids.end()); it != ordered_ids.end(); it = adjacent_find(it + 1, ordered_ids.end())) {
+			violations.Add([&] { return "document order lists "s + document_name(*it) + " twice"s; });
+		}
+		ordered_ids.erase(unique(ordered_ids.begin(), ordered_ids.end()), ordered_ids.end());
+		auto document_it = documents.begin();
+		for (const int document_id : ordered_ids) {
+			for (; document_it != documents.end() && (*document_it)->first < document_id; ++document_it) {
+				violations.Add([&] { return document_name((*document_it)->first) + " is missing from the document order"s; });
+			}
+			if (document_it != documents.end() && (*document_it)->first == document_id) {
+				++document_it;
+			} else {
+				violations.Add([&] { return "document order lists "s + document_name(document_id) + " missing from the document table"s; });
+			}
+		}
+		for (; document_it != documents.end(); ++document_it) {
+			violations.Add([&] { return document_name((*document_it)->first) + " is missing from the document order"s; });
+		}
+	}
+
+	// Прямой индекс раскладывается по номерам слов подсчётом: сначала размеры групп, затем записи
+	struct ForwardEntry {
+		double term_freq;
+		int document_id;
+		int rating;
+	};
+	vector<atomic<uint32_t>> word_entry_counts(words.size());
+	for_each(policy, documents.begin(), documents.end(), [&](DocumentEntry document) {
+		const int document_id = document->first;
+		const DocumentData& data = document->second;
+		const auto name = [&] { return document_name(document_id); };
+		if (document_id < 0) {
+			violations.Add([&] { return name() + " has a negative id"s; });
+		}
+		if (static_cast<int>(data.status) < 0 || static_cast<size_t>(data.status) >= status_documents_.size()) {
+			violations.Add([&] { return name() + " has an invalid status"s; });
+		} else if (!status_documents_[static_cast<size_t>(data.status)].Test(document_id)) {
+			violations.Add([&] { return name() + " is missing from its status facet"s; });
+		}
+		const auto bucket_it = rating_bucket_documents_.find(GetRatingBucket(data.rating));
+		if (bucket_it == rating_bucket_documents_.end() || !bucket_it->second.Test(document_id)) {
+			violations.Add([&] { return name() + " is missing from its rating bucket"s; });
+		}
+
+		double term_freq_sum = 0.0;
+		for (size_t i = 0; i < data.word_freqs.size(); ++i) {
+			const auto& [word, term_freq] = data.word_freqs[i];
+			term_freq_sum += term_freq;
+			if (i > 0 && !(data.word_freqs[i - 1].first < word)) {
+				violations.Add([&] { return "words of "s + name() + " are not strictly sorted at "s + word_name(word); });
+			}
+			if (IsStopWord(word)) {
+				violations.Add([&] { return name() + " indexes stop "s + word_name(word); });
+			}
+			if (!(term_freq > 0.0 && term_freq <= 1.0)) {
+				violations.Add([&] { return name() + " has term frequency "s + to_string(term_freq) + " for "s + word_name(word); });
+			}
+
+			const auto rank_it = word_ranks.find(word.data());
+			if (rank_it != word_ranks.end()) {
+				word_entry_counts[rank_it->second].fetch_add(1, memory_order_relaxed);
+			} else if (words_.count(word) == 0) {
+				violations.Add([&] { return word_name(word) + " of "s + name() + " is missing from the dictionary"s; });
+			} else if (word_to_document_freqs_.count(word) == 0) {
+				violations.Add([&] { return name() + " is missing from postings of "s + word_name(word); });
+			} else {
+				violations.Add([&] { return word_name(word) + " of "s + name() + " is not interned in the dictionary"s; });
+			}
+		}
+		// частоты документа — доли его слов, в сумме единица
+		if (!data.word_freqs.empty() && abs(term_freq_sum - 1.0) > 1e-9 * data.word_freqs.size()) {
+			violations.Add([&] { return "term frequencies of "s + name() + " sum to "s + to_string(term_freq_sum); });
+		}
+	});
+
+	vector<size_t> word_entry_offsets(words.size() + 1, 0);
+	for (size_t rank = 0; rank < words.size(); ++rank) {
+		word_entry_offsets[rank + 1] = word_entry_offsets[rank] + word_entry_counts[rank].load(memory_order_relaxed);
+		word_entry_counts[rank].store(0, memory_order_relaxed);
+	}
+	vector<ForwardEntry> forward_entries(word_entry_offsets.back());
+	for_each(policy, documents.begin(), documents.end(), [&](DocumentEntry document) {
+		for (const auto& [word, term_freq] : document->second.word_freqs) {
+			const auto rank_it = word_ranks.find(word.data());
+			if (rank_it != word_ranks.end()) {
+				const size_t position = word_entry_offsets[rank_it->second] + word_entry_counts[rank_it->second].fetch_add(1, memory_order_relaxed);
+				forward_entries[position] = { term_freq, document->first, document->second.rating };
+			}
+		}
+	});
+
+	// Каждый список документов слова сливается с его группой прямого индекса: расхождения — записи
+	// только с одной стороны или с разной частотой. Равенство групп означает и верную частоту слова
+	const bool checks_published_freqs = UsesStatisticsEpochs() && unpublished_words_.empty() && unpublished_change_count_ == 0;
+	for_each(policy, words.begin(), words.end(), [&](WordEntry word_postings) {
+		const string_view word = word_postings->first;
+		const auto& documents_of_word = word_postings->second;
+		const size_t rank = word_ranks.at(word.data());
+		const auto name = [&] { return "postings of "s + word_name(word); };
+		if (documents_of_word.empty()) {
+			violations.Add([&] { return "empty "s + name() + " are kept"s; });
+		}
+		const auto dictionary_it = words_.find(word);
+		if (dictionary_it == words_.end()) {
+			violations.Add([&] { return word_name(word) + " of postings is missing from the dictionary"s; });
+		} else if (dictionary_it->data() != word.data()) {
+			violations.Add([&] { return word_name(word) + " of postings is not interned in the dictionary"s; });
+		}
+
+		const auto entries_begin = forward_entries.begin() + word_entry_offsets[rank];
+		const auto entries_end = forward_entries.begin() + word_entry_offsets[rank + 1];
+		sort(entries_begin, entries_end, [](const ForwardEntry& lhs, const ForwardEntry& rhs) {
+			return lhs.document_id < rhs.document_id;
+		});
+		auto entry_it = entries_begin;
+		for (const auto& [document_id, term_freq] : documents_of_word) {
+			for (; entry_it != entries_end && entry_it->document_id < document_id; ++entry_it) {
+				violations.Add([&] { return document_name(entry_it->document_id) + " is missing from "s + name(); });
+			}
+			if (entry_it != entries_end && entry_it->document_id == document_id) {
+				if (entry_it->term_freq != term_freq) {
+					violations.Add([&] { return name() + " disagree with "s + document_name(document_id) + " on term frequency"s; });
+				}
+				++entry_it;
+			} else if (documents_.count(document_id) == 0) {
+				violations.Add([&] { return name() + " reference missing "s + document_name(document_id); });
+			} else {
+				violations.Add([&] { return name() + " list "s + document_name(document_id) + " which does not contain it"s; });
+			}
+		}
+		for (; entry_it != entries_end; ++entry_it) {
+			violations.Add([&] { return document_name(entry_it->document_id) + " is missing from "s + name(); });
+		}
+
+		if (impact_ordered_postings_) {
+			const auto impact_it = word_to_impact_postings_.find(word);
+			vector<ImpactPosting> impact_postings;
+			if (impact_it != word_to_impact_postings_.end()) {
+				impact_postings.assign(impact_it->second.begin(), impact_it->second.end());
+			}
+			sort(impact_postings.begin(), impact_postings.end(), [](const ImpactPosting& lhs, const ImpactPosting& rhs) {
+				return lhs.document_id < rhs.document_id;
+			});
+			const bool matches = equal(impact_postings.begin(), impact_postings.end(), entries_begin, entries_end,
+				[](const ImpactPosting& posting, const ForwardEntry& entry) {
+					return posting.document_id == entry.document_id && posting.term_freq == entry.term_freq && posting.rating == entry.rating;
+				}
+			);
+			if (!matches) {
+				violations.Add([&] { return "impact-ordered "s + name() + " disagree with the documents"s; });
+			}
+		}
+		if (checks_published_freqs && GetPublishedDocumentFreq(word) != static_cast<int>(documents_of_word.size())) {
+			violations.Add([&] {
+				return "published document frequency of "s + word_name(word) + " is "s + to_string(GetPublishedDocumentFreq(word))
+					+ ", index has "s + to_string(documents_of_word.size());
+			});
+		}
+	});
+
+	// суммы: вместе с проверками по элементам исключают лишние записи
+	size_t posting_count = 0;
+	for (const WordEntry word_postings : words) {
+		posting_count += word_postings->second.size();
+	}
+	size_t forward_entry_count = 0;
+	for (const DocumentEntry document : documents) {
+		forward_entry_count += document->second.word_freqs.size();
+	}
+	if (posting_count != forward_entry_count) {
+		violations.Add([&] {
+			return "postings hold "s + to_string(posting_count) + " entries, documents list "s + to_string(forward_entry_count) + " words"s;
+		});
+	}
+	size_t status_document_count = 0;
+	for (const DocumentIdBitmap& status_documents : status_documents_) {
+		status_document_count += status_documents.Count();
+	}
+	size_t bucket_document_count = 0;
+	for (const auto& [_, bucket_documents] : rating_bucket_documents_) {
+		bucket_document_count += bucket_documents.Count();
+	}
+	if (status_document_count != documents_.size() || bucket_document_count != documents_.size()) {
+		violations.Add([&] {
+			return "facets hold "s + to_string(status_document_count) + " documents by status and "s + to_string(bucket_document_count)
+				+ " by rating for "s + to_string(documents_.size()) + " documents"s;
+		});
+	}
+	if (impact_ordered_postings_ ? word_to_impact_postings_.size() != word_to_document_freqs_.size() : !word_to_impact_postings_.empty()) {
+		violations.Add([&] { return "impact-ordered postings cover "s + to_string(word_to_impact_postings_.size()) + " words"s; });
+	}
+	if (!UsesStatisticsEpochs() && !published_document_freqs_.empty()) {
+		violations.Add([] { return "published document frequencies are kept without statistics epochs"s; });
+	}
+	if (checks_published_freqs && (published_document_freqs_.size() != word_to_document_freqs_.size() || published_document_count_ != GetDocumentCount())) {
+		violations.Add([&] {
+			return "published statistics cover "s + to_string(published_document_freqs_.size()) + " words and "s
+				+ to_string(published_document_count_) + " documents"s;
+		});
+	}
+	if (fuzzy_index_.GetMaxDistance() > 0 && fuzzy_index_.GetTermCount() != words_.size()) {
+		violations.Add([&] {
+			return "typo index holds "s + to_string(fuzzy_index_.GetTermCount()) + " words, dictionary has "s + to_string(words_.size());
+		});
+	}
+
+	VerificationReport report;
+	report.document_count = documents_.size();
+	report.word_count = word_to_document_freqs_.size();
+	report.posting_count = posting_count;
+	report.retired_word_count = words_.size() > report.word_count ? words_.size() - report.word_count : 0;
+	report.violation_count = violations.GetCount();
+	report.violations = violations.TakeMessages();
+	return report;
+}
+
+SearchServer SearchServer::Reorganize(const SearchServer& source) {
+	return SearchServer(source, ReorganizeOptions());
+}
+
+SearchServer SearchServer::Reorganize(const SearchServer& source, const ReorganizeOptions& options) {
+	return SearchServer(source, options);
+}
+
 void SearchServer::AddDocument(int document_id, const string_view& document, DocumentStatus status, const vector<int>& ratings) {
 	if (document_id < 0) {
 		throw invalid_argument("ID < 0"s);
@@ -19,26 +499,69 @@ void SearchServer::AddDocument(int document_id, const string_view& document, Doc
 	if (documents_.count(document_id) > 0) {
 		throw invalid_argument("A document with this ID already exists"s);
 	}
+	AddTokenizedDocument(document_id, TokenizeDocument(document), status, ratings);
+}
+
+vector<string_view> SearchServer::TokenizeDocument(const string_view& document) const {
+	vector<string_view> words = SplitIntoWordsNoStop(document);
+	sort(words.begin(), words.end());
+	return words;
+}
 
-	map<string_view, double> word_freqs_of_new_document;
-	const vector<string> words = SplitIntoWordsNoStop(execution::seq, document);
+void SearchServer::AddTokenizedDocument(int document_id, const vector<string_view>& words, DocumentStatus status, const vector<int>& ratings) {
+	if (document_id < 0) {
+		throw invalid_argument("ID < 0"s);
+	}
+	if (documents_.count(document_id) > 0) {
+		throw invalid_argument("A document with this ID already exists"s);
+	}
+	if (!is_sorted(words.begin(), words.end())) {
+		throw invalid_argument("Tokenized document words must be sorted"s);
+	}
 	const double inv_word_count = 1.0 / words.size();
-	for (const string_view& word : words) {
-		if (!words_.count(word)) {
-			words_.insert(static_cast<string>(word));
+
+	// частоты документа лежат одним непрерывным блоком в арене, упорядоченные по слову
+	size_t unique_word_count = 0;
+	for (size_t i = 0; i < words.size(); ++i) {
+		if (i == 0 || words[i] != words[i - 1]) {
+			++unique_word_count;
 		}
-		word_freqs_of_new_document[*words_.find(word)] += inv_word_count;
 	}
+	WordFrequencies word_freqs_of_new_document(&memory_counters_->documents);
+	word_freqs_of_new_document.reserve(unique_word_count);
+	for (size_t i = 0; i < words.size();) {
+		size_t j = i;
+		while (j < words.size() && words[j] == words[i]) {
+			++j;
+		}
 
-	documents_.emplace(
+		auto word_it = words_.find(words[i]);
+		if (word_it == words_.end()) {
+			word_it = words_.insert(word_pool_.Add(words[i])).first;
+			if (fuzzy_index_.GetMaxDistance() > 0) {
+				fuzzy_index_.AddTerm(*word_it);
+			}
+		}
+		word_freqs_of_new_document.emplace_back(*word_it, (j - i) * inv_word_count);
+		i = j;
+	}
+	NoteStatisticsChange(word_freqs_of_new_document);
+	for (const auto& [word, term_freq] : word_freqs_of_new_document) {
+		word_to_document_freqs_[word][document_id] = term_freq;
+	}
+
+	const auto [document_it, _] = documents_.emplace(
 		document_id,
 		DocumentData{
 			ComputeAverageRating(ratings),
 			status,
-			word_freqs_of_new_document
+			move(word_freqs_of_new_document)
 		}
 	);
+	AddImpactPostings(document_id, document_it->second);
+	AddToFacets(document_id, document_it->second);
 	document_ids_.push_back(document_id);
+	FinishStatisticsChange();
 }
 
 vector<Document> SearchServer::FindTopDocuments(const std::string_view& raw_query) const {
@@ -61,6 +584,43 @@ vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query, Do
 	);
 }
 
+vector<Document> SearchServer::FindTopDocuments(const string_view& raw_query, QueryMode mode) const {
+	return FindTopDocuments(
+		execution::seq,
+		raw_query,
+		mode,
+		[](int, DocumentStatus document_status, int) {
+			return document_status == DocumentStatus::ACTUAL;
+		}
+	);
+}
+
+void SearchServer::FillTopDocuments(const string_view& raw_query, vector<Document>& result) const {
+	FillTopDocuments(
+		execution::seq,
+		raw_query,
+		[](int, DocumentStatus document_status, int) {
+			return document_status == DocumentStatus::ACTUAL;
+		},
+		result
+	);
+}
+
+void SearchServer::FillTopDocuments(const string_view& raw_query, DocumentStatus status, vector<Document>& result) const {
+	FillTopDocuments(
+		execution::seq,
+		raw_query,
+		[status](int, DocumentStatus document_status, int) {
+			return document_status == status;
+		},
+		result
+	);
+}
+
+bool SearchServer::IsRankedBefore(const SearchPosition& lhs, const SearchPosition& rhs) {
+	return tie(rhs.relevance, rhs.rating, lhs.document_id) < tie(lhs.relevance, lhs.rating, rhs.document_id);
+}
+
 int SearchServer::GetDocumentCount() const {
 	return documents_.size();
 }
@@ -81,16 +641,98 @@ vector<int>::const_iterator SearchServer::end() const {
 	return document_ids_.end();
 }
 
-tuple<vector<string_view>, DocumentStatus> SearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
+SearchServer::MatchResult SearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
 	return MatchDocument(execution::seq, raw_query, document_id);
 }
 
+vector<SearchServer::MatchResult> SearchServer::MatchDocuments(const string_view& raw_query, const vector<int>& document_ids) const {
+	return MatchDocuments(execution::seq, raw_query, document_ids);
+}
+
+SearchServer::MatchResult SearchServer::MatchParsedQuery(const execution::sequenced_policy&, const Query& query, const DocumentData& data) const {
+	const auto& word_freqs = data.word_freqs;
+	const size_t query_size = query.plus_words.size() + query.minus_words.size();
+	// на длинном документе слова запроса ищутся галопом от предыдущей найденной позиции,
+	// на коротком выгоднее обычное слияние двух отсортированных последовательностей
+	const bool gallop = word_freqs.size() > GALLOP_DOCUMENT_RATIO * query_size;
+	const auto advance_to = [&word_freqs, gallop](auto first, const string_view& word) {
+		const auto less = [](const pair<string_view, double>& word_freq, const string_view& value) {
+			return word_freq.first < value;
+		};
+		if (!gallop) {
+			while (first != word_freqs.end() && less(*first, word)) {
+				++first;
+			}
+			return first;
+		}
+		size_t step = 1;
+		auto last = first;
+		while (static_cast<size_t>(word_freqs.end() - last) > step && less(*(last + step), word)) {
+			last += step;
+			step *= 2;
+		}
+		const auto bound = static_cast<size_t>(word_freqs.end() - last) > step ? last + step + 1 : word_freqs.end();
+		return lower_bound(last, bound, word, less);
+	};
+
+	auto position = word_freqs.begin();
+	for (const string& word : query.minus_words) {
+		position = advance_to(position, word);
+		if (position != word_freqs.end() && position->first == word) {
+			return { vector<string_view>(), data.status };
+		}
+	}
+
+	vector<string_view> matched_words;
+	position = word_freqs.begin();
+	for (const string& word : query.plus_words) {
+		position = advance_to(position, word);
+		if (position == word_freqs.end()) {
+			break;
+		}
+		if (position->first == word) {
+			matched_words.push_back(position->first);
+		}
+	}
+	// обязательные слова — часть плюс-слов, и оба списка упорядочены
+	if (!includes(matched_words.begin(), matched_words.end(), query.required_words.begin(), query.required_words.end())) {
+		matched_words.clear();
+	}
+
+	return { matched_words, data.status };
+}
+
+SearchServer::MatchResult SearchServer::MatchParsedQuery(const execution::parallel_policy& policy, const Query& query, const DocumentData& data) const {
+	const bool has_minus_word = any_of(policy, query.minus_words.begin(), query.minus_words.end(),
+		[&data](const string& word) {
+			return FindWord(data, word) != nullptr;
+		}
+	);
+	if (has_minus_word) {
+		return { vector<string_view>(), data.status };
+	}
+
+	vector<string_view> matched_words(query.plus_words.size());
+	transform(policy, query.plus_words.begin(), query.plus_words.end(), matched_words.begin(),
+		[&data](const string& word) {
+			const auto* word_freq = FindWord(data, word);
+			return word_freq != nullptr ? word_freq->first : string_view();
+		}
+	);
+	matched_words.erase(remove(matched_words.begin(), matched_words.end(), string_view()), matched_words.end());
+	if (!includes(matched_words.begin(), matched_words.end(), query.required_words.begin(), query.required_words.end())) {
+		matched_words.clear();
+	}
+
+	return { matched_words, data.status };
+}
+
 void SearchServer::RemoveDocument(int document_id) {
 	RemoveDocument(execution::seq, document_id);
 }
 
-const map<string_view, double>& SearchServer::GetWordToFrequencies(int document_id) const {
-	static const map<string_view, double> empty_result = map<string_view, double>();
+const SearchServer::WordFrequencies& SearchServer::GetWordToFrequencies(int document_id) const {
+	static const WordFrequencies empty_result;
 	if (!documents_.count(document_id)) {
 		return empty_result;
 	}
@@ -98,8 +740,102 @@ const map<string_view, double>& SearchServer::GetWordToFrequencies(int document_
 	return documents_.at(document_id).word_freqs;
 }
 
+void SearchServer::SetFuzzyEditDistance(int max_distance) {
+	if (max_distance == fuzzy_index_.GetMaxDistance()) {
+		return;
+	}
+	++change_count_;
+	if (max_distance == 0) {
+		fuzzy_index_ = DeletionIndex();
+		return;
+	}
+
+	DeletionIndex fuzzy_index(max_distance);
+	for (const string_view word : words_) {
+		fuzzy_index.AddTerm(word);
+	}
+	fuzzy_index_ = move(fuzzy_index);
+}
+
+int SearchServer::GetFuzzyEditDistance() const {
+	return fuzzy_index_.GetMaxDistance();
+}
+
+vector<string_view> SearchServer::FindFuzzyCandidates(const string_view& word) const {
+	vector<string_view> candidates;
+	int best_distance = 0;
+	for (const auto& [term, distance] : fuzzy_index_.FindTerms(word)) {
+		if (!candidates.empty() && distance > best_distance) {
+			break;
+		}
+		// словарь хранит и слова удалённых документов
+		if (CountDocumentsContainWord(term) > 0) {
+			candidates.push_back(term);
+			best_distance = distance;
+		}
+	}
+
+	return candidates;
+}
+
+vector<string_view> SearchServer::ExpandPlusWord(const QueryWord& query_word) const {
+	if (fuzzy_index_.GetMaxDistance() == 0 || CountDocumentsContainWord(query_word.data) > 0) {
+		return { query_word.data };
+	}
+	vector<string_view> candidates = FindFuzzyCandidates(query_word.data);
+	if (!query_word.is_required) {
+		return candidates;
+	}
+	if (candidates.empty()) {
+		// обязательное слово без документов оставляет выдачу пустой
+		return { query_word.data };
+	}
+	return { *max_element(candidates.begin(), candidates.end(),
+		[this](const string_view& lhs, const string_view& rhs) {
+			return CountDocumentsContainWord(lhs) < CountDocumentsContainWord(rhs);
+		}
+	) };
+}
+
 bool SearchServer::IsStopWord(const string_view& word) const {
-	return stop_words_.count(word) > 0;
+	return stop_words_.Contains(word);
+}
+
+vector<string_view> SearchServer::SplitIntoWordsNoStop(const string_view& text) const {
+	vector<string_view> words;
+	size_t word_begin = 0;
+	for (size_t i = 0; i <= text.size(); ++i) {
+		if (i == text.size() || text[i] == ' ') {
+			const string_view word = text.substr(word_begin, i - word_begin);
+			if (!stop_words_.Contains(word)) {
+				words.push_back(word);
+			}
+			word_begin = i + 1;
+		} else if (text[i] >= '\0' && text[i] < ' ') {
+			throw invalid_argument("SplitIntoWordsNoStop: text contains invalid characters"s);
+		}
+	}
+
+	return words;
+}
+
+const SearchServer::DocumentData& SearchServer::FindDocumentData(int document_id) const {
+	const auto it = documents_.find(document_id);
+	if (it == documents_.end()) {
+		throw out_of_range("MatchDocument: no document with this ID"s);
+	}
+
+	return it->second;
+}
+
+const pair<string_view, double>* SearchServer::FindWord(const DocumentData& data, const string_view& word) {
+	const auto it = lower_bound(data.word_freqs.begin(), data.word_freqs.end(), word,
+		[](const pair<string_view, double>& word_freq, const string_view& value) {
+			return word_freq.first < value;
+		}
+	);
+
+	return it != data.word_freqs.end() && it->first == word ? &*it : nullptr;
 }
 
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
@@ -116,16 +852,349 @@ int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
 }
 
 int SearchServer::CountDocumentsContainWord(const string_view& word) const {
-	int sum = 0;
-	for (const auto& [_, data] : documents_) {
-		if (data.word_freqs.count(word)) {
-			++sum;
-		}
+	const auto it = word_to_document_freqs_.find(word);
+	if (it == word_to_document_freqs_.end()) {
+		return 0;
 	}
 
-	return sum;
+	return static_cast<int>(it->second.size());
 }
 
-double SearchServer::ComputeWordInverseDocumentFreq(const string_view& word) const {
+double SearchServer::ComputeWordInverseDocumentFreq(const string_view& word, const TermStatistics* statistics) const {
+	if (statistics != nullptr) {
+		const auto it = statistics->document_freqs.find(word);
+		if (it != statistics->document_freqs.end() && it->second > 0) {
+			return log(static_cast<double>(statistics->document_count) / it->second);
+		}
+	}
+	const int document_freq = GetPublishedDocumentFreq(word);
+	if (document_freq > 0) {
+		return log(static_cast<double>(GetPublishedDocumentCount()) / document_freq);
+	}
+	// слово новее эпохи: его частота несопоставима с опубликованным числом документов
 	return log(static_cast<double>(GetDocumentCount()) / CountDocumentsContainWord(word));
+}
+
+void SearchServer::CollectTermStatistics(const string_view& raw_query, TermStatistics& statistics) const {
+	const Query query = ParseQuery(execution::seq, raw_query);
+	statistics.document_count += GetPublishedDocumentCount();
+	for (const string& word : query.plus_words) {
+		statistics.document_freqs[word] += GetPublishedDocumentFreq(word);
+	}
+}
+
+SearchServer::QueryCost SearchServer::EstimateQueryCost(const string_view& raw_query, QueryMode mode) const {
+	return EstimateQueryCost(raw_query, mode, QueryLimits{});
+}
+
+SearchServer::QueryCost SearchServer::EstimateQueryCost(const string_view& raw_query, QueryMode mode, const QueryLimits& limits) const {
+	Query query = ParseQuery(execution::seq, raw_query, mode);
+	LimitQuery(query, limits);
+	QueryCost cost;
+	cost.plus_word_count = query.plus_words.size();
+	for (const string& word : query.plus_words) {
+		cost.posting_count += CountDocumentsContainWord(word);
+	}
+	for (const string& word : query.minus_words) {
+		cost.posting_count += CountDocumentsContainWord(word);
+	}
+	return cost;
+}
+
+void SearchServer::LimitQuery(Query& query, const QueryLimits& limits) const {
+	if (query.plus_words.size() <= limits.max_plus_words) {
+		return;
+	}
+	vector<pair<int, const string*>> optional_words;
+	for (const string& word : query.plus_words) {
+		if (query.required_words.count(word) == 0) {
+			optional_words.emplace_back(CountDocumentsContainWord(word), &word);
+		}
+	}
+	const size_t kept_count = limits.max_plus_words > query.required_words.size() ? limits.max_plus_words - query.required_words.size() : 0;
+	if (kept_count >= optional_words.size()) {
+		return;
+	}
+	// самые редкие слова дают наибольший IDF и самые короткие списки
+	nth_element(optional_words.begin(), optional_words.begin() + kept_count, optional_words.end(),
+		[](const auto& lhs, const auto& rhs) {
+			return tie(lhs.first, *lhs.second) < tie(rhs.first, *rhs.second);
+		}
+	);
+	vector<string> dropped_words;
+	for (auto it = optional_words.begin() + kept_count; it != optional_words.end(); ++it) {
+		dropped_words.push_back(*it->second);
+	}
+	for (const string& word : dropped_words) {
+		query.plus_words.erase(word);
+	}
+}
+
+SearchServer::QueryAggregation SearchServer::AggregateDocuments(const string_view& raw_query, DocumentStatus aggregation_status, QueryMode mode) const {
+	const Query query = ParseQuery(execution::seq, raw_query, mode);
+	DocumentIdBitmap matched_documents;
+	if (!query.required_words.empty()) {
+		for (const int id : IntersectRequiredWords(query)) {
+			matched_documents.Set(id);
+		}
+	} else {
+		for (const string& word : query.plus_words) {
+			const auto word_it = word_to_document_freqs_.find(word);
+			if (word_it != word_to_document_freqs_.end()) {
+				matched_documents |= CollectPostingDocuments(word_it->second);
+			}
+		}
+	}
+	matched_documents -= CollectExcludedDocuments(query);
+
+	QueryAggregation aggregation;
+	for (size_t status = 0; status < status_documents_.size(); ++status) {
+		aggregation.status_counts[status] = static_cast<int>(matched_documents.CountIntersection(status_documents_[status]));
+	}
+	matched_documents &= status_documents_[static_cast<int>(aggregation_status)];
+	for (const auto& [bucket, bucket_documents] : rating_bucket_documents_) {
+		const int count = static_cast<int>(matched_documents.CountIntersection(bucket_documents));
+		if (count > 0) {
+			aggregation.rating_histogram[bucket] = count;
+		}
+	}
+	return aggregation;
+}
+
+void SearchServer::SetRatingBucketWidth(int width) {
+	if (width <= 0) {
+		throw invalid_argument("Rating bucket width must be positive"s);
+	}
+	rating_bucket_width_ = width;
+	rating_bucket_documents_.clear();
+	for (const auto& [document_id, data] : documents_) {
+		rating_bucket_documents_[GetRatingBucket(data.rating)].Set(document_id);
+	}
+}
+
+int SearchServer::GetRatingBucketWidth() const {
+	return rating_bucket_width_;
+}
+
+int SearchServer::GetRatingBucket(int rating) const {
+	// округление вниз и для отрицательных рейтингов
+	const int quotient = rating / rating_bucket_width_;
+	return (rating % rating_bucket_width_ < 0 ? quotient - 1 : quotient) * rating_bucket_width_;
+}
+
+void SearchServer::AddToFacets(int document_id, const DocumentData& data) {
+	status_documents_[static_cast<int>(data.status)].Set(document_id);
+	rating_bucket_documents_[GetRatingBucket(data.rating)].Set(document_id);
+}
+
+void SearchServer::RemoveFromFacets(int document_id, const DocumentData& data) {
+	status_documents_[static_cast<int>(data.status)].Reset(document_id);
+	const auto bucket_it = rating_bucket_documents_.find(GetRatingBucket(data.rating));
+	if (bucket_it != rating_bucket_documents_.end()) {
+		bucket_it->second.Reset(document_id);
+		// иначе каждый когда-либо встреченный рейтинг оставлял бы пустую корзину
+		if (bucket_it->second.IsEmpty()) {
+			rating_bucket_documents_.erase(bucket_it);
+		}
+	}
+}
+
+void SearchServer::SetImpactOrderedPostings(bool enabled) {
+	if (enabled == impact_ordered_postings_) {
+		return;
+	}
+	impact_ordered_postings_ = enabled;
+	word_to_impact_postings_.clear();
+	if (enabled) {
+		for (const auto& [document_id, data] : documents_) {
+			AddImpactPostings(document_id, data);
+		}
+	}
+}
+
+bool SearchServer::HasImpactOrderedPostings() const {
+	return impact_ordered_postings_;
+}
+
+void SearchServer::AddImpactPostings(int document_id, const DocumentData& data) {
+	if (!impact_ordered_postings_) {
+		return;
+	}
+	for (const auto& [word, term_freq] : data.word_freqs) {
+		word_to_impact_postings_[word].insert({ term_freq, data.rating, document_id });
+	}
+}
+
+void SearchServer::RemoveImpactPostings(int document_id, const DocumentData& data) {
+	if (!impact_ordered_postings_) {
+		return;
+	}
+	for (const auto& [word, term_freq] : data.word_freqs) {
+		const auto word_it = word_to_impact_postings_.find(word);
+		word_it->second.erase({ term_freq, data.rating, document_id });
+		if (word_it->second.empty()) {
+			word_to_impact_postings_.erase(word_it);
+		}
+	}
+}
+
+void SearchServer::SetStatisticsEpochOptions(const StatisticsEpochOptions& options) {
+	const bool used_epochs = UsesStatisticsEpochs();
+	epoch_options_ = options;
+	++change_count_;
+	if (!UsesStatisticsEpochs()) {
+		published_document_freqs_.clear();
+		unpublished_words_.clear();
+		unpublished_change_count_ = 0;
+		++statistics_epoch_;
+		return;
+	}
+	if (!used_epochs) {
+		// первая эпоха — полный снимок частот
+		published_document_freqs_.clear();
+		for (const auto& [word, documents] : word_to_document_freqs_) {
+			published_document_freqs_.emplace_hint(published_document_freqs_.end(), word, static_cast<int>(documents.size()));
+		}
+		published_document_count_ = GetDocumentCount();
+		unpublished_words_.clear();
+		unpublished_change_count_ = 0;
+		last_publish_time_ = chrono::steady_clock::now();
+		++statistics_epoch_;
+	}
+}
+
+const SearchServer::StatisticsEpochOptions& SearchServer::GetStatisticsEpochOptions() const {
+	return epoch_options_;
+}
+
+void SearchServer::PublishStatistics() {
+	++change_count_;
+	if (!UsesStatisticsEpochs()) {
+		++statistics_epoch_;
+		return;
+	}
+	for (const string_view word : unpublished_words_) {
+		const int document_freq = CountDocumentsContainWord(word);
+		if (document_freq > 0) {
+			published_document_freqs_[word] = document_freq;
+		} else {
+			published_document_freqs_.erase(word);
+		}
+	}
+	published_document_count_ = GetDocumentCount();
+	unpublished_words_.clear();
+	unpublished_change_count_ = 0;
+	last_publish_time_ = chrono::steady_clock::now();
+	++statistics_epoch_;
+}
+
+uint64_t SearchServer::GetStatisticsEpoch() const {
+	return statistics_epoch_;
+}
+
+uint64_t SearchServer::GetChangeCount() const {
+	return change_count_;
+}
+
+bool SearchServer::UsesStatisticsEpochs() const {
+	return epoch_options_.document_interval > 0 || epoch_options_.time_interval.count() > 0;
+}
+
+void SearchServer::NoteStatisticsChange(const WordFrequencies& word_freqs) {
+	if (!UsesStatisticsEpochs()) {
+		return;
+	}
+	for (const auto& [word, _] : word_freqs) {
+		unpublished_words_.push_back(word);
+	}
+}
+
+void SearchServer::FinishStatisticsChange() {
+	++change_count_;
+	if (!UsesStatisticsEpochs()) {
+		++statistics_epoch_;
+		return;
+	}
+	++unpublished_change_count_;
+	const bool documents_exhausted = epoch_options_.document_interval > 0 && unpublished_change_count_ >= epoch_options_.document_interval;
+	const bool time_exhausted = epoch_options_.time_interval.count() > 0 && chrono::steady_clock::now() - last_publish_time_ >= epoch_options_.time_interval;
+	if (documents_exhausted || time_exhausted) {
+		PublishStatistics();
+	}
+}
+
+int SearchServer::GetPublishedDocumentCount() const {
+	return UsesStatisticsEpochs() ? published_document_count_ : GetDocumentCount();
+}
+
+int SearchServer::GetPublishedDocumentFreq(const string_view& word) const {
+	if (!UsesStatisticsEpochs()) {
+		return CountDocumentsContainWord(word);
+	}
+	const auto it = published_document_freqs_.find(word);
+	return it == published_document_freqs_.end() ? 0 : it->second;
+}
+
+DocumentIdBitmap SearchServer::CollectExcludedDocuments(const Query& query) const {
+	DocumentIdBitmap excluded_documents;
+	for (const string& word : query.minus_words) {
+		const auto word_it = word_to_document_freqs_.find(word);
+		if (word_it != word_to_document_freqs_.end()) {
+			excluded_documents |= CollectPostingDocuments(word_it->second);
+		}
+	}
+	return excluded_documents;
+}
+
+DocumentIdBitmap SearchServer::CollectPostingDocuments(const pmr::map<int, double>& postings) {
+	// id приходят по возрастанию, поэтому каждый Set дописывает в конец блока
+	DocumentIdBitmap documents;
+	for (const auto& [id, _] : postings) {
+		documents.Set(id);
+	}
+	return documents;
+}
+
+vector<int> SearchServer::IntersectRequiredWords(const Query& query) const {
+	vector<const pmr::map<int, double>*> postings;
+	for (const string& word : query.required_words) {
+		const auto word_it = word_to_document_freqs_.find(word);
+		if (word_it == word_to_document_freqs_.end()) {
+			return {};
+		}
+		postings.push_back(&word_it->second);
+	}
+	sort(postings.begin(), postings.end(),
+		[](const pmr::map<int, double>* lhs, const pmr::map<int, double>* rhs) {
+			return lhs->size() < rhs->size();
+		}
+	);
+
+	vector<int> documents;
+	if (postings.empty()) {
+		return documents;
+	}
+	const auto& shortest = *postings.front();
+	auto candidate_it = shortest.begin();
+	while (candidate_it != shortest.end()) {
+		const int candidate = candidate_it->first;
+		bool found = true;
+		for (size_t i = 1; i < postings.size(); ++i) {
+			const auto it = postings[i]->lower_bound(candidate);
+			if (it == postings[i]->end()) {
+				return documents;
+			}
+			if (it->first != candidate) {
+				// в коротком списке пропускаются все id меньше найденного
+				candidate_it = shortest.lower_bound(it->first);
+				found = false;
+				break;
+			}
+		}
+		if (found) {
+			documents.push_back(candidate);
+			++candidate_it;
+		}
+	}
+	return documents;
 }
\ No newline at end of file
@@ -1,42 +1,94 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <memory_resource>
 #include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <set>
 #include <tuple>
 #include <string>
+#include <chrono>
 #include <execution>
+#include <iterator>
+#include <optional>
 #include <string_view>
 
 #include "document.h"
 #include "string_processing.h"
 #include "concurrent_map.h"
+#include "deletion_index.h"
+#include "document_id_bitmap.h"
+#include "string_pool.h"
+#include "stop_word_set.h"
+#include "counting_resource.h"
+#include "query_profiler.h"
 
 constexpr int MAX_RESULT_DOCUMENT_COUNT = 5;
 
+// ANY — документ подходит, если содержит хотя бы одно плюс-слово; ALL — если содержит все.
+// В любом режиме слово с префиксом '+' обязательно
+enum class QueryMode {
+	ANY,
+	ALL,
+};
+
 class SearchServer {
+	friend class QuerySession;
+	// определена только в тестах: портит внутренние структуры, чтобы проверить Verify
+	friend struct SearchServerTestAccess;
+
 public:
-	SearchServer() = default;
+	using WordFrequencies = std::pmr::vector<std::pair<std::string_view, double>>;
+
+	static constexpr size_t ARENA_POOL_LARGEST_BLOCK = 16 * 1024;
+
+	// Без resource индекс живёт в собственной арене сервера: блоки берутся у монотонной арены,
+	// а освобождённые при удалении документов узлы и частоты переиспользует пул поверх неё,
+	// поэтому добавления и удаления вперемешку не раздувают память. Блоки крупнее
+	// ARENA_POOL_LARGEST_BLOCK пул не переиспользует, их возвращает только Reorganize.
+	// С resource все структуры индекса выделяются из него, время жизни resource должно
+	// превышать время жизни сервера.
+	SearchServer();
+	explicit SearchServer(std::pmr::memory_resource* resource);
 
 	template <typename StringContainer>
-	explicit SearchServer(const StringContainer& stop_words)
-		: stop_words_(MakeUniqueNonEmptyStrings(stop_words)) 
+	explicit SearchServer(const StringContainer& stop_words, std::pmr::memory_resource* resource = nullptr)
+		: arena_counter_(resource == nullptr ? std::make_unique<CountingResource>() : nullptr)
+		, own_resource_(resource == nullptr ? std::make_unique<std::pmr::monotonic_buffer_resource>(arena_counter_.get()) : nullptr)
+		, own_pool_(resource == nullptr ? MakeArenaPool(own_resource_.get()) : nullptr)
+		, resource_(resource == nullptr ? own_pool_.get() : resource)
 	{
 		using namespace std::string_literals;
 
-		for (const auto& word : stop_words_) {
+		const auto unique_stop_words = MakeUniqueNonEmptyStrings(stop_words);
+		for (const auto& word : unique_stop_words) {
 			if (!IsValidWord(std::execution::seq, word)) {
 				throw std::invalid_argument("Stop-words contains invalid characters"s);
 			}
 		}
+		stop_words_ = StopWordSet(unique_stop_words);
 	}
 
-	explicit SearchServer(const std::string& stop_words_text);
-	explicit SearchServer(const std::string_view& stop_words_text);
+	explicit SearchServer(const std::string& stop_words_text, std::pmr::memory_resource* resource = nullptr);
+	explicit SearchServer(const std::string_view& stop_words_text, std::pmr::memory_resource* resource = nullptr);
+
+	SearchServer(const SearchServer&) = delete;
+	SearchServer& operator=(const SearchServer&) = delete;
+	SearchServer(SearchServer&&) = default;
+	SearchServer& operator=(SearchServer&&) = delete;
+
 	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
 
+	// Разбор документа на отсортированные слова без стоп-слов. Индекс не меняется,
+	// поэтому метод можно вызывать из нескольких потоков одновременно
+	std::vector<std::string_view> TokenizeDocument(const std::string_view& document) const;
+	// Добавляет документ, уже разобранный TokenizeDocument; слова копируются в пул сервера
+	void AddTokenizedDocument(int document_id, const std::vector<std::string_view>& words, DocumentStatus status, const std::vector<int>& ratings);
+
 	std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
 
 	template <typename Policy>
@@ -51,6 +103,7 @@ public:
 	}
 
 	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, QueryMode mode) const;
 
 	template <typename Policy>
 	std::vector<Document> FindTopDocuments(const Policy& policy, const std::string_view& raw_query, DocumentStatus status) const {
@@ -73,57 +126,322 @@ public:
 
 	template <typename Policy, typename Filter>
 	std::vector<Document> FindTopDocuments(const Policy& policy, const std::string_view& raw_query, Filter filter) const {
-		const Query query = ParseQuery(policy, raw_query);
-		auto matched_documents = FindAllDocuments(policy, query, filter);
+		std::vector<Document> matched_documents;
+		FillTopDocuments(policy, raw_query, filter, matched_documents);
 
-		std::sort(policy, matched_documents.begin(), matched_documents.end(),
-			[](const Document& lhs, const Document& rhs) {
-				if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
-					return lhs.rating > rhs.rating;
-				} else {
-					return lhs.relevance > rhs.relevance;
-				}
+		return matched_documents;
+	}
+
+	template <typename Policy, typename Filter>
+	std::vector<Document> FindTopDocuments(const Policy& policy, const std::string_view& raw_query, QueryMode mode, Filter filter) const {
+		std::vector<Document> matched_documents;
+		FillTopDocuments(policy, raw_query, mode, filter, nullptr, matched_documents);
+
+		return matched_documents;
+	}
+
+	// Заполняют переданный буфер вместо создания нового вектора: при повторном
+	// использовании буфера путь результата не выделяет память
+	void FillTopDocuments(const std::string_view& raw_query, std::vector<Document>& result) const;
+	void FillTopDocuments(const std::string_view& raw_query, DocumentStatus status, std::vector<Document>& result) const;
+
+	template <typename Policy, typename Filter>
+	void FillTopDocuments(const Policy& policy, const std::string_view& raw_query, Filter filter, std::vector<Document>& result) const {
+		FillTopDocuments(policy, raw_query, filter, nullptr, result);
+	}
+
+	// Частоты слов запроса по всему корпусу. Шард, получивший суммарную статистику
+	// всех шардов, считает IDF так же, как считал бы единый сервер
+	struct TermStatistics {
+		int document_count = 0;
+		std::map<std::string, int, std::less<>> document_freqs;
+	};
+
+	// Добавляет к statistics число документов сервера и частоты плюс-слов запроса
+	void CollectTermStatistics(const std::string_view& raw_query, TermStatistics& statistics) const;
+
+	// IDF слов из statistics берётся из неё, остальных — из собственного индекса
+	template <typename Policy, typename Filter>
+	void FillTopDocuments(const Policy& policy, const std::string_view& raw_query, Filter filter, const TermStatistics* statistics, std::vector<Document>& result) const {
+		FillTopDocuments(policy, raw_query, QueryMode::ANY, filter, statistics, result);
+	}
+
+	// Запрос с обязательными словами обходит только пересечение их списков документов
+	template <typename Policy, typename Filter>
+	void FillTopDocuments(const Policy& policy, const std::string_view& raw_query, QueryMode mode, Filter filter, const TermStatistics* statistics, std::vector<Document>& result) const {
+		PROFILE_QUERY_STAGE(QueryStage::TOTAL);
+		FillParsedTopDocuments(policy, ParseQuery(policy, raw_query, mode), filter, statistics, result);
+	}
+
+	// Ограничения упрощённого запроса под нагрузкой: из необязательных плюс-слов остаются самые
+	// редкие, чтобы плюс-слов было не больше max_plus_words. Обязательные и минус-слова не отбрасываются
+	struct QueryLimits {
+		size_t max_plus_words = SIZE_MAX;
+	};
+
+	template <typename Policy, typename Filter>
+	void FillTopDocuments(const Policy& policy, const std::string_view& raw_query, QueryMode mode, Filter filter, const QueryLimits& limits, std::vector<Document>& result) const {
+		PROFILE_QUERY_STAGE(QueryStage::TOTAL);
+		Query query = ParseQuery(policy, raw_query, mode);
+		LimitQuery(query, limits);
+		FillParsedTopDocuments(policy, query, filter, nullptr, result);
+	}
+
+	// Оценка стоимости запроса до выполнения по длинам списков документов его слов
+	struct QueryCost {
+		size_t plus_word_count = 0;
+		// сумма частот плюс- и минус-слов: столько записей индекса обходит полный перебор
+		size_t posting_count = 0;
+	};
+
+	// Бросают invalid_argument для некорректного запроса, как FindTopDocuments
+	QueryCost EstimateQueryCost(const std::string_view& raw_query, QueryMode mode = QueryMode::ANY) const;
+	QueryCost EstimateQueryCost(const std::string_view& raw_query, QueryMode mode, const QueryLimits& limits) const;
+
+	// Место документа в полном порядке выдачи: релевантность по убыванию, затем рейтинг по
+	// убыванию, затем id по возрастанию. В отличие от FindTopDocuments релевантности
+	// сравниваются точно, чтобы порядок был строгим и страницы не теряли документы
+	struct SearchPosition {
+		double relevance = 0.0;
+		int rating = 0;
+		int document_id = 0;
+	};
+
+	static bool IsRankedBefore(const SearchPosition& lhs, const SearchPosition& rhs);
+
+	// Не больше page_size документов, идущих в этом порядке строго после after (nullopt —
+	// с начала выдачи). Документы обходятся по возрастанию id сразу во всех списках слов
+	// запроса, и хранится только лучшая страница, поэтому память не зависит от глубины
+	// страницы и числа найденных документов
+	template <typename Filter>
+	void FindDocumentsAfter(const std::string_view& raw_query, Filter filter, const std::optional<SearchPosition>& after, size_t page_size, std::vector<Document>& result) const {
+		const Query query = ParseQuery(std::execution::seq, raw_query);
+		struct Cursor {
+			std::pmr::map<int, double>::const_iterator it;
+			std::pmr::map<int, double>::const_iterator end;
+			double inverse_document_freq;
+			bool is_required;
+		};
+		result.clear();
+		std::vector<Cursor> cursors;
+		size_t required_cursor_count = 0;
+		for (const std::string& word : query.plus_words) {
+			const auto word_it = word_to_document_freqs_.find(word);
+			const bool is_required = query.required_words.count(word) > 0;
+			if (word_it != word_to_document_freqs_.end()) {
+				cursors.push_back({ word_it->second.begin(), word_it->second.end(), ComputeWordInverseDocumentFreq(word, nullptr), is_required });
+				required_cursor_count += is_required ? 1 : 0;
+			} else if (is_required) {
+				return;
 			}
-		);
-		if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT) {
-			matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
 		}
+		const DocumentIdBitmap excluded_documents = CollectExcludedDocuments(query);
+		const auto ranked_before = [](const Document& lhs, const Document& rhs) {
+			return IsRankedBefore({ lhs.relevance, lhs.rating, lhs.id }, { rhs.relevance, rhs.rating, rhs.id });
+		};
 
-		return matched_documents;
+		// result — куча с худшим документом страницы наверху
+		while (page_size > 0) {
+			int document_id = -1;
+			for (const Cursor& cursor : cursors) {
+				if (cursor.it != cursor.end && (document_id < 0 || cursor.it->first < document_id)) {
+					document_id = cursor.it->first;
+				}
+			}
+			if (document_id < 0) {
+				break;
+			}
+
+			double relevance = 0.0;
+			size_t required_match_count = 0;
+			for (Cursor& cursor : cursors) {
+				if (cursor.it != cursor.end && cursor.it->first == document_id) {
+					relevance += cursor.it->second * cursor.inverse_document_freq;
+					required_match_count += cursor.is_required ? 1 : 0;
+					++cursor.it;
+				}
+			}
+			if (required_match_count < required_cursor_count || excluded_documents.Test(document_id)) {
+				continue;
+			}
+			const DocumentData& data = documents_.at(document_id);
+			const Document document{ document_id, relevance, data.rating };
+			if (!filter(document_id, data.status, data.rating)
+				|| (after && !IsRankedBefore(*after, { relevance, data.rating, document_id }))) {
+				continue;
+			}
+
+			if (result.size() < page_size) {
+				result.push_back(document);
+				std::push_heap(result.begin(), result.end(), ranked_before);
+			} else if (ranked_before(document, result.front())) {
+				std::pop_heap(result.begin(), result.end(), ranked_before);
+				result.back() = document;
+				std::push_heap(result.begin(), result.end(), ranked_before);
+			}
+		}
+		std::sort_heap(result.begin(), result.end(), ranked_before);
 	}
 
+	// Сводка по документам запроса без подсчёта релевантности и сортировки
+	struct QueryAggregation {
+		// число документов каждого статуса, индекс — static_cast<int>(DocumentStatus)
+		std::array<int, 4> status_counts{};
+		// нижняя граница корзины рейтинга → число документов; только документы статуса aggregation_status
+		std::map<int, int> rating_histogram;
+	};
+
+	// Документы запроса собираются в bitmap, из него вычитаются документы минус-слов,
+	// а счётчики — мощности его пересечений с bitmap'ами статусов и корзин рейтинга,
+	// которые индекс поддерживает при добавлении и удалении документов
+	QueryAggregation AggregateDocuments(const std::string_view& raw_query, DocumentStatus aggregation_status = DocumentStatus::ACTUAL, QueryMode mode = QueryMode::ANY) const;
+
+	// Ширина корзины рейтинга для AggregateDocuments; смена перестраивает bitmap'ы корзин
+	void SetRatingBucketWidth(int width);
+	int GetRatingBucketWidth() const;
+
 	int GetDocumentCount() const;
 	int GetDocumentId(int index) const;
 	std::vector<int>::const_iterator begin() const;
 	std::vector<int>::const_iterator end() const;
 
-	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view& raw_query, int document_id) const;
+	using MatchResult = std::tuple<std::vector<std::string_view>, DocumentStatus>;
+
+	// Бросает out_of_range, если документа нет. Слова результата указывают в словарь сервера
+	MatchResult MatchDocument(const std::string_view& raw_query, int document_id) const;
+
+	template <typename Policy>
+	MatchResult MatchDocument(const Policy& policy, const std::string_view& raw_query, int document_id) const {
+		const DocumentData& data = FindDocumentData(document_id);
+		return MatchParsedQuery(policy, ParseQuery(policy, raw_query), data);
+	}
+
+	// Запрос разбирается один раз для всех документов; с execution::par документы
+	// сопоставляются параллельно. Результаты идут в порядке document_ids
+	std::vector<MatchResult> MatchDocuments(const std::string_view& raw_query, const std::vector<int>& document_ids) const;
 
 	template <typename Policy>
-	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const Policy& policy, const std::string_view& raw_query, int document_id) const {
+	std::vector<MatchResult> MatchDocuments(const Policy& policy, const std::string_view& raw_query, const std::vector<int>& document_ids) const {
 		const Query query = ParseQuery(policy, raw_query);
-		std::vector<std::string_view> matched_words;
+		// документы ищутся заранее: исключение внутри параллельного алгоритма завершило бы программу
+		std::vector<const DocumentData*> documents(document_ids.size());
+		std::transform(document_ids.begin(), document_ids.end(), documents.begin(),
+			[this](int document_id) {
+				return &FindDocumentData(document_id);
+			}
+		);
 
-		for (const std::string_view& word : query.plus_words) {
-			if (documents_.count(document_id) && documents_.at(document_id).word_freqs.count(word)) {
-				matched_words.push_back(*words_.find(word));
+		std::vector<MatchResult> results(document_ids.size());
+		std::transform(policy, documents.begin(), documents.end(), results.begin(),
+			[this, &query](const DocumentData* data) {
+				return MatchParsedQuery(std::execution::seq, query, *data);
 			}
+		);
+		return results;
+	}
+
+	// Дополнительная копия списков документов каждого слова, упорядоченная по убыванию TF,
+	// затем рейтинга. Запросы из одного-нескольких слов обходят её от начала и
+	// останавливаются, как только оставшиеся документы не могут попасть в топ.
+	// Копия обновляется при AddDocument и RemoveDocument и занимает память ещё одного индекса
+	void SetImpactOrderedPostings(bool enabled);
+	bool HasImpactOrderedPostings() const;
+
+	struct ReorganizeOptions {
+		// слова этих запросов (плюс- и минус-) считаются горячими по числу вхождений;
+		// списки остальных слов идут за ними по убыванию длины
+		std::vector<std::string> query_sample;
+		// блоки новой арены берутся у HugePageResource
+		bool use_huge_pages = false;
+	};
+
+	// Копия индекса в новой собственной арене, разложенная под обход: списки документов
+	// горячих слов лежат первыми и каждый — непрерывно, узлы документов — подряд по
+	// возрастанию id, в порядке обхода любого списка. Память удалённых документов в копию
+	// не попадает. source только читается, поэтому копию можно строить в фоне, пока
+	// source обслуживает запросы. Присваивание SearchServer запрещено (контейнеры арены не
+	// переносятся между ресурсами), поэтому для подмены сервер держат через указатель:
+	// live = std::make_unique<SearchServer>(SearchServer::Reorganize(*live))
+	static SearchServer Reorganize(const SearchServer& source);
+	static SearchServer Reorganize(const SearchServer& source, const ReorganizeOptions& options);
+
+	// Память индекса по группам структур. Структуры в арене учитываются точно, по прошедшим
+	// через счётчики выделениям, вместе с накладными расходами узлов; структуры в обычной
+	// куче — по ёмкости их контейнеров
+	struct MemoryStats {
+		// пул слов, узлы словаря, индекс опечаток, стоп-слова
+		size_t dictionary = 0;
+		// списки документов слов
+		size_t postings = 0;
+		// узлы документов с их частотами слов, порядок добавления документов
+		size_t documents = 0;
+		// производные структуры: списки по вкладу, bitmap'ы статусов и корзин рейтинга,
+		// опубликованная статистика эпох
+		size_t caches = 0;
+		// память, взятая ареной у upstream, но не занятая живыми структурами: освобождённое
+		// после удаления документов (пул арены держит его для новых узлов) и хвосты блоков.
+		// С внешним resource известны только хвосты блоков пула слов
+		size_t slack = 0;
+
+		size_t GetTotal() const {
+			return dictionary + postings + documents + caches + slack;
 		}
+	};
 
-		for (const std::string_view& word : query.minus_words) {
-			if (documents_.count(document_id) && documents_.at(document_id).word_freqs.count(word)) {
-				matched_words.clear();
-				break;
-			}
+	MemoryStats GetMemoryStats() const;
+
+	// Результат проверки согласованности индекса
+	struct VerificationReport {
+		size_t document_count = 0;
+		// слова, у которых есть документы, и их записи в списках
+		size_t word_count = 0;
+		size_t posting_count = 0;
+		// слова словаря без документов: словарь намеренно хранит слова удалённых документов
+		size_t retired_word_count = 0;
+		// все найденные нарушения; в violations — max_violations первых по тексту из них, поэтому
+		// при любом числе потоков отчёт один и тот же
+		size_t violation_count = 0;
+		std::vector<std::string> violations;
+
+		bool IsConsistent() const {
+			return violation_count == 0;
 		}
+	};
 
-		return {
-			matched_words,
-			documents_.at(document_id).status
-		};
-	}
+	// Сверяет таблицу документов, порядок добавления, прямой индекс, списки документов слов,
+	// словарь, частоты слов (в том числе опубликованные эпохой), фасеты, списки по вкладу и индекс
+	// опечаток. Документы и слова проверяются параллельно; изменения индекса во время проверки недопустимы
+	VerificationReport Verify(size_t max_violations = 100) const;
+	VerificationReport Verify(const std::execution::sequenced_policy& policy, size_t max_violations = 100) const;
+	VerificationReport Verify(const std::execution::parallel_policy& policy, size_t max_violations = 100) const;
+
+	// Статистика для IDF (число документов и частоты слов) публикуется эпохами: раз в
+	// document_interval изменений индекса или при первом изменении спустя time_interval
+	// после прошлой публикации. Запросы между публикациями видят одну и ту же статистику,
+	// поэтому зависящие от IDF кэши действительны в пределах эпохи. Нули в обоих полях —
+	// публикация после каждого изменения, как без эпох
+	struct StatisticsEpochOptions {
+		size_t document_interval = 0;
+		std::chrono::milliseconds time_interval{ 0 };
+	};
 
-	const std::map<std::string_view, double>& GetWordToFrequencies(int document_id) const;
+	void SetStatisticsEpochOptions(const StatisticsEpochOptions& options);
+	const StatisticsEpochOptions& GetStatisticsEpochOptions() const;
+	// Немедленно публикует текущую статистику
+	void PublishStatistics();
+	// Номер эпохи растёт с каждой публикацией
+	uint64_t GetStatisticsEpoch() const;
+	// Растёт с каждым изменением, после которого результаты запросов могут стать другими:
+	// добавлением и удалением документов, публикацией статистики, сменой расстояния опечаток.
+	// Внутри эпохи документы меняются без смены её номера, поэтому кэш результатов проверяет это число
+	uint64_t GetChangeCount() const;
+
+	// Слова документа с частотами, упорядоченные по слову
+	const WordFrequencies& GetWordToFrequencies(int document_id) const;
+
+	// 0 отключает исправление опечаток; 1 или 2 — максимальное расстояние редактирования
+	void SetFuzzyEditDistance(int max_distance);
+	int GetFuzzyEditDistance() const;
 
 	void RemoveDocument(int document_id);
 
@@ -133,25 +451,96 @@ public:
 			return;
 		}
 
+		NoteStatisticsChange(documents_.at(document_id).word_freqs);
+		RemoveImpactPostings(document_id, documents_.at(document_id));
+		RemoveFromFacets(document_id, documents_.at(document_id));
+		for (const auto& [word, _] : documents_.at(document_id).word_freqs) {
+			auto& word_documents = word_to_document_freqs_.at(word);
+			word_documents.erase(document_id);
+			if (word_documents.empty()) {
+				word_to_document_freqs_.erase(word);
+			}
+		}
 		documents_.erase(document_id);
 		auto it = std::find(policy, document_ids_.begin(), document_ids_.end(), document_id);
 		if (it != document_ids_.end()) {
 			document_ids_.erase(it);
 		}
+		FinishStatisticsChange();
 	}
 
 private:
 	struct DocumentData {
 		int rating;
 		DocumentStatus status;
-		std::map<std::string_view, double> word_freqs;
+		WordFrequencies word_freqs;
+	};
+	SearchServer(const SearchServer& source, const ReorganizeOptions& options);
+
+	static std::unique_ptr<std::pmr::unsynchronized_pool_resource> MakeArenaPool(std::pmr::memory_resource* arena);
+
+	std::unique_ptr<std::pmr::memory_resource> own_upstream_;
+	// память, которую собственная арена взяла у upstream
+	std::unique_ptr<CountingResource> arena_counter_;
+	std::unique_ptr<std::pmr::monotonic_buffer_resource> own_resource_;
+	std::unique_ptr<std::pmr::unsynchronized_pool_resource> own_pool_;
+	std::pmr::memory_resource* resource_;
+	// счётчики групп структур поверх resource_; в куче, чтобы аллокаторы контейнеров
+	// не ссылались на перемещённый сервер
+	struct MemoryCounters {
+		explicit MemoryCounters(std::pmr::memory_resource* upstream)
+			: dictionary(upstream), postings(upstream), documents(upstream), caches(upstream)
+		{
+		}
+
+		CountingResource dictionary;
+		CountingResource postings;
+		CountingResource documents;
+		CountingResource caches;
 	};
-	std::set<std::string, std::less<>> words_;
-	std::set<std::string, std::less<>> stop_words_;
-	std::map<int, DocumentData> documents_;
+	std::unique_ptr<MemoryCounters> memory_counters_ = std::make_unique<MemoryCounters>(resource_);
+	StringPool word_pool_{ &memory_counters_->dictionary };
+	std::pmr::set<std::string_view> words_{ &memory_counters_->dictionary };
+	StopWordSet stop_words_;
+	std::pmr::map<std::string_view, std::pmr::map<int, double>> word_to_document_freqs_{ &memory_counters_->postings };
+	std::pmr::map<int, DocumentData> documents_{ &memory_counters_->documents };
 	std::vector<int> document_ids_;
+	DeletionIndex fuzzy_index_;
+
+	struct ImpactPosting {
+		double term_freq;
+		int rating;
+		int document_id;
+	};
+	struct ImpactOrder {
+		bool operator()(const ImpactPosting& lhs, const ImpactPosting& rhs) const {
+			return std::tie(rhs.term_freq, rhs.rating, lhs.document_id) < std::tie(lhs.term_freq, lhs.rating, rhs.document_id);
+		}
+	};
+	using ImpactPostings = std::pmr::set<ImpactPosting, ImpactOrder>;
+	bool impact_ordered_postings_ = false;
+	std::pmr::map<std::string_view, ImpactPostings> word_to_impact_postings_{ &memory_counters_->caches };
+
+	static constexpr int DEFAULT_RATING_BUCKET_WIDTH = 5;
+	std::array<DocumentIdBitmap, 4> status_documents_;
+	int rating_bucket_width_ = DEFAULT_RATING_BUCKET_WIDTH;
+	std::map<int, DocumentIdBitmap> rating_bucket_documents_;
+
+	StatisticsEpochOptions epoch_options_;
+	uint64_t statistics_epoch_ = 0;
+	uint64_t change_count_ = 0;
+	// опубликованная статистика; в режиме без эпох не ведётся, IDF считается по живому индексу
+	int published_document_count_ = 0;
+	std::pmr::map<std::string_view, int> published_document_freqs_{ &memory_counters_->caches };
+	// слова, частоты которых изменились после публикации (возможны повторы)
+	std::vector<std::string_view> unpublished_words_;
+	size_t unpublished_change_count_ = 0;
+	std::chrono::steady_clock::time_point last_publish_time_ = std::chrono::steady_clock::now();
 
 	bool IsStopWord(const std::string_view& word) const;
+	const DocumentData& FindDocumentData(int document_id) const;
+	// Позиция слова в частотах документа или nullptr
+	static const std::pair<std::string_view, double>* FindWord(const DocumentData& data, const std::string_view& word);
 
 	template <typename Policy>
 	static bool IsValidWord(const Policy& policy, const std::string_view& word) {
@@ -165,28 +554,15 @@ private:
 		);
 	}
 
-	template <typename Policy>
-	std::vector<std::string> SplitIntoWordsNoStop(const Policy& policy, const std::string_view& text) const {
-		using namespace std;
-
-		vector<string> words;
-		for (const string_view& word : SplitIntoWords(text)) {
-			if (!IsValidWord(policy, word)) {
-				throw invalid_argument("SplitIntoWordsNoStop: text contains invalid characters"s);
-			}
-			if (!IsStopWord(word)) {
-				words.push_back(static_cast<string>(word));
-			}
-		}
-
-		return words;
-	}
+	// Разбиение, проверка символов и отбрасывание стоп-слов за один проход по тексту
+	std::vector<std::string_view> SplitIntoWordsNoStop(const std::string_view& text) const;
 
 	static int ComputeAverageRating(const std::vector<int>& ratings);
 
 	struct QueryWord {
 		std::string_view data;
 		bool is_minus;
+		bool is_required;
 		bool is_stop;
 	};
 
@@ -198,16 +574,19 @@ private:
 			throw invalid_argument("ParseQueryWord: text is empty"s);
 		}
 
-		bool is_minus = false;
-		if (text[0] == '-') {
-			is_minus = true;
+		const char prefix = text[0];
+		const bool is_minus = prefix == '-';
+		const bool is_required = prefix == '+';
+		if (is_minus || is_required) {
 			text = text.substr(1);
 		}
 
 		if (text.empty()) {
-			throw invalid_argument("ParseQueryWord: text has only \'-\'"s);
-		} else if (text[0] == '-') {
+			throw invalid_argument("ParseQueryWord: text has only \'"s + prefix + "\'"s);
+		} else if (is_minus && text[0] == '-') {
 			throw invalid_argument("ParseQueryWord: text has double consecutive \'-\'"s);
+		} else if ((is_minus || is_required) && (text[0] == '-' || text[0] == '+')) {
+			throw invalid_argument("ParseQueryWord: text has several prefixes"s);
 		} else if (!IsValidWord(policy, text)) {
 			throw invalid_argument("ParseQueryWord: text contains invalid characters"s);
 		}
@@ -215,6 +594,7 @@ private:
 		return {
 			text,
 			is_minus,
+			is_required,
 			IsStopWord(text)
 		};
 	}
@@ -222,18 +602,28 @@ private:
 	struct Query {
 		std::set<std::string, std::less<>> plus_words;
 		std::set<std::string, std::less<>> minus_words;
+		// подмножество plus_words, которое должно быть в документе целиком
+		std::set<std::string, std::less<>> required_words;
 	};
 
 	template <typename Policy>
-	Query ParseQuery(const Policy& policy, const std::string_view& text) const {
+	Query ParseQuery(const Policy& policy, const std::string_view& text, QueryMode mode = QueryMode::ANY) const {
+		PROFILE_QUERY_STAGE(QueryStage::PARSE);
 		Query result;
 		for (const std::string_view& word : SplitIntoWords(text)) {
-			const QueryWord query_word = ParseQueryWord(policy, word);
-			if (!query_word.is_stop) {
-				if (query_word.is_minus) {
-					result.minus_words.insert(static_cast<std::string>(query_word.data));
-				} else {
-					result.plus_words.insert(static_cast<std::string>(query_word.data));
+			QueryWord query_word = ParseQueryWord(policy, word);
+			if (query_word.is_stop) {
+				continue;
+			}
+			if (query_word.is_minus) {
+				result.minus_words.insert(static_cast<std::string>(query_word.data));
+				continue;
+			}
+			query_word.is_required = query_word.is_required || mode == QueryMode::ALL;
+			for (const std::string_view expanded_word : ExpandPlusWord(query_word)) {
+				result.plus_words.insert(static_cast<std::string>(expanded_word));
+				if (query_word.is_required) {
+					result.required_words.insert(static_cast<std::string>(expanded_word));
 				}
 			}
 		}
@@ -241,86 +631,290 @@ private:
 		return result;
 	}
 
+	// Слова индекса, которыми ищется плюс-слово. Слово без документов при включённом
+	// исправлении опечаток заменяется ближайшими словами словаря, а обязательное —
+	// только самым частым из них, чтобы не требовать все варианты сразу
+	std::vector<std::string_view> ExpandPlusWord(const QueryWord& query_word) const;
+	// Отбрасывает самые частые необязательные плюс-слова сверх limits.max_plus_words
+	void LimitQuery(Query& query, const QueryLimits& limits) const;
+
+	// во сколько раз документ должен быть длиннее запроса, чтобы искать слова галопом
+	static constexpr size_t GALLOP_DOCUMENT_RATIO = 8;
+
+	MatchResult MatchParsedQuery(const std::execution::sequenced_policy&, const Query& query, const DocumentData& data) const;
+	MatchResult MatchParsedQuery(const std::execution::parallel_policy&, const Query& query, const DocumentData& data) const;
+
+	std::vector<std::string_view> FindFuzzyCandidates(const std::string_view& word) const;
+
 	int CountDocumentsContainWord(const std::string_view& word)const;
-	double ComputeWordInverseDocumentFreq(const std::string_view& word) const;
 
+	// запросы длиннее обходятся полным перебором: порог из суммы многих списков убывает медленно
+	static constexpr size_t IMPACT_QUERY_MAX_WORDS = 4;
+
+	int GetRatingBucket(int rating) const;
+	void AddToFacets(int document_id, const DocumentData& data);
+	void RemoveFromFacets(int document_id, const DocumentData& data);
+
+	void AddImpactPostings(int document_id, const DocumentData& data);
+	void RemoveImpactPostings(int document_id, const DocumentData& data);
+
+	// Алгоритм порога по упорядоченным по вкладу спискам: на каждом шаге берётся следующий
+	// документ каждого слова, его полная релевантность считается по обычным спискам.
+	// Документ, ещё не встреченный ни в одном списке, набирает не больше суммы текущих
+	// вкладов; когда она меньше релевантности худшего документа топа, обход заканчивается.
+	// Возвращает false, если ранняя остановка неприменима (отрицательный IDF)
 	template <typename Filter>
-	std::vector<Document> FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, Filter filter) const {
-		std::map<int, double> document_to_relevance;
-		for (const std::string_view& word : query.plus_words) {
-			if (CountDocumentsContainWord(word) == 0) {
+	bool FindTopDocumentsByImpact(const Query& query, Filter filter, const TermStatistics* statistics, std::vector<Document>& result) const {
+		struct Cursor {
+			ImpactPostings::const_iterator it;
+			ImpactPostings::const_iterator end;
+			double inverse_document_freq;
+		};
+		std::vector<Cursor> cursors;
+		std::vector<std::pair<const std::pmr::map<int, double>*, double>> postings;
+		for (const std::string& word : query.plus_words) {
+			const auto word_it = word_to_document_freqs_.find(word);
+			if (word_it == word_to_document_freqs_.end()) {
 				continue;
 			}
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			for (const auto& [id, data] : documents_) {
-				if (filter(id, data.status, data.rating) && data.word_freqs.count(word)) {
-					document_to_relevance[id] += data.word_freqs.at(word) * inverse_document_freq;
-				}
+			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, statistics);
+			if (inverse_document_freq < 0) {
+				return false;
 			}
+			const ImpactPostings& impact_postings = word_to_impact_postings_.at(word_it->first);
+			cursors.push_back({ impact_postings.begin(), impact_postings.end(), inverse_document_freq });
+			postings.emplace_back(&word_it->second, inverse_document_freq);
 		}
 
-		for (const std::string_view& word : query.minus_words) {
-			if (CountDocumentsContainWord(word) == 0) {
-				continue;
+		PROFILE_QUERY_STAGES(stages);
+		PROFILE_NEXT_STAGE(stages, QueryStage::POSTING_FETCH);
+		const DocumentIdBitmap excluded_documents = CollectExcludedDocuments(query);
+		DocumentIdBitmap seen_documents;
+		const auto is_better = [](const Document& lhs, const Document& rhs) {
+			if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
+				return lhs.rating > rhs.rating;
 			}
+			return lhs.relevance > rhs.relevance;
+		};
 
-			for (const auto& [id, data] : documents_) {
-				if (data.word_freqs.count(word)) {
-					document_to_relevance.erase(id);
+		PROFILE_NEXT_STAGE(stages, QueryStage::SCORE);
+		result.clear();
+		bool exhausted = false;
+		while (!exhausted) {
+			for (Cursor& cursor : cursors) {
+				if (cursor.it == cursor.end) {
+					continue;
+				}
+				const int document_id = (cursor.it++)->document_id;
+				if (seen_documents.Test(document_id) || excluded_documents.Test(document_id)) {
+					continue;
+				}
+				seen_documents.Set(document_id);
+				const DocumentData& data = documents_.at(document_id);
+				if (!filter(document_id, data.status, data.rating)) {
+					continue;
+				}
+
+				Document document{ document_id, 0.0, data.rating };
+				for (const auto& [word_postings, inverse_document_freq] : postings) {
+					const auto posting_it = word_postings->find(document_id);
+					if (posting_it != word_postings->end()) {
+						document.relevance += posting_it->second * inverse_document_freq;
+					}
+				}
+				result.insert(std::upper_bound(result.begin(), result.end(), document, is_better), document);
+				if (result.size() > static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+					result.pop_back();
+				}
+			}
+
+			// верхняя граница релевантности ещё не встреченных документов
+			double threshold = 0.0;
+			exhausted = true;
+			for (const Cursor& cursor : cursors) {
+				if (cursor.it != cursor.end) {
+					threshold += cursor.it->term_freq * cursor.inverse_document_freq;
+					exhausted = false;
 				}
 			}
+			// равные с точностью 1e-6 документы упорядочиваются по рейтингу, поэтому нужен запас
+			if (result.size() == static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT) && result.back().relevance > threshold + 1e-6) {
+				break;
+			}
 		}
+		return true;
+	}
 
-		std::vector<Document> matched_documents;
-		for (const auto& [document_id, relevance] : document_to_relevance) {
-			matched_documents.push_back(
-				{
-					document_id,
-					relevance,
-					documents_.at(document_id).rating
+	template <typename Policy, typename Filter>
+	void FillParsedTopDocuments(const Policy& policy, const Query& query, Filter filter, const TermStatistics* statistics, std::vector<Document>& result) const {
+		if (query.required_words.empty() && HasImpactOrderedPostings() && query.plus_words.size() <= IMPACT_QUERY_MAX_WORDS
+			&& FindTopDocumentsByImpact(query, filter, statistics, result)) {
+			return;
+		}
+		if (query.required_words.empty()) {
+			FindAllDocuments(policy, query, filter, statistics, result);
+		} else {
+			FindRequiredDocuments(query, filter, statistics, result);
+		}
+
+		PROFILE_QUERY_STAGES(stages);
+		PROFILE_NEXT_STAGE(stages, QueryStage::TOP_K);
+		const auto top_end = result.begin() + std::min(result.size(), static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT));
+		std::partial_sort(policy, result.begin(), top_end, result.end(),
+			[](const Document& lhs, const Document& rhs) {
+				if (std::abs(lhs.relevance - rhs.relevance) < 1e-6) {
+					return lhs.rating > rhs.rating;
+				} else {
+					return lhs.relevance > rhs.relevance;
 				}
-			);
+			}
+		);
+		PROFILE_NEXT_STAGE(stages, QueryStage::MATERIALIZE);
+		result.erase(top_end, result.end());
+	}
+
+	template <typename Policy>
+	VerificationReport VerifyIndex(const Policy& policy, size_t max_violations) const;
+
+	bool UsesStatisticsEpochs() const;
+	// Запоминает слова изменяемого документа до изменения индекса
+	void NoteStatisticsChange(const WordFrequencies& word_freqs);
+	// Учитывает изменение в GetChangeCount и публикует статистику, если эпоха исчерпана
+	void FinishStatisticsChange();
+	// Опубликованные число документов и частота слова; 0 — слово появилось после публикации
+	int GetPublishedDocumentCount() const;
+	int GetPublishedDocumentFreq(const std::string_view& word) const;
+	// Объединение документов всех минус-слов запроса
+	DocumentIdBitmap CollectExcludedDocuments(const Query& query) const;
+	static DocumentIdBitmap CollectPostingDocuments(const std::pmr::map<int, double>& postings);
+	// Документы, содержащие все обязательные слова, по возрастанию id. Списки пересекаются
+	// от самого короткого: кандидат из него ищется в следующих списках с пропуском
+	// по дереву, и первый же промах переносит поиск к следующему id этого списка
+	std::vector<int> IntersectRequiredWords(const Query& query) const;
+	double ComputeWordInverseDocumentFreq(const std::string_view& word, const TermStatistics* statistics) const;
+
+	// Релевантность считается только для пересечения обязательных слов; необязательные
+	// плюс-слова добавляют вклад найденным документам, но не расширяют выдачу
+	template <typename Filter>
+	void FindRequiredDocuments(const Query& query, Filter filter, const TermStatistics* statistics, std::vector<Document>& matched_documents) const {
+		PROFILE_QUERY_STAGES(stages);
+		PROFILE_NEXT_STAGE(stages, QueryStage::POSTING_FETCH);
+		matched_documents.clear();
+		const std::vector<int> candidates = IntersectRequiredWords(query);
+		const DocumentIdBitmap excluded_documents = CollectExcludedDocuments(query);
+
+		PROFILE_NEXT_STAGE(stages, QueryStage::FILTER);
+		for (const int document_id : candidates) {
+			const DocumentData& data = documents_.at(document_id);
+			if (!excluded_documents.Test(document_id) && filter(document_id, data.status, data.rating)) {
+				matched_documents.push_back({ document_id, 0.0, data.rating });
+			}
 		}
 
-		return matched_documents;
+		PROFILE_NEXT_STAGE(stages, QueryStage::SCORE);
+		for (const std::string& word : query.plus_words) {
+			const auto word_it = word_to_document_freqs_.find(word);
+			if (word_it == word_to_document_freqs_.end()) {
+				continue;
+			}
+			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, statistics);
+			for (Document& document : matched_documents) {
+				const auto posting_it = word_it->second.find(document.id);
+				if (posting_it != word_it->second.end()) {
+					document.relevance += posting_it->second * inverse_document_freq;
+				}
+			}
+		}
 	}
 
 	template <typename Filter>
-	std::vector<Document> FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, Filter filter) const {
-		ConcurrentMap<int, double> concurrent_map_document_to_relevance(8);
+	void FindAllDocuments(const std::execution::sequenced_policy&, const Query& query, Filter filter, const TermStatistics* statistics, std::vector<Document>& matched_documents) const {
+		PROFILE_QUERY_STAGES(stages);
+		matched_documents.clear();
+		PROFILE_NEXT_STAGE(stages, QueryStage::POSTING_FETCH);
+		// исключённые документы отбрасываются до подсчёта релевантности
+		const DocumentIdBitmap excluded_documents = CollectExcludedDocuments(query);
 		for (const std::string_view& word : query.plus_words) {
-			if (CountDocumentsContainWord(word) == 0) {
+			PROFILE_NEXT_STAGE(stages, QueryStage::POSTING_FETCH);
+			const auto word_it = word_to_document_freqs_.find(word);
+			if (word_it == word_to_document_freqs_.end()) {
 				continue;
 			}
-			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-			std::for_each(
-				policy,
-				documents_.begin(), documents_.end(),
-				[&concurrent_map_document_to_relevance, inverse_document_freq, filter, word](const auto& elem) {
-					const auto& id = elem.first;
-					const auto& data = elem.second;
-					if (filter(id, data.status, data.rating) && data.word_freqs.count(word)) {
-						concurrent_map_document_to_relevance[id].ref_to_value += data.word_freqs.at(word) * inverse_document_freq;
-					}
+			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, statistics);
+
+			PROFILE_NEXT_STAGE(stages, QueryStage::SCORE);
+			for (const auto& [id, term_freq] : word_it->second) {
+				if (!excluded_documents.Test(id)) {
+					matched_documents.push_back({ id, term_freq * inverse_document_freq, 0 });
 				}
-			);
+			}
 		}
 
-		auto document_to_relevance = concurrent_map_document_to_relevance.BuildOrdinaryMap();
+		// вклады разных слов в один документ складываются после сортировки по id
+		PROFILE_NEXT_STAGE(stages, QueryStage::SCORE);
+		std::sort(matched_documents.begin(), matched_documents.end(),
+			[](const Document& lhs, const Document& rhs) {
+				return lhs.id < rhs.id;
+			}
+		);
+		auto merged_end = matched_documents.begin();
+		for (auto it = matched_documents.begin(); it != matched_documents.end(); ++it) {
+			if (merged_end != matched_documents.begin() && std::prev(merged_end)->id == it->id) {
+				std::prev(merged_end)->relevance += it->relevance;
+			} else {
+				*merged_end++ = *it;
+			}
+		}
+		matched_documents.erase(merged_end, matched_documents.end());
+
+		PROFILE_NEXT_STAGE(stages, QueryStage::FILTER);
+		// фильтр вызывается один раз на документ, а не на каждое его слово
+		auto filtered_end = matched_documents.begin();
+		for (const Document& document : matched_documents) {
+			const auto& data = documents_.at(document.id);
+			if (filter(document.id, data.status, data.rating)) {
+				*filtered_end = document;
+				filtered_end->rating = data.rating;
+				++filtered_end;
+			}
+		}
+		matched_documents.erase(filtered_end, matched_documents.end());
+	}
 
-		for (const std::string_view& word : query.minus_words) {
-			if (CountDocumentsContainWord(word) == 0) {
+	template <typename Filter>
+	void FindAllDocuments(const std::execution::parallel_policy& policy, const Query& query, Filter filter, const TermStatistics* statistics, std::vector<Document>& matched_documents) const {
+		PROFILE_QUERY_STAGES(stages);
+		PROFILE_NEXT_STAGE(stages, QueryStage::POSTING_FETCH);
+		const DocumentIdBitmap excluded_documents = CollectExcludedDocuments(query);
+		ConcurrentMap<int, double> concurrent_map_document_to_relevance(8);
+		for (const std::string_view& word : query.plus_words) {
+			PROFILE_NEXT_STAGE(stages, QueryStage::POSTING_FETCH);
+			const auto word_it = word_to_document_freqs_.find(word);
+			if (word_it == word_to_document_freqs_.end()) {
 				continue;
 			}
+			const double inverse_document_freq = ComputeWordInverseDocumentFreq(word, statistics);
 
-			for (const auto& [id, data] : documents_) {
-				if (data.word_freqs.count(word)) {
-					document_to_relevance.erase(id);
+			PROFILE_NEXT_STAGE(stages, QueryStage::SCORE);
+			std::for_each(
+				policy,
+				word_it->second.begin(), word_it->second.end(),
+				[this, &concurrent_map_document_to_relevance, &excluded_documents, inverse_document_freq, filter](const auto& elem) {
+					const auto& id = elem.first;
+					if (excluded_documents.Test(id)) {
+						return;
+					}
+					const auto& data = documents_.at(id);
+					if (filter(id, data.status, data.rating)) {
+						concurrent_map_document_to_relevance[id].ref_to_value += elem.second * inverse_document_freq;
+					}
 				}
-			}
+			);
 		}
 
-		std::vector<Document> matched_documents;
+		PROFILE_NEXT_STAGE(stages, QueryStage::MATERIALIZE);
+		const auto document_to_relevance = concurrent_map_document_to_relevance.BuildOrdinaryMap();
+		matched_documents.clear();
 		for (const auto& [document_id, relevance] : document_to_relevance) {
 			matched_documents.push_back(
 				{
@@ -330,7 +924,5 @@ private:
 				}
 			);
 		}
-
-		return matched_documents;
 	}
 };
\ No newline at end of file
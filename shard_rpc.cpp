@@ -0,0 +1,424 @@
+#include "shard_rpc.h"
+
+#include <climits>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+#ifdef _WIN32
+using SocketLength = int;
+
+void EnsureSocketsInitialized() {
+	static const bool initialized = [] {
+		WSADATA data;
+		return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+	}();
+	if (!initialized) {
+		throw runtime_error("WSAStartup failed"s);
+	}
+}
+
+void CloseSocketHandle(LoopbackSocket::Handle handle) {
+	closesocket(static_cast<SOCKET>(handle));
+}
+
+int PollHandle(LoopbackSocket::Handle handle, short events, int timeout_ms) {
+	WSAPOLLFD descriptor{ static_cast<SOCKET>(handle), events, 0 };
+	return WSAPoll(&descriptor, 1, timeout_ms);
+}
+
+void SetNonBlocking(LoopbackSocket::Handle handle, bool enabled) {
+	u_long mode = enabled ? 1 : 0;
+	ioctlsocket(static_cast<SOCKET>(handle), FIONBIO, &mode);
+}
+
+bool IsWouldBlockError() {
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+#else
+using SocketLength = socklen_t;
+
+void EnsureSocketsInitialized() {
+}
+
+void CloseSocketHandle(LoopbackSocket::Handle handle) {
+	close(handle);
+}
+
+int PollHandle(LoopbackSocket::Handle handle, short events, int timeout_ms) {
+	pollfd descriptor{ handle, events, 0 };
+	return poll(&descriptor, 1, timeout_ms);
+}
+
+void SetNonBlocking(LoopbackSocket::Handle handle, bool enabled) {
+	const int flags = fcntl(handle, F_GETFL, 0);
+	fcntl(handle, F_SETFL, enabled ? flags | O_NONBLOCK : flags & ~O_NONBLOCK);
+}
+
+bool IsWouldBlockError() {
+	return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+#endif
+
+sockaddr_in MakeLoopbackAddress(uint16_t port) {
+	sockaddr_in address{};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return address;
+}
+
+int ToMilliseconds(chrono::milliseconds timeout) {
+	return static_cast<int>(max<chrono::milliseconds::rep>(0, timeout.count()));
+}
+
+void AppendLittleEndian(string& out, uint64_t value, size_t size) {
+	for (size_t i = 0; i < size; ++i) {
+		out += static_cast<char>((value >> (8 * i)) & 0xFF);
+	}
+}
+
+uint64_t ParseLittleEndian(string_view bytes) {
+	uint64_t value = 0;
+	for (size_t i = 0; i < bytes.size(); ++i) {
+		value |= static_cast<uint64_t>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+	}
+	return value;
+}
+
+}
+
+LoopbackSocket::LoopbackSocket(Handle handle)
+	: handle_(handle)
+{
+}
+
+LoopbackSocket::LoopbackSocket(LoopbackSocket&& other) noexcept
+	: handle_(other.handle_)
+{
+	other.handle_ = INVALID_HANDLE;
+}
+
+LoopbackSocket& LoopbackSocket::operator=(LoopbackSocket&& other) noexcept {
+	if (this != &other) {
+		Close();
+		handle_ = other.handle_;
+		other.handle_ = INVALID_HANDLE;
+	}
+	return *this;
+}
+
+LoopbackSocket::~LoopbackSocket() {
+	Close();
+}
+
+LoopbackSocket LoopbackSocket::Listen(uint16_t port) {
+	EnsureSocketsInitialized();
+	LoopbackSocket listener(static_cast<Handle>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)));
+	if (!listener.IsOpen()) {
+		throw runtime_error("Cannot create a socket"s);
+	}
+#ifndef _WIN32
+	// перезапущенный шард должен сразу занять свой порт, не дожидаясь TIME_WAIT
+	const int reuse = 1;
+	setsockopt(listener.handle_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+	const sockaddr_in address = MakeLoopbackAddress(port);
+	if (::bind(listener.handle_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0
+		|| listen(listener.handle_, SOMAXCONN) != 0) {
+		throw runtime_error("Cannot listen on 127.0.0.1:"s + to_string(port));
+	}
+	return listener;
+}
+
+optional<LoopbackSocket> LoopbackSocket::Connect(uint16_t port, chrono::milliseconds timeout) {
+	EnsureSocketsInitialized();
+	LoopbackSocket connection(static_cast<Handle>(socket(AF_INET, SOCK_STREAM, IPPROTO_TCP)));
+	if (!connection.IsOpen()) {
+		return nullopt;
+	}
+	// неблокирующее подключение: недоступный шард не должен задерживать координатор дольше таймаута
+	SetNonBlocking(connection.handle_, true);
+	const sockaddr_in address = MakeLoopbackAddress(port);
+	if (connect(connection.handle_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		if (PollHandle(connection.handle_, POLLOUT, ToMilliseconds(timeout)) <= 0) {
+			return nullopt;
+		}
+		int error = 0;
+		SocketLength length = sizeof(error);
+		getsockopt(connection.handle_, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&error), &length);
+		if (error != 0) {
+			return nullopt;
+		}
+	}
+	SetNonBlocking(connection.handle_, false);
+	// запросы короткие, задержка Нейгла только добавила бы латентность
+	const int no_delay = 1;
+	setsockopt(connection.handle_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+	return connection;
+}
+
+LoopbackSocket LoopbackSocket::Accept() const {
+	LoopbackSocket connection(static_cast<Handle>(accept(handle_, nullptr, nullptr)));
+	if (connection.IsOpen()) {
+		const int no_delay = 1;
+		setsockopt(connection.handle_, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+	}
+	return connection;
+}
+
+bool LoopbackSocket::IsOpen() const {
+	return handle_ != INVALID_HANDLE;
+}
+
+void LoopbackSocket::Close() {
+	if (IsOpen()) {
+		CloseSocketHandle(handle_);
+		handle_ = INVALID_HANDLE;
+	}
+}
+
+uint16_t LoopbackSocket::GetLocalPort() const {
+	sockaddr_in address{};
+	SocketLength length = sizeof(address);
+	if (getsockname(handle_, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+		return 0;
+	}
+	return ntohs(address.sin_port);
+}
+
+bool LoopbackSocket::WaitReadable(chrono::milliseconds timeout) const {
+	return PollHandle(handle_, POLLIN, ToMilliseconds(timeout)) > 0;
+}
+
+bool LoopbackSocket::SendAll(string_view data) const {
+	while (!data.empty()) {
+#ifdef _WIN32
+		const int sent = send(static_cast<SOCKET>(handle_), data.data(), static_cast<int>(min<size_t>(data.size(), INT_MAX)), 0);
+#else
+		const ssize_t sent = send(handle_, data.data(), data.size(), MSG_NOSIGNAL);
+#endif
+		if (sent <= 0) {
+			return false;
+		}
+		data.remove_prefix(static_cast<size_t>(sent));
+	}
+	return true;
+}
+
+bool LoopbackSocket::SendAll(string_view data, chrono::milliseconds timeout) const {
+	const auto deadline = chrono::steady_clock::now() + timeout;
+	// неблокирующая отправка: шард, переставший читать, не должен задерживать отправителя дольше таймаута
+	SetNonBlocking(handle_, true);
+	bool sent_all = true;
+	while (!data.empty()) {
+#ifdef _WIN32
+		const int sent = send(static_cast<SOCKET>(handle_), data.data(), static_cast<int>(min<size_t>(data.size(), INT_MAX)), 0);
+#else
+		const ssize_t sent = send(handle_, data.data(), data.size(), MSG_NOSIGNAL);
+#endif
+		if (sent > 0) {
+			data.remove_prefix(static_cast<size_t>(sent));
+			continue;
+		}
+		const auto remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now());
+		if (sent == 0 || !IsWouldBlockError() || remaining.count() <= 0 || PollHandle(handle_, POLLOUT, ToMilliseconds(remaining)) <= 0) {
+			sent_all = false;
+			break;
+		}
+	}
+	SetNonBlocking(handle_, false);
+	return sent_all;
+}
+
+size_t LoopbackSocket::Receive(char* buffer, size_t size) const {
+#ifdef _WIN32
+	const int received = recv(static_cast<SOCKET>(handle_), buffer, static_cast<int>(min<size_t>(size, INT_MAX)), 0);
+#else
+	const ssize_t received = recv(handle_, buffer, size, 0);
+#endif
+	return received < 0 ? SIZE_MAX : static_cast<size_t>(received);
+}
+
+ShardMessageWriter::ShardMessageWriter(ShardMessageType type)
+	: frame_(4, '\0')
+{
+	frame_ += static_cast<char>(type);
+}
+
+void ShardMessageWriter::WriteUint32(uint32_t value) {
+	AppendLittleEndian(frame_, value, 4);
+}
+
+void ShardMessageWriter::WriteInt32(int32_t value) {
+	AppendLittleEndian(frame_, static_cast<uint32_t>(value), 4);
+}
+
+void ShardMessageWriter::WriteDouble(double value) {
+	uint64_t bits = 0;
+	static_assert(sizeof(bits) == sizeof(value));
+	memcpy(&bits, &value, sizeof(bits));
+	AppendLittleEndian(frame_, bits, 8);
+}
+
+void ShardMessageWriter::WriteString(string_view text) {
+	WriteUint32(static_cast<uint32_t>(text.size()));
+	frame_.append(text);
+}
+
+void ShardMessageWriter::WriteStatistics(const SearchServer::TermStatistics& statistics) {
+	WriteInt32(statistics.document_count);
+	WriteUint32(static_cast<uint32_t>(statistics.document_freqs.size()));
+	for (const auto& [word, document_freq] : statistics.document_freqs) {
+		WriteString(word);
+		WriteInt32(document_freq);
+	}
+}
+
+void ShardMessageWriter::WriteDocuments(const vector<Document>& documents) {
+	WriteUint32(static_cast<uint32_t>(documents.size()));
+	for (const Document& document : documents) {
+		WriteInt32(document.id);
+		WriteInt32(document.rating);
+		WriteDouble(document.relevance);
+	}
+}
+
+string ShardMessageWriter::Finish() {
+	const uint64_t payload_size = frame_.size() - 4;
+	for (size_t i = 0; i < 4; ++i) {
+		frame_[i] = static_cast<char>((payload_size >> (8 * i)) & 0xFF);
+	}
+	return move(frame_);
+}
+
+ShardMessageReader::ShardMessageReader(string_view payload)
+	: payload_(payload)
+{
+	if (payload_.empty()) {
+		throw invalid_argument("Empty shard message"s);
+	}
+}
+
+ShardMessageType ShardMessageReader::GetType() const {
+	return static_cast<ShardMessageType>(payload_[0]);
+}
+
+string_view ShardMessageReader::ReadBytes(size_t size) {
+	if (payload_.size() - position_ < size) {
+		throw invalid_argument("Truncated shard message"s);
+	}
+	const string_view bytes = payload_.substr(position_, size);
+	position_ += size;
+	return bytes;
+}
+
+uint32_t ShardMessageReader::ReadUint32() {
+	return static_cast<uint32_t>(ParseLittleEndian(ReadBytes(4)));
+}
+
+int32_t ShardMessageReader::ReadInt32() {
+	return static_cast<int32_t>(ReadUint32());
+}
+
+double ShardMessageReader::ReadDouble() {
+	const uint64_t bits = ParseLittleEndian(ReadBytes(8));
+	double value = 0.0;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+string_view ShardMessageReader::ReadString() {
+	return ReadBytes(ReadUint32());
+}
+
+SearchServer::TermStatistics ShardMessageReader::ReadStatistics() {
+	SearchServer::TermStatistics statistics;
+	statistics.document_count = ReadInt32();
+	const uint32_t word_count = ReadUint32();
+	for (uint32_t i = 0; i < word_count; ++i) {
+		const string_view word = ReadString();
+		statistics.document_freqs[string(word)] = ReadInt32();
+	}
+	return statistics;
+}
+
+vector<Document> ShardMessageReader::ReadDocuments() {
+	const uint32_t count = ReadUint32();
+	// размер проверяется до reserve: повреждённый счётчик не должен вызывать огромное выделение
+	if (count > (payload_.size() - position_) / 16) {
+		throw invalid_argument("Truncated shard message"s);
+	}
+	vector<Document> documents;
+	documents.reserve(count);
+	for (uint32_t i = 0; i < count; ++i) {
+		Document document;
+		document.id = ReadInt32();
+		document.rating = ReadInt32();
+		document.relevance = ReadDouble();
+		documents.push_back(document);
+	}
+	return documents;
+}
+
+void ShardFrameBuffer::Append(const char* data, size_t size) {
+	buffer_.append(data, size);
+}
+
+optional<string> ShardFrameBuffer::PopFrame() {
+	if (buffer_.size() < 4) {
+		return nullopt;
+	}
+	const size_t payload_size = static_cast<size_t>(ParseLittleEndian(string_view(buffer_).substr(0, 4)));
+	if (payload_size > MAX_SHARD_FRAME_SIZE) {
+		throw invalid_argument("Shard frame is too large"s);
+	}
+	if (buffer_.size() < 4 + payload_size) {
+		return nullopt;
+	}
+	string payload = buffer_.substr(4, payload_size);
+	buffer_.erase(0, 4 + payload_size);
+	return payload;
+}
+
+void ShardFrameBuffer::Clear() {
+	buffer_.clear();
+}
+
+optional<string> ReceiveFrame(const LoopbackSocket& socket, ShardFrameBuffer& buffer, chrono::milliseconds timeout) {
+	const auto deadline = chrono::steady_clock::now() + timeout;
+	char chunk[4096];
+	while (true) {
+		if (auto frame = buffer.PopFrame()) {
+			return frame;
+		}
+		const auto remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now());
+		if (remaining.count() <= 0 || !socket.WaitReadable(remaining)) {
+			return nullopt;
+		}
+		const size_t received = socket.Receive(chunk, sizeof(chunk));
+		if (received == 0 || received == SIZE_MAX) {
+			return nullopt;
+		}
+		buffer.Append(chunk, received);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "search_server.h"
+
+// Сокет TCP, привязанный к 127.0.0.1: шарды и координатор работают на одной машине
+class LoopbackSocket {
+public:
+#ifdef _WIN32
+	using Handle = uintptr_t;
+#else
+	using Handle = int;
+#endif
+
+	LoopbackSocket() = default;
+	LoopbackSocket(const LoopbackSocket&) = delete;
+	LoopbackSocket& operator=(const LoopbackSocket&) = delete;
+	LoopbackSocket(LoopbackSocket&& other) noexcept;
+	LoopbackSocket& operator=(LoopbackSocket&& other) noexcept;
+	~LoopbackSocket();
+
+	// port 0 — свободный порт, выбранный ОС
+	static LoopbackSocket Listen(uint16_t port);
+	// nullopt, если соединение не установлено за timeout
+	static std::optional<LoopbackSocket> Connect(uint16_t port, std::chrono::milliseconds timeout);
+	LoopbackSocket Accept() const;
+
+	bool IsOpen() const;
+	void Close();
+	uint16_t GetLocalPort() const;
+
+	// true, если за timeout появились данные для чтения (или соединение закрыто)
+	bool WaitReadable(std::chrono::milliseconds timeout) const;
+	// false при разрыве соединения
+	bool SendAll(std::string_view data) const;
+	// false при разрыве соединения или если данные не ушли за timeout; после неудачи часть
+	// данных могла уйти, поэтому соединение нужно закрыть
+	bool SendAll(std::string_view data, std::chrono::milliseconds timeout) const;
+	// 0 — соединение закрыто, SIZE_MAX — ошибка
+	size_t Receive(char* buffer, size_t size) const;
+
+private:
+	Handle handle_ = INVALID_HANDLE;
+
+#ifdef _WIN32
+	static constexpr Handle INVALID_HANDLE = ~Handle{ 0 };
+#else
+	static constexpr Handle INVALID_HANDLE = -1;
+#endif
+
+	explicit LoopbackSocket(Handle handle);
+};
+
+// Протокол шардов: кадр — длина полезной нагрузки (uint32, little-endian) и нагрузка,
+// первый байт которой — тип сообщения. Числа кодируются little-endian фиксированной ширины,
+// строки — длиной uint32 и байтами, double — битами IEEE 754
+enum class ShardMessageType : uint8_t {
+	ADD_DOCUMENT = 1,
+	REMOVE_DOCUMENT = 2,
+	COLLECT_STATISTICS = 3,
+	FIND_TOP_DOCUMENTS = 4,
+	GET_DOCUMENT_COUNT = 5,
+
+	OK = 64,
+	FAILURE = 65,
+	STATISTICS = 66,
+	DOCUMENTS = 67,
+	DOCUMENT_COUNT = 68,
+};
+
+constexpr size_t MAX_SHARD_FRAME_SIZE = 64 << 20;
+
+class ShardMessageWriter {
+public:
+	explicit ShardMessageWriter(ShardMessageType type);
+
+	void WriteUint32(uint32_t value);
+	void WriteInt32(int32_t value);
+	void WriteDouble(double value);
+	void WriteString(std::string_view text);
+	void WriteStatistics(const SearchServer::TermStatistics& statistics);
+	void WriteDocuments(const std::vector<Document>& documents);
+
+	// Готовый кадр вместе с заголовком длины
+	std::string Finish();
+
+private:
+	std::string frame_;
+};
+
+// Читает нагрузку одного кадра; при выходе за её границы бросает invalid_argument
+class ShardMessageReader {
+public:
+	explicit ShardMessageReader(std::string_view payload);
+
+	ShardMessageType GetType() const;
+	uint32_t ReadUint32();
+	int32_t ReadInt32();
+	double ReadDouble();
+	std::string_view ReadString();
+	SearchServer::TermStatistics ReadStatistics();
+	std::vector<Document> ReadDocuments();
+
+private:
+	std::string_view payload_;
+	size_t position_ = 1;
+
+	std::string_view ReadBytes(size_t size);
+};
+
+// Накопитель входящих байтов соединения: выдаёт нагрузки целых кадров
+class ShardFrameBuffer {
+public:
+	void Append(const char* data, size_t size);
+	// nullopt, пока кадр не пришёл целиком; invalid_argument при слишком длинном кадре
+	std::optional<std::string> PopFrame();
+	void Clear();
+
+private:
+	std::string buffer_;
+};
+
+// Читает один кадр, ожидая не дольше timeout; nullopt при таймауте или разрыве соединения
+std::optional<std::string> ReceiveFrame(const LoopbackSocket& socket, ShardFrameBuffer& buffer, std::chrono::milliseconds timeout);
\ No newline at end of file
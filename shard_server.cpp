@@ -0,0 +1,344 @@
+#include "shard_server.h"
+#include "sharded_search_server.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace {
+
+DocumentStatus ReadStatus(ShardMessageReader& reader) {
+	const int32_t status = reader.ReadInt32();
+	if (status < static_cast<int32_t>(DocumentStatus::ACTUAL) || status > static_cast<int32_t>(DocumentStatus::REMOVED)) {
+		throw invalid_argument("Invalid document status"s);
+	}
+	return static_cast<DocumentStatus>(status);
+}
+
+string MakeFailure(string_view message) {
+	ShardMessageWriter writer(ShardMessageType::FAILURE);
+	writer.WriteString(message);
+	return writer.Finish();
+}
+
+// Проверяет тип ответа; сообщение FAILURE превращается в invalid_argument с текстом шарда
+void ExpectResponse(ShardMessageReader& reader, ShardMessageType type) {
+	if (reader.GetType() == ShardMessageType::FAILURE) {
+		throw invalid_argument("Shard error: "s + string(reader.ReadString()));
+	}
+	if (reader.GetType() != type) {
+		throw runtime_error("Unexpected shard response"s);
+	}
+}
+
+}
+
+ShardServer::ShardServer(SearchServer& search_server, uint16_t port)
+	: search_server_(search_server)
+	, listener_(LoopbackSocket::Listen(port))
+{
+}
+
+ShardServer::~ShardServer() {
+	Stop();
+}
+
+uint16_t ShardServer::GetPort() const {
+	return listener_.GetLocalPort();
+}
+
+void ShardServer::Run() {
+	while (!stopping_) {
+		ReapConnections();
+		if (!listener_.WaitReadable(POLL_INTERVAL)) {
+			continue;
+		}
+		LoopbackSocket connection = listener_.Accept();
+		if (connection.IsOpen()) {
+			auto state = make_unique<Connection>();
+			// поток присоединяет только Run, поэтому флаг может выставиться до записи worker
+			state->worker = thread([this, &finished = state->finished, connection = move(connection)]() mutable {
+				ServeConnection(move(connection));
+				finished = true;
+			});
+			lock_guard guard(connections_mutex_);
+			connections_.push_back(move(state));
+		}
+	}
+
+	lock_guard guard(connections_mutex_);
+	for (const auto& connection : connections_) {
+		connection->worker.join();
+	}
+	connections_.clear();
+}
+
+size_t ShardServer::GetConnectionCount() const {
+	lock_guard guard(connections_mutex_);
+	return connections_.size();
+}
+
+void ShardServer::ReapConnections() {
+	lock_guard guard(connections_mutex_);
+	const auto finished_begin = partition(connections_.begin(), connections_.end(), [](const unique_ptr<Connection>& connection) {
+		return !connection->finished;
+	});
+	for (auto it = finished_begin; it != connections_.end(); ++it) {
+		(*it)->worker.join();
+	}
+	connections_.erase(finished_begin, connections_.end());
+}
+
+void ShardServer::Stop() {
+	stopping_ = true;
+}
+
+void ShardServer::ServeConnection(LoopbackSocket connection) {
+	ShardFrameBuffer buffer;
+	char chunk[4096];
+	while (!stopping_) {
+		if (!connection.WaitReadable(POLL_INTERVAL)) {
+			continue;
+		}
+		const size_t received = connection.Receive(chunk, sizeof(chunk));
+		if (received == 0 || received == SIZE_MAX) {
+			return;
+		}
+		buffer.Append(chunk, received);
+		try {
+			while (auto payload = buffer.PopFrame()) {
+				if (!connection.SendAll(HandleRequest(*payload))) {
+					return;
+				}
+			}
+		} catch (const invalid_argument&) {
+			// слишком длинный кадр: поток байтов рассинхронизирован, соединение закрывается
+			return;
+		}
+	}
+}
+
+string ShardServer::HandleRequest(string_view payload) {
+	try {
+		ShardMessageReader reader(payload);
+		switch (reader.GetType()) {
+		case ShardMessageType::ADD_DOCUMENT: {
+			const int document_id = reader.ReadInt32();
+			const DocumentStatus status = ReadStatus(reader);
+			vector<int> ratings;
+			for (uint32_t count = reader.ReadUint32(); count > 0; --count) {
+				ratings.push_back(reader.ReadInt32());
+			}
+			const string_view document = reader.ReadString();
+			unique_lock lock(index_mutex_);
+			search_server_.AddDocument(document_id, document, status, ratings);
+			return ShardMessageWriter(ShardMessageType::OK).Finish();
+		}
+		case ShardMessageType::REMOVE_DOCUMENT: {
+			const int document_id = reader.ReadInt32();
+			unique_lock lock(index_mutex_);
+			search_server_.RemoveDocument(document_id);
+			return ShardMessageWriter(ShardMessageType::OK).Finish();
+		}
+		case ShardMessageType::COLLECT_STATISTICS: {
+			const string_view raw_query = reader.ReadString();
+			SearchServer::TermStatistics statistics;
+			{
+				shared_lock lock(index_mutex_);
+				search_server_.CollectTermStatistics(raw_query, statistics);
+			}
+			ShardMessageWriter writer(ShardMessageType::STATISTICS);
+			writer.WriteStatistics(statistics);
+			return writer.Finish();
+		}
+		case ShardMessageType::FIND_TOP_DOCUMENTS: {
+			const string_view raw_query = reader.ReadString();
+			const DocumentStatus status = ReadStatus(reader);
+			const SearchServer::TermStatistics statistics = reader.ReadStatistics();
+			vector<Document> documents;
+			{
+				shared_lock lock(index_mutex_);
+				search_server_.FillTopDocuments(execution::seq, raw_query,
+					[status](int, DocumentStatus document_status, int) {
+						return document_status == status;
+					},
+					&statistics, documents);
+			}
+			ShardMessageWriter writer(ShardMessageType::DOCUMENTS);
+			writer.WriteDocuments(documents);
+			return writer.Finish();
+		}
+		case ShardMessageType::GET_DOCUMENT_COUNT: {
+			ShardMessageWriter writer(ShardMessageType::DOCUMENT_COUNT);
+			shared_lock lock(index_mutex_);
+			writer.WriteInt32(search_server_.GetDocumentCount());
+			return writer.Finish();
+		}
+		default:
+			return MakeFailure("Unknown shard request"sv);
+		}
+	} catch (const exception& e) {
+		return MakeFailure(e.what());
+	}
+}
+
+ShardCoordinator::ShardCoordinator(const vector<uint16_t>& shard_ports, chrono::milliseconds timeout)
+	: shards_(shard_ports.size())
+	, timeout_(timeout)
+{
+	if (shard_ports.empty()) {
+		throw invalid_argument("Shard list is empty"s);
+	}
+	for (size_t i = 0; i < shard_ports.size(); ++i) {
+		shards_[i].port = shard_ports[i];
+	}
+}
+
+void ShardCoordinator::AddDocument(int document_id, string_view document, DocumentStatus status, const vector<int>& ratings) {
+	ShardMessageWriter writer(ShardMessageType::ADD_DOCUMENT);
+	writer.WriteInt32(document_id);
+	writer.WriteInt32(static_cast<int32_t>(status));
+	writer.WriteUint32(static_cast<uint32_t>(ratings.size()));
+	for (const int rating : ratings) {
+		writer.WriteInt32(rating);
+	}
+	writer.WriteString(document);
+	const string response = ExchangeWithShard(GetDocumentShard(document_id, shards_.size()), writer.Finish());
+	ShardMessageReader reader(response);
+	ExpectResponse(reader, ShardMessageType::OK);
+}
+
+void ShardCoordinator::RemoveDocument(int document_id) {
+	ShardMessageWriter writer(ShardMessageType::REMOVE_DOCUMENT);
+	writer.WriteInt32(document_id);
+	const string response = ExchangeWithShard(GetDocumentShard(document_id, shards_.size()), writer.Finish());
+	ShardMessageReader reader(response);
+	ExpectResponse(reader, ShardMessageType::OK);
+}
+
+vector<Document> ShardCoordinator::FindTopDocuments(string_view raw_query, DocumentStatus status, ShardQueryOutcome* outcome) {
+	ShardQueryOutcome local_outcome;
+	ShardQueryOutcome& result_outcome = outcome != nullptr ? *outcome : local_outcome;
+	result_outcome = { shards_.size(), {} };
+
+	// первый проход: частоты слов со всех шардов для общего IDF
+	ShardMessageWriter statistics_request(ShardMessageType::COLLECT_STATISTICS);
+	statistics_request.WriteString(raw_query);
+	const auto statistics_responses = Exchange(vector<string>(shards_.size(), statistics_request.Finish()));
+
+	SearchServer::TermStatistics statistics;
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		if (!statistics_responses[i]) {
+			continue;
+		}
+		ShardMessageReader reader(*statistics_responses[i]);
+		ExpectResponse(reader, ShardMessageType::STATISTICS);
+		MergeTermStatistics(statistics, reader.ReadStatistics());
+	}
+
+	// второй проход только по ответившим шардам
+	ShardMessageWriter search_writer(ShardMessageType::FIND_TOP_DOCUMENTS);
+	search_writer.WriteString(raw_query);
+	search_writer.WriteInt32(static_cast<int32_t>(status));
+	search_writer.WriteStatistics(statistics);
+	const string search_request = search_writer.Finish();
+	vector<string> search_requests(shards_.size());
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		if (statistics_responses[i]) {
+			search_requests[i] = search_request;
+		}
+	}
+	const auto search_responses = Exchange(search_requests);
+
+	vector<vector<Document>> shard_results(shards_.size());
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		if (!search_responses[i]) {
+			result_outcome.failed_shards.push_back(i);
+			continue;
+		}
+		ShardMessageReader reader(*search_responses[i]);
+		ExpectResponse(reader, ShardMessageType::DOCUMENTS);
+		shard_results[i] = reader.ReadDocuments();
+	}
+
+	return MergeTopDocuments(shard_results);
+}
+
+int ShardCoordinator::GetDocumentCount(ShardQueryOutcome* outcome) {
+	const auto responses = Exchange(vector<string>(shards_.size(), ShardMessageWriter(ShardMessageType::GET_DOCUMENT_COUNT).Finish()));
+	int document_count = 0;
+	if (outcome != nullptr) {
+		*outcome = { shards_.size(), {} };
+	}
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		if (!responses[i]) {
+			if (outcome != nullptr) {
+				outcome->failed_shards.push_back(i);
+			}
+			continue;
+		}
+		ShardMessageReader reader(*responses[i]);
+		ExpectResponse(reader, ShardMessageType::DOCUMENT_COUNT);
+		document_count += reader.ReadInt32();
+	}
+	return document_count;
+}
+
+size_t ShardCoordinator::GetShardCount() const {
+	return shards_.size();
+}
+
+vector<optional<string>> ShardCoordinator::Exchange(const vector<string>& requests) {
+	using Clock = chrono::steady_clock;
+	const Clock::time_point deadline = Clock::now() + timeout_;
+	const auto remaining = [deadline] {
+		return max(chrono::milliseconds(0), chrono::duration_cast<chrono::milliseconds>(deadline - Clock::now()));
+	};
+
+	// сначала запросы уходят всем шардам, затем собираются ответы: шарды работают одновременно
+	vector<bool> sent(shards_.size(), false);
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		if (requests[i].empty()) {
+			continue;
+		}
+		ShardConnection& shard = shards_[i];
+		if (!shard.socket.IsOpen()) {
+			auto connection = LoopbackSocket::Connect(shard.port, remaining());
+			if (!connection) {
+				continue;
+			}
+			shard.socket = move(*connection);
+			shard.buffer.Clear();
+		}
+		sent[i] = shard.socket.SendAll(requests[i], remaining());
+		if (!sent[i]) {
+			shard.socket.Close();
+		}
+	}
+
+	vector<optional<string>> responses(shards_.size());
+	for (size_t i = 0; i < shards_.size(); ++i) {
+		if (!sent[i]) {
+			continue;
+		}
+		ShardConnection& shard = shards_[i];
+		responses[i] = ReceiveFrame(shard.socket, shard.buffer, remaining());
+		if (!responses[i]) {
+			// опоздавший ответ рассинхронизировал бы поток, поэтому соединение закрывается
+			shard.socket.Close();
+			shard.buffer.Clear();
+		}
+	}
+	return responses;
+}
+
+string ShardCoordinator::ExchangeWithShard(size_t shard, string request) {
+	vector<string> requests(shards_.size());
+	requests[shard] = move(request);
+	auto responses = Exchange(requests);
+	if (!responses[shard]) {
+		throw runtime_error("Shard "s + to_string(shard) + " is unavailable"s);
+	}
+	return move(*responses[shard]);
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "search_server.h"
+#include "shard_rpc.h"
+
+// Шард в отдельном процессе: обслуживает координаторов по протоколу shard_rpc.h.
+// Запросы выполняются параллельно, изменения индекса — под исключительной блокировкой
+class ShardServer {
+public:
+	// port 0 — свободный порт, выбранный ОС
+	explicit ShardServer(SearchServer& search_server, uint16_t port = 0);
+	ShardServer(const ShardServer&) = delete;
+	ShardServer& operator=(const ShardServer&) = delete;
+	~ShardServer();
+
+	uint16_t GetPort() const;
+
+	// Принимает соединения до вызова Stop, каждое соединение обслуживается своим потоком.
+	// Потоки закрытых соединений присоединяются в цикле приёма, а не копятся до Stop
+	void Run();
+	// Можно вызывать из любого потока; Run завершится в течение POLL_INTERVAL.
+	// Поток с Run нужно дождаться до уничтожения сервера
+	void Stop();
+
+	// Ответ на одну нагрузку кадра; ошибки запроса возвращаются сообщением FAILURE
+	std::string HandleRequest(std::string_view payload);
+	// Потоки соединений, ещё не присоединённые Run
+	size_t GetConnectionCount() const;
+
+private:
+	static constexpr std::chrono::milliseconds POLL_INTERVAL{ 50 };
+
+	SearchServer& search_server_;
+	std::shared_mutex index_mutex_;
+	LoopbackSocket listener_;
+	std::atomic<bool> stopping_{ false };
+	struct Connection {
+		std::thread worker;
+		std::atomic<bool> finished{ false };
+	};
+
+	mutable std::mutex connections_mutex_;
+	std::vector<std::unique_ptr<Connection>> connections_;
+
+	void ServeConnection(LoopbackSocket connection);
+	// Присоединяет потоки завершившихся соединений
+	void ReapConnections();
+};
+
+struct ShardQueryOutcome {
+	size_t shard_count = 0;
+	// шарды, не ответившие до таймаута или недоступные; их документы в результат не попали
+	std::vector<size_t> failed_shards;
+
+	bool IsPartial() const {
+		return !failed_shards.empty();
+	}
+};
+
+// Координатор рассылает запросы шардам-процессам и сливает их ответы так же, как
+// ShardedSearchServer: общий IDF из частот всех ответивших шардов и k-путевое слияние.
+// Шард, не ответивший за timeout, пропускается — результат получается частичным,
+// а соединение с ним пересоздаётся при следующем запросе. Координатор не потокобезопасен
+class ShardCoordinator {
+public:
+	// shard_ports[i] — порт шарда i на 127.0.0.1; документы распределяются по GetDocumentShard
+	explicit ShardCoordinator(const std::vector<uint16_t>& shard_ports, std::chrono::milliseconds timeout = std::chrono::milliseconds(200));
+
+	// Бросают runtime_error, если шард документа недоступен, и invalid_argument, если шард отверг запрос.
+	// Запросы не идемпотентны: после runtime_error по таймауту шард мог всё же применить изменение,
+	// и повтор AddDocument с тем же id тогда завершится invalid_argument о повторном id
+	void AddDocument(int document_id, std::string_view document, DocumentStatus status, const std::vector<int>& ratings);
+	void RemoveDocument(int document_id);
+
+	std::vector<Document> FindTopDocuments(std::string_view raw_query, DocumentStatus status = DocumentStatus::ACTUAL, ShardQueryOutcome* outcome = nullptr);
+	int GetDocumentCount(ShardQueryOutcome* outcome = nullptr);
+
+	size_t GetShardCount() const;
+
+private:
+	struct ShardConnection {
+		uint16_t port = 0;
+		LoopbackSocket socket;
+		ShardFrameBuffer buffer;
+	};
+
+	std::vector<ShardConnection> shards_;
+	std::chrono::milliseconds timeout_;
+
+	// Отправляет requests[i] шарду i (пустой запрос — шард пропускается) и ждёт ответов
+	// до общего дедлайна; nullopt — шард не ответил
+	std::vector<std::optional<std::string>> Exchange(const std::vector<std::string>& requests);
+	std::string ExchangeWithShard(size_t shard, std::string request);
+};
\ No newline at end of file
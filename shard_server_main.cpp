@@ -0,0 +1,81 @@
+#include "corpus_loader.h"
+#include "shard_server.h"
+#include "sharded_search_server.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void PrintUsage() {
+	cerr << "Usage: ShardServer [--port=N] [--stop-words=\"a b c\"]\n"s
+		<< "                   [--corpus=FILE [--format=tsv|jsonl] [--shard=I/N]]\n"s
+		<< "--shard=I/N keeps only the corpus documents that a coordinator with N shards routes to shard I."s << endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+	uint16_t port = 0;
+	string stop_words;
+	string corpus_path;
+	CorpusLoaderOptions loader_options;
+	size_t shard_index = 0;
+	size_t shard_count = 1;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			const string argument = argv[i];
+			const size_t equals = argument.find('=');
+			const string key = argument.substr(0, equals);
+			const string value = equals == string::npos ? ""s : argument.substr(equals + 1);
+
+			if (key == "--port"s) {
+				port = static_cast<uint16_t>(stoul(value));
+			} else if (key == "--stop-words"s) {
+				stop_words = value;
+			} else if (key == "--corpus"s) {
+				corpus_path = value;
+			} else if (key == "--format"s && (value == "tsv"s || value == "jsonl"s)) {
+				loader_options.format = value == "tsv"s ? CorpusFormat::TSV : CorpusFormat::JSON_LINES;
+			} else if (key == "--shard"s && value.find('/') != string::npos) {
+				shard_index = stoull(value.substr(0, value.find('/')));
+				shard_count = stoull(value.substr(value.find('/') + 1));
+				if (shard_count == 0 || shard_index >= shard_count) {
+					throw invalid_argument("shard index must be below shard count"s);
+				}
+			} else {
+				PrintUsage();
+				return 1;
+			}
+		}
+	} catch (const exception& e) {
+		cerr << "Invalid argument: "s << e.what() << endl;
+		PrintUsage();
+		return 1;
+	}
+
+	try {
+		SearchServer search_server(stop_words);
+		if (!corpus_path.empty()) {
+			loader_options.document_filter = [shard_index, shard_count](int document_id) {
+				return GetDocumentShard(document_id, shard_count) == shard_index;
+			};
+			const CorpusLoadStats stats = LoadCorpusFile(search_server, corpus_path, loader_options);
+			cerr << "Loaded "s << stats.document_count << " documents"s << endl;
+		}
+
+		ShardServer server(search_server, port);
+		// координатору и скриптам нужен фактический порт, если он выбран ОС
+		cout << "Listening on 127.0.0.1:"s << server.GetPort() << endl;
+		server.Run();
+	} catch (const exception& e) {
+		cerr << "Shard server failed: "s << e.what() << endl;
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "sharded_search_server.h"
+
+#include <fstream>
+#include <numeric>
+#include <queue>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+bool PinCurrentThread(const vector<int>& cpus) {
+	if (cpus.empty()) {
+		return false;
+	}
+#ifdef _WIN32
+	DWORD_PTR mask = 0;
+	for (const int cpu : cpus) {
+		if (cpu >= 0 && cpu < static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+			mask |= DWORD_PTR{ 1 } << cpu;
+		}
+	}
+	return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (const int cpu : cpus) {
+		if (cpu >= 0 && cpu < CPU_SETSIZE) {
+			CPU_SET(cpu, &set);
+		}
+	}
+	return CPU_COUNT(&set) > 0 && pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+bool IsMoreRelevant(const Document& lhs, const Document& rhs) {
+	if (abs(lhs.relevance - rhs.relevance) < 1e-6) {
+		return lhs.rating > rhs.rating;
+	}
+	return lhs.relevance > rhs.relevance;
+}
+
+uint64_t MixDocumentId(int document_id) {
+	// финализатор splitmix64
+	uint64_t x = static_cast<uint64_t>(static_cast<uint32_t>(document_id)) + 0x9E3779B97F4A7C15ULL;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+	return x ^ (x >> 31);
+}
+
+}
+
+ShardWorker::ShardWorker(const vector<int>& cpus)
+	: thread_([this] { Run(); })
+{
+	pinned_ = Submit([&cpus] {
+		return PinCurrentThread(cpus);
+	}).get();
+}
+
+ShardWorker::~ShardWorker() {
+	{
+		lock_guard guard(mutex_);
+		stopping_ = true;
+	}
+	task_available_.notify_one();
+	thread_.join();
+}
+
+bool ShardWorker::IsPinned() const {
+	return pinned_;
+}
+
+void ShardWorker::Post(function<void()> task) {
+	{
+		lock_guard guard(mutex_);
+		tasks_.push_back(move(task));
+	}
+	task_available_.notify_one();
+}
+
+void ShardWorker::Run() {
+	while (true) {
+		function<void()> task;
+		{
+			unique_lock lock(mutex_);
+			task_available_.wait(lock, [this] {
+				return stopping_ || !tasks_.empty();
+			});
+			if (tasks_.empty()) {
+				return;
+			}
+			task = move(tasks_.front());
+			tasks_.pop_front();
+		}
+		task();
+	}
+}
+
+vector<int> GetNumaNodeCpus(int node) {
+	vector<int> cpus;
+	if (node < 0) {
+		return cpus;
+	}
+#ifdef _WIN32
+	ULONGLONG mask = 0;
+	if (node <= 0xFF && GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask)) {
+		for (int cpu = 0; cpu < 64; ++cpu) {
+			if (mask & (ULONGLONG{ 1 } << cpu)) {
+				cpus.push_back(cpu);
+			}
+		}
+	}
+#elif defined(__linux__)
+	// формат cpulist: "0-3,8-11"
+	ifstream input("/sys/devices/system/node/node"s + to_string(node) + "/cpulist"s);
+	string range;
+	while (getline(input, range, ',')) {
+		const size_t dash = range.find('-');
+		try {
+			const int first = stoi(range.substr(0, dash));
+			const int last = dash == string::npos ? first : stoi(range.substr(dash + 1));
+			for (int cpu = first; cpu <= last; ++cpu) {
+				cpus.push_back(cpu);
+			}
+		} catch (const exception&) {
+			return {};
+		}
+	}
+#endif
+	return cpus;
+}
+
+void ShardedSearchServer::AddDocument(int document_id, const string_view& document, DocumentStatus status, const vector<int>& ratings) {
+	const size_t index = GetShardIndex(document_id);
+	if (workers_[index]->IsPinned()) {
+		// новые слова и частоты выделяются потоком шарда, то есть на его узле
+		workers_[index]->Submit([&] {
+			shards_[index]->AddDocument(document_id, document, status, ratings);
+		}).get();
+	} else {
+		shards_[index]->AddDocument(document_id, document, status, ratings);
+	}
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(const string_view& raw_query) const {
+	return FindTopDocuments(execution::seq, raw_query, DocumentStatus::ACTUAL);
+}
+
+vector<Document> ShardedSearchServer::FindTopDocuments(const string_view& raw_query, DocumentStatus status) const {
+	return FindTopDocuments(execution::seq, raw_query, status);
+}
+
+tuple<vector<string_view>, DocumentStatus> ShardedSearchServer::MatchDocument(const string_view& raw_query, int document_id) const {
+	return MatchDocument(execution::seq, raw_query, document_id);
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id) {
+	RemoveDocument(execution::seq, document_id);
+}
+
+void ShardedSearchServer::SetFuzzyEditDistance(int max_distance) {
+	for (const auto& shard : shards_) {
+		shard->SetFuzzyEditDistance(max_distance);
+	}
+}
+
+int ShardedSearchServer::GetDocumentCount() const {
+	return accumulate(shards_.begin(), shards_.end(), 0,
+		[](int count, const unique_ptr<SearchServer>& shard) {
+			return count + shard->GetDocumentCount();
+		}
+	);
+}
+
+size_t ShardedSearchServer::GetShardCount() const {
+	return shards_.size();
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const {
+	return GetDocumentShard(document_id, shards_.size());
+}
+
+const SearchServer& ShardedSearchServer::GetShard(size_t index) const {
+	return *shards_.at(index);
+}
+
+bool ShardedSearchServer::IsShardPinned(size_t index) const {
+	return workers_.at(index)->IsPinned();
+}
+
+size_t GetDocumentShard(int document_id, size_t shard_count) {
+	return MixDocumentId(document_id) % shard_count;
+}
+
+void MergeTermStatistics(SearchServer::TermStatistics& total, const SearchServer::TermStatistics& shard) {
+	total.document_count += shard.document_count;
+	for (const auto& [word, document_freq] : shard.document_freqs) {
+		total.document_freqs[word] += document_freq;
+	}
+}
+
+vector<Document> MergeTopDocuments(const vector<vector<Document>>& shard_results) {
+	// в куче лежит по одному кандидату от каждого шарда: (шард, позиция)
+	const auto is_less_relevant = [&shard_results](const pair<size_t, size_t>& lhs, const pair<size_t, size_t>& rhs) {
+		return IsMoreRelevant(shard_results[rhs.first][rhs.second], shard_results[lhs.first][lhs.second]);
+	};
+	priority_queue<pair<size_t, size_t>, vector<pair<size_t, size_t>>, decltype(is_less_relevant)> candidates(is_less_relevant);
+	for (size_t shard = 0; shard < shard_results.size(); ++shard) {
+		if (!shard_results[shard].empty()) {
+			candidates.push({ shard, 0 });
+		}
+	}
+
+	vector<Document> result;
+	while (!candidates.empty() && result.size() < static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)) {
+		const auto [shard, position] = candidates.top();
+		candidates.pop();
+		result.push_back(shard_results[shard][position]);
+		if (position + 1 < shard_results[shard].size()) {
+			candidates.push({ shard, position + 1 });
+		}
+	}
+	return result;
+}
\ No newline at end of file
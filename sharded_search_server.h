@@ -0,0 +1,202 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <execution>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "search_server.h"
+
+// Поток, за которым закреплён шард: он создаёт структуры шарда и выполняет его часть
+// параллельных запросов. Привязка потока к процессорам вместе с правилом «первого касания»
+// держит память шарда на том узле NUMA, где её читают
+class ShardWorker {
+public:
+	// cpus — процессоры, к которым привязывается поток; пустой набор — без привязки
+	explicit ShardWorker(const std::vector<int>& cpus);
+	ShardWorker(const ShardWorker&) = delete;
+	ShardWorker& operator=(const ShardWorker&) = delete;
+	~ShardWorker();
+
+	template <typename Function>
+	auto Submit(Function function) -> std::future<decltype(function())> {
+		auto task = std::make_shared<std::packaged_task<decltype(function())()>>(std::move(function));
+		auto result = task->get_future();
+		Post([task] {
+			(*task)();
+		});
+		return result;
+	}
+
+	// false, если привязка не запрошена или не поддерживается платформой
+	bool IsPinned() const;
+
+private:
+	std::mutex mutex_;
+	std::condition_variable task_available_;
+	std::deque<std::function<void()>> tasks_;
+	bool stopping_ = false;
+	bool pinned_ = false;
+	std::thread thread_;
+
+	void Post(std::function<void()> task);
+	void Run();
+};
+
+// Процессоры узла NUMA по данным ОС; пустой вектор, если узел неизвестен или платформа не поддерживается
+std::vector<int> GetNumaNodeCpus(int node);
+
+// Шард документа: id перемешиваются, чтобы соседние и кратные id расходились по разным шардам
+size_t GetDocumentShard(int document_id, size_t shard_count);
+void MergeTermStatistics(SearchServer::TermStatistics& total, const SearchServer::TermStatistics& shard);
+// k-путевое слияние отсортированных результатов шардов, не больше MAX_RESULT_DOCUMENT_COUNT
+std::vector<Document> MergeTopDocuments(const std::vector<std::vector<Document>>& shard_results);
+
+// Документы распределяются по независимым шардам по хешу id. Запрос выполняется
+// в два прохода: сначала собираются частоты слов со всех шардов, затем каждый шард
+// ранжирует свои документы с общим IDF, и лучшие результаты шардов сливаются.
+// Поэтому результаты совпадают с единым SearchServer над тем же корпусом.
+// Как и у SearchServer, изменения нельзя выполнять одновременно с запросами
+class ShardedSearchServer {
+public:
+	// shard_cpus[i] — процессоры потока шарда i (например, GetNumaNodeCpus(node));
+	// отсутствующий или пустой элемент — без привязки
+	template <typename StopWords>
+	ShardedSearchServer(const StopWords& stop_words, size_t shard_count, const std::vector<std::vector<int>>& shard_cpus = {}) {
+		if (shard_count == 0) {
+			using namespace std::string_literals;
+			throw std::invalid_argument("Shard count must be positive"s);
+		}
+		for (size_t i = 0; i < shard_count; ++i) {
+			workers_.push_back(std::make_unique<ShardWorker>(i < shard_cpus.size() ? shard_cpus[i] : std::vector<int>{}));
+			// шард создаётся своим потоком, чтобы его память выделялась на нужном узле
+			shards_.push_back(workers_.back()->Submit([&stop_words] {
+				return std::make_unique<SearchServer>(stop_words);
+			}).get());
+		}
+	}
+
+	ShardedSearchServer(const ShardedSearchServer&) = delete;
+	ShardedSearchServer& operator=(const ShardedSearchServer&) = delete;
+
+	void AddDocument(int document_id, const std::string_view& document, DocumentStatus status, const std::vector<int>& ratings);
+
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query) const;
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, DocumentStatus status) const;
+
+	template <typename Filter>
+	std::vector<Document> FindTopDocuments(const std::string_view& raw_query, Filter filter) const {
+		return FindTopDocuments(std::execution::seq, raw_query, filter);
+	}
+
+	template <typename Policy>
+	std::vector<Document> FindTopDocuments(const Policy& policy, const std::string_view& raw_query) const {
+		return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
+	}
+
+	template <typename Policy>
+	std::vector<Document> FindTopDocuments(const Policy& policy, const std::string_view& raw_query, DocumentStatus status) const {
+		return FindTopDocuments(
+			policy,
+			raw_query,
+			[status](int, DocumentStatus document_status, int) {
+				return document_status == status;
+			}
+		);
+	}
+
+	// seq — шарды опрашиваются по очереди в вызывающем потоке, par — одновременно потоками шардов
+	template <typename Policy, typename Filter>
+	std::vector<Document> FindTopDocuments(const Policy& policy, const std::string_view& raw_query, Filter filter) const {
+		constexpr bool is_parallel = std::is_same_v<std::decay_t<Policy>, std::execution::parallel_policy>;
+		SearchServer::TermStatistics statistics;
+		std::vector<std::vector<Document>> shard_results(shards_.size());
+
+		if constexpr (is_parallel) {
+			std::vector<std::future<SearchServer::TermStatistics>> shard_statistics;
+			for (size_t i = 0; i < shards_.size(); ++i) {
+				shard_statistics.push_back(workers_[i]->Submit([this, i, raw_query] {
+					SearchServer::TermStatistics local;
+					shards_[i]->CollectTermStatistics(raw_query, local);
+					return local;
+				}));
+			}
+			for (auto& local : WaitAll(shard_statistics)) {
+				MergeTermStatistics(statistics, local);
+			}
+
+			std::vector<std::future<void>> searches;
+			for (size_t i = 0; i < shards_.size(); ++i) {
+				searches.push_back(workers_[i]->Submit([this, i, raw_query, &filter, &statistics, &shard_results] {
+					shards_[i]->FillTopDocuments(std::execution::seq, raw_query, filter, &statistics, shard_results[i]);
+				}));
+			}
+			WaitAll(searches);
+		} else {
+			for (const auto& shard : shards_) {
+				shard->CollectTermStatistics(raw_query, statistics);
+			}
+			for (size_t i = 0; i < shards_.size(); ++i) {
+				shards_[i]->FillTopDocuments(policy, raw_query, filter, &statistics, shard_results[i]);
+			}
+		}
+
+		return MergeTopDocuments(shard_results);
+	}
+
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const std::string_view& raw_query, int document_id) const;
+
+	template <typename Policy>
+	std::tuple<std::vector<std::string_view>, DocumentStatus> MatchDocument(const Policy& policy, const std::string_view& raw_query, int document_id) const {
+		return shards_[GetShardIndex(document_id)]->MatchDocument(policy, raw_query, document_id);
+	}
+
+	void RemoveDocument(int document_id);
+
+	template <typename Policy>
+	void RemoveDocument(const Policy& policy, int document_id) {
+		shards_[GetShardIndex(document_id)]->RemoveDocument(policy, document_id);
+	}
+
+	// Кандидаты исправления ищутся по словарю каждого шарда отдельно
+	void SetFuzzyEditDistance(int max_distance);
+
+	int GetDocumentCount() const;
+	size_t GetShardCount() const;
+	size_t GetShardIndex(int document_id) const;
+	const SearchServer& GetShard(size_t index) const;
+	bool IsShardPinned(size_t index) const;
+
+private:
+	std::vector<std::unique_ptr<ShardWorker>> workers_;
+	std::vector<std::unique_ptr<SearchServer>> shards_;
+
+	// Дожидается всех задач, прежде чем пробросить исключение: задачи ссылаются на локальные данные вызывающего
+	template <typename T>
+	static std::vector<T> WaitAll(std::vector<std::future<T>>& futures) {
+		for (auto& future : futures) {
+			future.wait();
+		}
+		std::vector<T> results;
+		for (auto& future : futures) {
+			results.push_back(future.get());
+		}
+		return results;
+	}
+
+	static void WaitAll(std::vector<std::future<void>>& futures) {
+		for (auto& future : futures) {
+			future.wait();
+		}
+		for (auto& future : futures) {
+			future.get();
+		}
+	}
+};
\ No newline at end of file
@@ -0,0 +1,60 @@
+#include "stop_word_set.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+StopWordSet::StopWordSet(const set<string, less<>>& words) {
+	vector<Slot> word_slots;
+	for (const string& word : words) {
+		if (word.empty()) {
+			continue;
+		}
+		word_slots.push_back({ static_cast<uint32_t>(chars_.size()), static_cast<uint32_t>(word.size()) });
+		chars_ += word;
+		length_mask_ |= LengthBit(word.size());
+	}
+	size_ = word_slots.size();
+	if (chars_.size() > UINT32_MAX) {
+		throw invalid_argument("Stop-words are too long"s);
+	}
+
+	// таблица заполнена не больше чем наполовину; если затравки не находятся, она растёт
+	size_t table_size = 1;
+	while (table_size < 2 * size_) {
+		table_size *= 2;
+	}
+	constexpr uint64_t SEEDS_PER_TABLE_SIZE = 64;
+	for (uint64_t seed = 0;; ++seed) {
+		if (seed > 0 && seed % SEEDS_PER_TABLE_SIZE == 0) {
+			table_size *= 2;
+		}
+		slots_.assign(table_size, Slot{});
+		bool collision = false;
+		for (const Slot& word_slot : word_slots) {
+			Slot& slot = slots_[Hash(string_view(chars_).substr(word_slot.offset, word_slot.size), seed) & (table_size - 1)];
+			if (slot.size > 0) {
+				collision = true;
+				break;
+			}
+			slot = word_slot;
+		}
+		if (!collision) {
+			seed_ = seed;
+			mask_ = table_size - 1;
+			return;
+		}
+	}
+}
+
+size_t StopWordSet::GetSize() const {
+	return size_;
+}
+
+bool StopWordSet::IsEmpty() const {
+	return size_ == 0;
+}
+
+size_t StopWordSet::GetMemoryBytes() const {
+	return chars_.capacity() + slots_.capacity() * sizeof(Slot);
+}
\ No newline at end of file
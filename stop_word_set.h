@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Неизменяемое множество стоп-слов с идеальным хешированием: при построении подбирается
+// затравка хеша, при которой у слов нет коллизий, поэтому проверка слова — один хеш,
+// одно сравнение длины и memcmp. Слова чужой длины отсекаются по маске длин без хеша
+class StopWordSet {
+public:
+	StopWordSet() = default;
+	// Пустые слова пропускаются
+	explicit StopWordSet(const std::set<std::string, std::less<>>& words);
+
+	bool Contains(std::string_view word) const {
+		if ((length_mask_ & LengthBit(word.size())) == 0) {
+			return false;
+		}
+		const Slot& slot = slots_[Hash(word, seed_) & mask_];
+		return slot.size == word.size() && std::memcmp(chars_.data() + slot.offset, word.data(), word.size()) == 0;
+	}
+
+	size_t GetSize() const;
+	bool IsEmpty() const;
+	size_t GetMemoryBytes() const;
+
+private:
+	// слова лежат подряд в chars_; смещения, а не string_view, переживают перемещение объекта
+	struct Slot {
+		uint32_t offset = 0;
+		uint32_t size = 0;
+	};
+
+	std::string chars_;
+	std::vector<Slot> slots_;
+	uint64_t seed_ = 0;
+	size_t mask_ = 0;
+	size_t size_ = 0;
+	// бит i — есть слово длины i; все слова длиннее 63 делят последний бит
+	uint64_t length_mask_ = 0;
+
+	static uint64_t LengthBit(size_t length) {
+		return uint64_t{ 1 } << (length < 63 ? length : 63);
+	}
+
+	static uint64_t Hash(std::string_view word, uint64_t seed) {
+		// FNV-1a с затравкой и финальным перемешиванием
+		uint64_t hash = 14695981039346656037ull ^ seed;
+		for (const char c : word) {
+			hash = (hash ^ static_cast<unsigned char>(c)) * 1099511628211ull;
+		}
+		return hash ^ (hash >> 29);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,92 @@
+#include "string_pool.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+using namespace std;
+
+StringPool::StringPool(pmr::memory_resource* resource, size_t chunk_size)
+	: resource_(resource)
+	, chunk_size_(max<size_t>(chunk_size, 1))
+{}
+
+StringPool::StringPool(StringPool&& other) noexcept
+	: resource_(other.resource_)
+	, chunk_size_(other.chunk_size_)
+	, chunks_(move(other.chunks_))
+	, current_(exchange(other.current_, nullptr))
+	, remaining_(exchange(other.remaining_, 0))
+	, used_bytes_(exchange(other.used_bytes_, 0))
+	, allocated_bytes_(exchange(other.allocated_bytes_, 0))
+{
+	other.chunks_.clear();
+}
+
+StringPool& StringPool::operator=(StringPool&& other) noexcept {
+	if (this != &other) {
+		Release();
+		resource_ = other.resource_;
+		chunk_size_ = other.chunk_size_;
+		chunks_ = move(other.chunks_);
+		other.chunks_.clear();
+		current_ = exchange(other.current_, nullptr);
+		remaining_ = exchange(other.remaining_, 0);
+		used_bytes_ = exchange(other.used_bytes_, 0);
+		allocated_bytes_ = exchange(other.allocated_bytes_, 0);
+	}
+
+	return *this;
+}
+
+StringPool::~StringPool() {
+	Release();
+}
+
+string_view StringPool::Add(string_view text) {
+	if (text.empty()) {
+		return {};
+	}
+	if (text.size() > remaining_) {
+		// длинная строка получает отдельный блок, чтобы не бросать остаток текущего
+		const size_t size = max(chunk_size_, text.size());
+		char* data = static_cast<char*>(resource_->allocate(size, 1));
+		chunks_.push_back({ data, size });
+		allocated_bytes_ += size;
+		if (size - text.size() >= remaining_) {
+			current_ = data;
+			remaining_ = size;
+		} else {
+			memcpy(data, text.data(), text.size());
+			used_bytes_ += text.size();
+			return { data, text.size() };
+		}
+	}
+
+	char* result = current_;
+	memcpy(result, text.data(), text.size());
+	current_ += text.size();
+	remaining_ -= text.size();
+	used_bytes_ += text.size();
+
+	return { result, text.size() };
+}
+
+size_t StringPool::GetUsedBytes() const {
+	return used_bytes_;
+}
+
+size_t StringPool::GetAllocatedBytes() const {
+	return allocated_bytes_;
+}
+
+void StringPool::Release() {
+	for (const Chunk& chunk : chunks_) {
+		resource_->deallocate(chunk.data, chunk.size, 1);
+	}
+	chunks_.clear();
+	current_ = nullptr;
+	remaining_ = 0;
+	used_bytes_ = 0;
+	allocated_bytes_ = 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+// Пул строк с выделением «сдвигом указателя»: строки складываются подряд в
+// крупные блоки, взятые у memory_resource. Отдельных строк пул не освобождает,
+// string_view на добавленные строки действительны до уничтожения пула.
+class StringPool {
+public:
+	static constexpr size_t DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+	explicit StringPool(std::pmr::memory_resource* resource = std::pmr::get_default_resource(), size_t chunk_size = DEFAULT_CHUNK_SIZE);
+	StringPool(const StringPool&) = delete;
+	StringPool& operator=(const StringPool&) = delete;
+	StringPool(StringPool&& other) noexcept;
+	StringPool& operator=(StringPool&& other) noexcept;
+	~StringPool();
+
+	std::string_view Add(std::string_view text);
+
+	size_t GetUsedBytes() const;
+	size_t GetAllocatedBytes() const;
+
+private:
+	struct Chunk {
+		char* data;
+		size_t size;
+	};
+
+	std::pmr::memory_resource* resource_;
+	size_t chunk_size_;
+	std::vector<Chunk> chunks_;
+	char* current_ = nullptr;
+	size_t remaining_ = 0;
+	size_t used_bytes_ = 0;
+	size_t allocated_bytes_ = 0;
+
+	void Release();
+};
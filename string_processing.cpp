@@ -1,19 +1,49 @@
 #include "string_processing.h"
 
+#include <algorithm>
+#include <cstdlib>
+
 using namespace std;
 
-vector<string> SplitIntoWords(const string_view& text) {
-	vector<string> words;
-	string word;
-	for (const char c : text) {
-		if (c == ' ') {
-			words.push_back(word);
-			word = "";
-		} else {
-			word += c;
+vector<string_view> SplitIntoWords(const string_view& text) {
+	vector<string_view> words;
+	size_t word_begin = 0;
+	for (size_t i = 0; i < text.size(); ++i) {
+		if (text[i] == ' ') {
+			words.push_back(text.substr(word_begin, i - word_begin));
+			word_begin = i + 1;
 		}
 	}
-	words.push_back(word);
+	words.push_back(text.substr(word_begin));
 
 	return words;
+}
+
+int ComputeEditDistance(const string_view& lhs, const string_view& rhs, int max_distance) {
+	const int lhs_size = static_cast<int>(lhs.size());
+	const int rhs_size = static_cast<int>(rhs.size());
+	if (abs(lhs_size - rhs_size) > max_distance) {
+		return max_distance + 1;
+	}
+
+	vector<int> previous(rhs_size + 1);
+	vector<int> current(rhs_size + 1);
+	for (int j = 0; j <= rhs_size; ++j) {
+		previous[j] = j;
+	}
+	for (int i = 1; i <= lhs_size; ++i) {
+		current[0] = i;
+		int row_min = current[0];
+		for (int j = 1; j <= rhs_size; ++j) {
+			const int substitution = previous[j - 1] + (lhs[i - 1] == rhs[j - 1] ? 0 : 1);
+			current[j] = min({ previous[j] + 1, current[j - 1] + 1, substitution });
+			row_min = min(row_min, current[j]);
+		}
+		if (row_min > max_distance) {
+			return max_distance + 1;
+		}
+		swap(previous, current);
+	}
+
+	return min(previous[rhs_size], max_distance + 1);
 }
\ No newline at end of file
@@ -5,15 +5,18 @@
 #include <string>
 #include <string_view>
 
-std::vector<std::string> SplitIntoWords(const std::string_view& text);
+// Слова — представления внутри text, он должен пережить результат
+std::vector<std::string_view> SplitIntoWords(const std::string_view& text);
+
+int ComputeEditDistance(const std::string_view& lhs, const std::string_view& rhs, int max_distance);
 
 template <typename StringContainer>
 std::set<std::string, std::less<>> MakeUniqueNonEmptyStrings(const StringContainer& strings) {
 	std::set<std::string, std::less<>> non_empty_strings;
 
-	for (const std::string& str : strings) {
+	for (const auto& str : strings) {
 		if (!str.empty()) {
-			non_empty_strings.insert(str);
+			non_empty_strings.insert(static_cast<std::string>(str));
 		}
 	}
 
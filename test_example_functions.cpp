@@ -1,8 +1,31 @@
 #include "test_example_functions.h"
 #include "log_duration.h"
 #include "process_queries.h"
-
+#include "request_queue.h"
+#include "query_profiler.h"
+#include "corpus_generator.h"
+#include "string_pool.h"
+#include "corpus_loader.h"
+#include "query_replay.h"
+#include "sharded_search_server.h"
+#include "shard_server.h"
+#include "query_session.h"
+#include "search_cursor.h"
+#include "stop_word_set.h"
+#include "async_query.h"
+#include "admission_controller.h"
+#include "durable_search_server.h"
+
+#include <atomic>
 #include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory_resource>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
 
 using namespace std;
 
@@ -193,6 +216,167 @@ void TestMinusWords() {
 	}
 }
 
+void TestDocumentIdBitmap() {
+	DocumentIdBitmap bitmap;
+	ASSERT(bitmap.IsEmpty());
+	for (const int id : { 0, 63, 64, 100, 1000 }) {
+		bitmap.Set(id);
+	}
+	ASSERT(bitmap.Test(63) && bitmap.Test(64) && bitmap.Test(1000));
+	ASSERT(!bitmap.Test(1) && !bitmap.Test(999) && !bitmap.Test(100'000));
+	ASSERT_EQUAL(bitmap.Count(), 5u);
+	bitmap.Reset(0);
+	bitmap.Reset(5000);
+
+	vector<int> ids;
+	bitmap.ForEach([&ids](int id) { ids.push_back(id); });
+	ASSERT_EQUAL(ids, vector<int>({ 63, 64, 100, 1000 }));
+
+	DocumentIdBitmap other;
+	other.Set(64);
+	other.Set(2000);
+	DocumentIdBitmap intersection = bitmap;
+	intersection &= other;
+	ASSERT_EQUAL(intersection.Count(), 1u);
+	ASSERT(intersection.Test(64));
+	bitmap |= other;
+	ASSERT_EQUAL(bitmap.Count(), 5u);
+	ASSERT(bitmap.Test(2000));
+	bitmap.Clear();
+	ASSERT(bitmap.IsEmpty());
+
+	// память зависит от числа id, а не от наибольшего id
+	DocumentIdBitmap sparse;
+	sparse.Set(2'000'000'000);
+	sparse.Set(7);
+	ASSERT(sparse.GetMemoryBytes() < 1024u);
+	ASSERT(sparse.Test(2'000'000'000) && sparse.Test(7) && !sparse.Test(2'000'000'001));
+	ASSERT_EQUAL(sparse.Count(), 2u);
+	ASSERT(!sparse.Test(-1));
+
+	// плотные блоки переходят из массива в bitmap и обратно; результат сверяется с set
+	mt19937 generator(5);
+	const auto make_random = [&generator](int count, int range, set<int>& reference) {
+		DocumentIdBitmap result;
+		uniform_int_distribution<int> id_distribution(0, range - 1);
+		for (int i = 0; i < count; ++i) {
+			const int id = id_distribution(generator);
+			result.Set(id);
+			reference.insert(id);
+		}
+		return result;
+	};
+	const auto to_set = [](const DocumentIdBitmap& value) {
+		set<int> result;
+		value.ForEach([&result](int id) { result.insert(id); });
+		return result;
+	};
+	for (const auto& [lhs_count, rhs_count] : vector<pair<int, int>>{ { 20'000, 20'000 }, { 20'000, 300 }, { 300, 20'000 }, { 300, 300 } }) {
+		set<int> lhs_ids;
+		set<int> rhs_ids;
+		const DocumentIdBitmap lhs = make_random(lhs_count, 1 << 18, lhs_ids);
+		const DocumentIdBitmap rhs = make_random(rhs_count, 1 << 18, rhs_ids);
+		ASSERT(to_set(lhs) == lhs_ids);
+		ASSERT_EQUAL(lhs.Count(), lhs_ids.size());
+
+		set<int> expected;
+		set_intersection(lhs_ids.begin(), lhs_ids.end(), rhs_ids.begin(), rhs_ids.end(), inserter(expected, expected.end()));
+		DocumentIdBitmap result = lhs;
+		result &= rhs;
+		ASSERT(to_set(result) == expected);
+		ASSERT_EQUAL(lhs.CountIntersection(rhs), expected.size());
+
+		expected.clear();
+		set_union(lhs_ids.begin(), lhs_ids.end(), rhs_ids.begin(), rhs_ids.end(), inserter(expected, expected.end()));
+		result = lhs;
+		result |= rhs;
+		ASSERT(to_set(result) == expected);
+		ASSERT_EQUAL(result.Count(), expected.size());
+
+		expected.clear();
+		set_difference(lhs_ids.begin(), lhs_ids.end(), rhs_ids.begin(), rhs_ids.end(), inserter(expected, expected.end()));
+		result = lhs;
+		result -= rhs;
+		ASSERT(to_set(result) == expected);
+		ASSERT_EQUAL(result.Count(), expected.size());
+	}
+
+	set<int> dense_ids;
+	DocumentIdBitmap dense = make_random(30'000, 1 << 16, dense_ids);
+	for (const int id : dense_ids) {
+		dense.Reset(id);
+	}
+	ASSERT(dense.IsEmpty());
+}
+
+// Добавляет во все индексы очередные документы генератора, но не больше max_count
+template <typename... Indexes>
+void AddGeneratedDocuments(CorpusGenerator& generator, size_t max_count, Indexes&... indexes) {
+	GeneratedDocument document;
+	for (size_t i = 0; i < max_count && generator.Next(document); ++i) {
+		(indexes.AddDocument(document.id, document.text, document.status, document.ratings), ...);
+	}
+}
+
+// Индекс из всех оставшихся документов генератора
+SearchServer MakeGeneratedServer(CorpusGenerator& generator, const string& stop_words = ""s) {
+	SearchServer server(stop_words);
+	AddGeneratedDocuments(generator, SIZE_MAX, server);
+	return server;
+}
+
+void TestMinusWordsExcludeBeforeScoring() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 500;
+	corpus_options.vocabulary_size = 100;
+	CorpusGenerator generator(corpus_options);
+	SearchServer server = MakeGeneratedServer(generator);
+
+	QueryLogOptions query_options;
+	query_options.query_count = 100;
+	query_options.minus_word_probability = 0.5;
+	for (const string& query : GenerateQueryLog(generator.GetVocabulary(), query_options)) {
+		string plus_query;
+		set<string_view> minus_words;
+		for (const string_view word : SplitIntoWords(query)) {
+			if (word[0] == '-') {
+				minus_words.insert(word.substr(1));
+			} else {
+				plus_query += (plus_query.empty() ? ""s : " "s) + string(word);
+			}
+		}
+		if (plus_query.empty()) {
+			continue;
+		}
+
+		// минус-слова не влияют на IDF, поэтому их можно заменить фильтром
+		const auto without_minus_words = [&server, &minus_words](int document_id, DocumentStatus status, int) {
+			for (const auto& [word, _] : server.GetWordToFrequencies(document_id)) {
+				if (minus_words.count(word) > 0) {
+					return false;
+				}
+			}
+			return status == DocumentStatus::ACTUAL;
+		};
+		const auto expected = server.FindTopDocuments(plus_query, without_minus_words);
+		for (const auto& found : { server.FindTopDocuments(query), server.FindTopDocuments(execution::par, query) }) {
+			ASSERT_EQUAL(found.size(), expected.size());
+			for (size_t i = 0; i < found.size(); ++i) {
+				ASSERT(NearlyEquals(found[i].relevance, expected[i].relevance));
+				ASSERT(without_minus_words(found[i].id, DocumentStatus::ACTUAL, 0));
+			}
+		}
+	}
+
+	// большие id не раздувают множество исключённых документов
+	SearchServer sparse_server;
+	sparse_server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, { 1 });
+	sparse_server.AddDocument(2'000'000'000, "cat dog"s, DocumentStatus::ACTUAL, { 1 });
+	const auto sparse_found = sparse_server.FindTopDocuments("cat -dog"s);
+	ASSERT_EQUAL(sparse_found.size(), 1u);
+	ASSERT_EQUAL(sparse_found[0].id, 1);
+}
+
 void TestComputeAverageRating() {
 	SearchServer server;
 	server.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
@@ -383,6 +567,1351 @@ void TestDocumentRelevanceCalculation() {
 	}
 }
 
+void TestStatisticsEpochs() {
+	SearchServer server;
+	server.SetStatisticsEpochOptions({ 3, chrono::milliseconds(0) });
+	const uint64_t first_epoch = server.GetStatisticsEpoch();
+	server.AddDocument(0, "cat dog"s, DocumentStatus::ACTUAL, { 1 });
+	server.AddDocument(1, "dog bird"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT_EQUAL(server.GetStatisticsEpoch(), first_epoch);
+	server.AddDocument(2, "bird fish"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT_EQUAL(server.GetStatisticsEpoch(), first_epoch + 1);
+
+	// до конца эпохи IDF считается по трём опубликованным документам
+	server.AddDocument(3, "cat fish"s, DocumentStatus::ACTUAL, { 1 });
+	auto docs = server.FindTopDocuments("cat"s);
+	ASSERT_EQUAL(docs.size(), 2u);
+	ASSERT(NearlyEquals(docs[0].relevance, 0.5 * log(3.0)));
+	SearchServer::TermStatistics statistics;
+	server.CollectTermStatistics("cat"s, statistics);
+	ASSERT_EQUAL(statistics.document_count, 3);
+	ASSERT_EQUAL(statistics.document_freqs.at("cat"s), 1);
+
+	// слово новее эпохи получает IDF живого индекса
+	server.AddDocument(4, "lion"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT(NearlyEquals(server.FindTopDocuments("lion"s)[0].relevance, log(5.0)));
+	ASSERT_EQUAL(server.GetStatisticsEpoch(), first_epoch + 1);
+
+	server.AddDocument(5, "cat"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT_EQUAL(server.GetStatisticsEpoch(), first_epoch + 2);
+	docs = server.FindTopDocuments("cat"s);
+	ASSERT_EQUAL(docs[0].id, 5);
+	ASSERT(NearlyEquals(docs[0].relevance, log(2.0)));
+
+	server.RemoveDocument(5);
+	server.RemoveDocument(4);
+	ASSERT(NearlyEquals(server.FindTopDocuments("cat"s)[0].relevance, 0.5 * log(2.0)));
+	server.PublishStatistics();
+	ASSERT_EQUAL(server.GetStatisticsEpoch(), first_epoch + 3);
+	statistics = {};
+	server.CollectTermStatistics("cat lion"s, statistics);
+	ASSERT_EQUAL(statistics.document_count, 4);
+	ASSERT_EQUAL(statistics.document_freqs.at("cat"s), 2);
+	ASSERT_EQUAL(statistics.document_freqs.at("lion"s), 0);
+
+	server.SetStatisticsEpochOptions({ 0, chrono::milliseconds(1) });
+	server.AddDocument(6, "cat"s, DocumentStatus::ACTUAL, { 1 });
+	const uint64_t time_epoch = server.GetStatisticsEpoch();
+	this_thread::sleep_for(chrono::milliseconds(5));
+	server.AddDocument(7, "dog"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT_EQUAL(server.GetStatisticsEpoch(), time_epoch + 1);
+
+	// без эпох результат совпадает с сервером, построенным с нуля
+	server.SetStatisticsEpochOptions({});
+	SearchServer reference;
+	for (const int id : server) {
+		string text;
+		for (const auto& [word, _] : server.GetWordToFrequencies(id)) {
+			text += (text.empty() ? ""s : " "s) + string(word);
+		}
+		reference.AddDocument(id, text, DocumentStatus::ACTUAL, { 1 });
+	}
+	const auto expected = reference.FindTopDocuments("cat dog"s);
+	docs = server.FindTopDocuments("cat dog"s);
+	ASSERT_EQUAL(docs.size(), expected.size());
+	for (size_t i = 0; i < docs.size(); ++i) {
+		ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+	}
+}
+
+void TestImpactOrderedPostings() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 1000;
+	corpus_options.vocabulary_size = 300;
+	CorpusGenerator generator(corpus_options);
+	SearchServer exhaustive("and in on"s);
+	SearchServer impact("and in on"s);
+	impact.SetImpactOrderedPostings(true);
+	AddGeneratedDocuments(generator, 700, exhaustive, impact);
+
+	QueryLogOptions query_options;
+	query_options.query_count = 200;
+	query_options.max_query_words = 4;
+	query_options.minus_word_probability = 0.2;
+	const vector<string> queries = GenerateQueryLog(generator.GetVocabulary(), query_options);
+	const auto even = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+	const auto assert_same_results = [&] {
+		for (const string& query : queries) {
+			const auto check = [](const vector<Document>& docs, const vector<Document>& expected) {
+				ASSERT_EQUAL(docs.size(), expected.size());
+				for (size_t i = 0; i < docs.size(); ++i) {
+					ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+					ASSERT_EQUAL(docs[i].rating, expected[i].rating);
+				}
+			};
+			check(impact.FindTopDocuments(query), exhaustive.FindTopDocuments(query));
+			check(impact.FindTopDocuments(query, DocumentStatus::BANNED), exhaustive.FindTopDocuments(query, DocumentStatus::BANNED));
+			check(impact.FindTopDocuments(execution::par, query, even), exhaustive.FindTopDocuments(query, even));
+		}
+	};
+	assert_same_results();
+
+	// списки по вкладу обновляются вместе с основным индексом, в том числе при повторном
+	// добавлении удалённого id с другим текстом
+	const vector<string>& vocabulary = generator.GetVocabulary();
+	for (int id = 0; id < 700; id += 3) {
+		exhaustive.RemoveDocument(id);
+		impact.RemoveDocument(id);
+	}
+	for (int id = 0; id < 700; id += 6) {
+		const string text = vocabulary[id % 7] + " "s + vocabulary[id % 11] + " "s + vocabulary[id % 13];
+		exhaustive.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 5 });
+		impact.AddDocument(id, text, DocumentStatus::ACTUAL, { id % 5 });
+	}
+	AddGeneratedDocuments(generator, SIZE_MAX, exhaustive, impact);
+	// множество просмотренных документов не зависит от наибольшего id
+	exhaustive.AddDocument(2'000'000'000, vocabulary[0] + " "s + vocabulary[1], DocumentStatus::ACTUAL, { 9 });
+	impact.AddDocument(2'000'000'000, vocabulary[0] + " "s + vocabulary[1], DocumentStatus::ACTUAL, { 9 });
+	assert_same_results();
+
+	impact.SetImpactOrderedPostings(false);
+	ASSERT(!impact.HasImpactOrderedPostings());
+	impact.SetImpactOrderedPostings(true);
+	impact.SetStatisticsEpochOptions({ 50, chrono::milliseconds(0) });
+	exhaustive.SetStatisticsEpochOptions({ 50, chrono::milliseconds(0) });
+	assert_same_results();
+}
+
+void TestQuerySession() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 500;
+	corpus_options.vocabulary_size = 200;
+	CorpusGenerator generator(corpus_options);
+	SearchServer server = MakeGeneratedServer(generator, "and in on"s);
+
+	const auto check = [](const vector<Document>& docs, const vector<Document>& expected) {
+		ASSERT_EQUAL(docs.size(), expected.size());
+		for (size_t i = 0; i < docs.size(); ++i) {
+			ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+			ASSERT_EQUAL(docs[i].rating, expected[i].rating);
+		}
+	};
+	// запрос, который сессия видит в набранном тексте
+	const auto complete_query = [](const string& typed) {
+		vector<string_view> words;
+		for (const string_view word : SplitIntoWords(typed)) {
+			if (!word.empty()) {
+				words.push_back(word);
+			}
+		}
+		if (!words.empty() && typed.back() != ' ' && words.back() == "-"sv) {
+			words.pop_back();
+		}
+		string query;
+		for (const string_view word : words) {
+			query += (query.empty() ? ""s : " "s) + string(word);
+		}
+		return query;
+	};
+
+	QueryLogOptions query_options;
+	query_options.query_count = 30;
+	query_options.minus_word_probability = 0.3;
+	vector<string> queries = GenerateQueryLog(generator.GetVocabulary(), query_options);
+	queries.push_back("and "s + queries[0] + " "s + queries[0]);
+	for (const DocumentStatus status : { DocumentStatus::ACTUAL, DocumentStatus::BANNED }) {
+		QuerySession session(server, status);
+		for (const string& query : queries) {
+			session.Reset();
+			for (size_t length = 1; length <= query.size(); ++length) {
+				const string typed = query.substr(0, length);
+				const string expected_query = complete_query(typed);
+				const vector<Document> expected = expected_query.empty() ? vector<Document>() : server.FindTopDocuments(expected_query, status);
+				check(session.Update(typed), expected);
+			}
+			ASSERT_EQUAL(session.GetCommittedWordCount(), SplitIntoWords(query).size() - 1);
+		}
+	}
+
+	QuerySession session(server);
+	const string first = generator.GetVocabulary()[0];
+	const string second = generator.GetVocabulary()[1];
+	session.Update(first + " "s + second + " "s);
+	ASSERT_EQUAL(session.GetCommittedWordCount(), 2u);
+	// правка завершённого слова сбрасывает накопленное
+	check(session.Update(second + " "s + second), server.FindTopDocuments(second));
+	ASSERT_EQUAL(session.GetCommittedWordCount(), 1u);
+
+	try {
+		session.Update(first + " --"s + second);
+		ASSERT_HINT(false, "Invalid query must be reported"s);
+	} catch (const invalid_argument&) {
+	}
+	check(session.Update(first), server.FindTopDocuments(first));
+
+	// изменение индекса сбрасывает накопленное, и сессия пересчитывает вклады
+	session.Update(first + " "s);
+	server.AddDocument(100'000, first + " "s + first, DocumentStatus::ACTUAL, { 100 });
+	check(session.Update(first + " "s + second), server.FindTopDocuments(first + " "s + second));
+	ASSERT_EQUAL(session.Update(first).front().id, 100'000);
+
+	server.SetFuzzyEditDistance(1);
+	const string typo = first.substr(0, first.size() - 1) + "q"s;
+	check(session.Update(typo + " "s + second), server.FindTopDocuments(typo + " "s + second));
+
+	// документы меняются внутри одной эпохи статистики: номер эпохи тот же, но накопленное устарело
+	SearchServer epoch_server;
+	epoch_server.SetStatisticsEpochOptions({ 100, chrono::milliseconds(0) });
+	epoch_server.AddDocument(1, "cat"s, DocumentStatus::ACTUAL, { 1 });
+	epoch_server.AddDocument(2, "cat dog"s, DocumentStatus::ACTUAL, { 2 });
+	QuerySession epoch_session(epoch_server);
+	check(epoch_session.Update("cat "s), epoch_server.FindTopDocuments("cat"s));
+	const uint64_t epoch = epoch_server.GetStatisticsEpoch();
+	epoch_server.RemoveDocument(1);
+	epoch_server.AddDocument(3, "cat bird"s, DocumentStatus::ACTUAL, { 3 });
+	ASSERT_EQUAL(epoch_server.GetStatisticsEpoch(), epoch);
+	const auto expected = epoch_server.FindTopDocuments("cat d"s);
+	const auto& found = epoch_session.Update("cat d"s);
+	check(found, expected);
+	vector<int> found_ids;
+	for (const Document& document : found) {
+		found_ids.push_back(document.id);
+	}
+	sort(found_ids.begin(), found_ids.end());
+	ASSERT_EQUAL(found_ids, vector<int>({ 2, 3 }));
+
+	// слова с префиксом последнего слова сужаются при дописывании и собираются заново при стирании
+	SearchServer prefix_server;
+	prefix_server.AddDocument(1, "ca cat"s, DocumentStatus::ACTUAL, { 1 });
+	prefix_server.AddDocument(2, "cat catalog"s, DocumentStatus::ACTUAL, { 2 });
+	prefix_server.AddDocument(3, "catalog dog"s, DocumentStatus::ACTUAL, { 3 });
+	prefix_server.AddDocument(4, "dog"s, DocumentStatus::ACTUAL, { 4 });
+	QuerySession prefix_session(prefix_server);
+	for (const string& typed : { "d"s, "dog c"s, "dog ca"s, "dog cat"s, "dog cata"s, "dog catalog"s, "dog ca"s, "dog -cat"s, "dog cat catalog"s, "catalog"s }) {
+		check(prefix_session.Update(typed), prefix_server.FindTopDocuments(typed));
+	}
+}
+
+void TestSearchCursor() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 2000;
+	corpus_options.vocabulary_size = 100;
+	CorpusGenerator generator(corpus_options);
+	SearchServer server = MakeGeneratedServer(generator);
+	const vector<string>& vocabulary = generator.GetVocabulary();
+	const string query = vocabulary[0] + " "s + vocabulary[3] + " -"s + vocabulary[5];
+
+	// все подходящие документы, найденные напрямую по словам документов
+	set<int> expected_ids;
+	for (const int id : server) {
+		const auto [words, status] = server.MatchDocument(query, id);
+		if (!words.empty() && status == DocumentStatus::ACTUAL) {
+			expected_ids.insert(id);
+		}
+	}
+	ASSERT(expected_ids.size() > 300);
+
+	vector<Document> all;
+	server.FindDocumentsAfter(query, [](int, DocumentStatus status, int) { return status == DocumentStatus::ACTUAL; }, nullopt, 100'000, all);
+	ASSERT_EQUAL(all.size(), expected_ids.size());
+	for (size_t i = 0; i < all.size(); ++i) {
+		ASSERT(expected_ids.count(all[i].id) > 0);
+		ASSERT(i == 0 || SearchServer::IsRankedBefore({ all[i - 1].relevance, all[i - 1].rating, all[i - 1].id }, { all[i].relevance, all[i].rating, all[i].id }));
+	}
+	const auto top = server.FindTopDocuments(query);
+	for (size_t i = 0; i < top.size(); ++i) {
+		ASSERT(NearlyEquals(top[i].relevance, all[i].relevance));
+	}
+
+	const size_t page_size = 7;
+	const auto assert_page = [&all, page_size](const vector<Document>& page, size_t page_index) {
+		const size_t first = min(all.size(), page_index * page_size);
+		const size_t last = min(all.size(), first + page_size);
+		ASSERT_EQUAL(page.size(), last - first);
+		for (size_t i = 0; i < page.size(); ++i) {
+			ASSERT_EQUAL(page[i].id, all[first + i].id);
+		}
+	};
+
+	SearchCursor cursor(server, query, DocumentStatus::ACTUAL, page_size);
+	size_t page_index = 0;
+	for (const vector<Document>* page = &cursor.NextPage(); !page->empty(); page = &cursor.NextPage()) {
+		assert_page(*page, page_index++);
+	}
+	ASSERT_EQUAL(page_index, (all.size() + page_size - 1) / page_size);
+	assert_page(cursor.GetPage(3), 3);
+
+	// переход сразу к далёкой странице и продолжение с позиции, отданной клиенту
+	SearchCursor deep_cursor(server, query, DocumentStatus::ACTUAL, page_size);
+	assert_page(deep_cursor.GetPage(40), 40);
+	assert_page(deep_cursor.NextPage(), 41);
+	vector<Document> continued;
+	server.FindDocumentsAfter(query, [](int, DocumentStatus status, int) { return status == DocumentStatus::ACTUAL; }, deep_cursor.GetPosition(), page_size, continued);
+	assert_page(continued, 42);
+	ASSERT(deep_cursor.GetPage(100'000).empty());
+
+	SearchCursor banned_cursor(server, query, [](int id, DocumentStatus status, int) { return status == DocumentStatus::BANNED && id % 2 == 0; }, 3);
+	for (const Document& found : banned_cursor.GetPage(2)) {
+		ASSERT_EQUAL(found.id % 2, 0);
+		ASSERT(get<1>(server.MatchDocument(query, found.id)) == DocumentStatus::BANNED);
+	}
+
+	// новый документ во главе выдачи сдвигает конец первой страницы: концы следующих страниц
+	// забываются, и дальние страницы считаются от нового конца
+	SearchCursor shifted_cursor(server, query, DocumentStatus::ACTUAL, page_size);
+	for (size_t i = 0; i < 5; ++i) {
+		shifted_cursor.NextPage();
+	}
+	server.AddDocument(1'000'000, vocabulary[0] + " "s + vocabulary[3], DocumentStatus::ACTUAL, { 1'000 });
+	all.clear();
+	server.FindDocumentsAfter(query, [](int, DocumentStatus status, int) { return status == DocumentStatus::ACTUAL; }, nullopt, 100'000, all);
+	ASSERT_EQUAL(all.front().id, 1'000'000);
+	assert_page(shifted_cursor.GetPage(0), 0);
+	assert_page(shifted_cursor.GetPage(3), 3);
+	assert_page(shifted_cursor.NextPage(), 4);
+
+	try {
+		SearchCursor invalid(server, query, DocumentStatus::ACTUAL, 0);
+		ASSERT_HINT(false, "Zero page size must be rejected"s);
+	} catch (const invalid_argument&) {
+	}
+}
+
+void TestAggregateDocuments() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 1500;
+	corpus_options.vocabulary_size = 200;
+	CorpusGenerator generator(corpus_options);
+	SearchServer server("and in on"s);
+	map<int, int> ratings;
+	GeneratedDocument document;
+	while (generator.Next(document)) {
+		server.AddDocument(document.id, document.text, document.status, document.ratings);
+		int rating_sum = 0;
+		for (const int rating : document.ratings) {
+			rating_sum += rating;
+		}
+		ratings[document.id] = rating_sum / static_cast<int>(document.ratings.size());
+	}
+
+	QueryLogOptions query_options;
+	query_options.query_count = 40;
+	query_options.minus_word_probability = 0.4;
+	const vector<string> queries = GenerateQueryLog(generator.GetVocabulary(), query_options);
+	const auto assert_aggregation = [&](DocumentStatus aggregation_status) {
+		const int width = server.GetRatingBucketWidth();
+		for (const string& query : queries) {
+			SearchServer::QueryAggregation expected;
+			for (const int id : server) {
+				const auto [words, status] = server.MatchDocument(query, id);
+				if (words.empty()) {
+					continue;
+				}
+				++expected.status_counts[static_cast<int>(status)];
+				if (status == aggregation_status) {
+					const int rating = ratings.at(id);
+					++expected.rating_histogram[(rating >= 0 ? rating / width : -((-rating + width - 1) / width)) * width];
+				}
+			}
+			const SearchServer::QueryAggregation aggregation = server.AggregateDocuments(query, aggregation_status);
+			ASSERT(aggregation.status_counts == expected.status_counts);
+			ASSERT_EQUAL(aggregation.rating_histogram, expected.rating_histogram);
+		}
+	};
+	assert_aggregation(DocumentStatus::ACTUAL);
+	assert_aggregation(DocumentStatus::BANNED);
+
+	for (int id = 0; id < 1500; id += 2) {
+		server.RemoveDocument(id);
+	}
+	server.SetRatingBucketWidth(3);
+	assert_aggregation(DocumentStatus::ACTUAL);
+
+	const string word = generator.GetVocabulary()[0];
+	const auto aggregation = server.AggregateDocuments(word + " -"s + word);
+	ASSERT(aggregation.status_counts == (array<int, 4>{}));
+	ASSERT(aggregation.rating_histogram.empty());
+
+	try {
+		server.SetRatingBucketWidth(0);
+		ASSERT_HINT(false, "Zero bucket width must be rejected"s);
+	} catch (const invalid_argument&) {
+	}
+
+	// фасеты занимают память по числу документов и непустых корзин, а не по наибольшему id
+	SearchServer facet_server;
+	const size_t empty_caches = facet_server.GetMemoryStats().caches;
+	for (int i = 0; i < 50; ++i) {
+		facet_server.AddDocument(2'000'000'000 - i, "cat"s, DocumentStatus::ACTUAL, { i * 10 });
+	}
+	ASSERT(facet_server.GetMemoryStats().caches < empty_caches + 64 * 1024);
+	ASSERT_EQUAL(facet_server.AggregateDocuments("cat"s).status_counts[0], 50);
+	for (int i = 0; i < 50; ++i) {
+		facet_server.RemoveDocument(2'000'000'000 - i);
+	}
+	ASSERT(facet_server.GetMemoryStats().caches < empty_caches + 1024);
+}
+
+void TestRequiredWords() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 1500;
+	corpus_options.vocabulary_size = 200;
+	CorpusGenerator generator(corpus_options);
+	SearchServer server = MakeGeneratedServer(generator, "and in on"s);
+
+	const auto check = [](const vector<Document>& docs, const vector<Document>& expected) {
+		ASSERT_EQUAL(docs.size(), expected.size());
+		for (size_t i = 0; i < docs.size(); ++i) {
+			ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+			ASSERT_EQUAL(docs[i].rating, expected[i].rating);
+		}
+	};
+
+	const set<string_view> stop_words = { "and"sv, "in"sv, "on"sv };
+	QueryLogOptions query_options;
+	query_options.query_count = 40;
+	query_options.minus_word_probability = 0.3;
+	for (const string& plain_query : GenerateQueryLog(generator.GetVocabulary(), query_options)) {
+		// первое плюс-слово обязательное; запрос со всеми обязательными равен режиму ALL
+		string first_required_query;
+		string all_required_query;
+		set<string> first_required;
+		set<string> all_required;
+		for (const string_view word : SplitIntoWords(plain_query)) {
+			const string separator = first_required_query.empty() ? ""s : " "s;
+			const bool is_plus = word[0] != '-' && stop_words.count(word) == 0;
+			if (is_plus && first_required.empty()) {
+				first_required.insert(string(word));
+				first_required_query += separator + "+"s + string(word);
+			} else {
+				first_required_query += separator + string(word);
+			}
+			if (is_plus) {
+				all_required.insert(string(word));
+				all_required_query += separator + "+"s + string(word);
+			} else {
+				all_required_query += separator + string(word);
+			}
+		}
+
+		for (const auto& [query, required] : { pair{ first_required_query, first_required }, pair{ all_required_query, all_required } }) {
+			// эталон — документы, в которых MatchDocument обычного запроса нашёл все обязательные слова
+			set<int> matched;
+			for (const int id : server) {
+				const auto [words, status] = server.MatchDocument(plain_query, id);
+				const set<string> found(words.begin(), words.end());
+				const bool has_required = includes(found.begin(), found.end(), required.begin(), required.end());
+				if (!words.empty() && has_required) {
+					matched.insert(id);
+				}
+				ASSERT_EQUAL(get<0>(server.MatchDocument(query, id)).empty(), words.empty() || !has_required);
+			}
+			const auto expected = server.FindTopDocuments(execution::seq, plain_query,
+				[&matched](int document_id, DocumentStatus status, int) {
+					return status == DocumentStatus::ACTUAL && matched.count(document_id) > 0;
+				}
+			);
+			check(server.FindTopDocuments(query), expected);
+			check(server.FindTopDocuments(execution::par, query), expected);
+			if (required == all_required) {
+				check(server.FindTopDocuments(plain_query, QueryMode::ALL), expected);
+			}
+
+			vector<Document> page;
+			server.FindDocumentsAfter(query, [](int, DocumentStatus status, int) {
+					return status == DocumentStatus::ACTUAL;
+				}, nullopt, MAX_RESULT_DOCUMENT_COUNT, page);
+			check(page, expected);
+
+			QuerySession session(server);
+			check(session.Update(query), expected);
+
+			const auto aggregation = server.AggregateDocuments(query);
+			int actual_count = 0;
+			for (const int id : matched) {
+				actual_count += get<1>(server.MatchDocument(plain_query, id)) == DocumentStatus::ACTUAL ? 1 : 0;
+			}
+			ASSERT_EQUAL(aggregation.status_counts[static_cast<int>(DocumentStatus::ACTUAL)], actual_count);
+		}
+	}
+
+	const string first = generator.GetVocabulary()[0];
+	const string second = generator.GetVocabulary()[1];
+	// слово без документов делает выдачу пустой только будучи обязательным
+	ASSERT(!server.FindTopDocuments(first + " unknownword"s).empty());
+	ASSERT(server.FindTopDocuments(first + " +unknownword"s).empty());
+	ASSERT(server.FindTopDocuments(first + " unknownword"s, QueryMode::ALL).empty());
+	ASSERT(server.FindTopDocuments("+"s + first + " -"s + first).empty());
+	check(server.FindTopDocuments(first + " "s + second, QueryMode::ALL), server.FindTopDocuments("+"s + first + " +"s + second));
+
+	// обязательное слово с опечаткой заменяется одним ближайшим словом словаря
+	server.SetFuzzyEditDistance(1);
+	const string typo = first.substr(0, first.size() - 1) + "q"s;
+	for (const Document& found : server.FindTopDocuments("+"s + typo)) {
+		ASSERT(!get<0>(server.MatchDocument("+"s + typo, found.id)).empty());
+	}
+	QuerySession session(server, DocumentStatus::ACTUAL, QueryMode::ALL);
+	check(session.Update(typo + " "s + second), server.FindTopDocuments(typo + " "s + second, QueryMode::ALL));
+	check(session.Update(typo + " "s + second + " +"s), server.FindTopDocuments(typo + " "s + second, QueryMode::ALL));
+
+	for (const string& query : { "+"s, "++"s + first, "+-"s + first, "-+"s + first }) {
+		try {
+			server.FindTopDocuments(query);
+			ASSERT_HINT(false, "Invalid required word must be rejected"s);
+		} catch (const invalid_argument&) {
+		}
+	}
+}
+
+void TestStopWordSet() {
+	{
+		const StopWordSet empty;
+		ASSERT(empty.IsEmpty());
+		ASSERT(!empty.Contains(""sv));
+		ASSERT(!empty.Contains("in"sv));
+	}
+
+	CorpusOptions corpus_options;
+	corpus_options.vocabulary_size = 3000;
+	CorpusGenerator generator(corpus_options);
+	const vector<string>& vocabulary = generator.GetVocabulary();
+	const set<string, less<>> stop_words(vocabulary.begin(), vocabulary.begin() + 1500);
+	const StopWordSet stop_word_set(stop_words);
+	ASSERT_EQUAL(stop_word_set.GetSize(), stop_words.size());
+	for (const string& word : vocabulary) {
+		ASSERT_EQUAL(stop_word_set.Contains(word), stop_words.count(word) > 0);
+		// префиксы и продления слов не совпадают со словом
+		ASSERT_EQUAL(stop_word_set.Contains(string_view(word).substr(0, word.size() - 1)), stop_words.count(string_view(word).substr(0, word.size() - 1)) > 0);
+		ASSERT_EQUAL(stop_word_set.Contains(word + "x"s), stop_words.count(word + "x"s) > 0);
+	}
+	ASSERT(!stop_word_set.Contains(""sv));
+	ASSERT(!stop_word_set.Contains(string(100, 'a')));
+
+	// стоп-слова отбрасываются при индексации и в запросе
+	SearchServer server(stop_words);
+	server.AddDocument(0, vocabulary[0] + " "s + vocabulary[2000] + " "s + vocabulary[1], DocumentStatus::ACTUAL, { 1 });
+	const auto [words, status] = server.MatchDocument(vocabulary[0] + " "s + vocabulary[2000], 0);
+	ASSERT_EQUAL(words.size(), 1u);
+	ASSERT_EQUAL(words[0], vocabulary[2000]);
+	ASSERT(NearlyEquals(server.GetWordToFrequencies(0).front().second, 1.0));
+	ASSERT(server.FindTopDocuments(vocabulary[0]).empty());
+
+	try {
+		server.AddDocument(1, "bad\x01word"s, DocumentStatus::ACTUAL, { 1 });
+		ASSERT_HINT(false, "Control characters must be rejected"s);
+	} catch (const invalid_argument&) {
+	}
+}
+
+void TestReorganize() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 1000;
+	corpus_options.vocabulary_size = 300;
+	CorpusGenerator generator(corpus_options);
+	SearchServer server = MakeGeneratedServer(generator, "and in on"s);
+	for (int id = 0; id < 1000; id += 3) {
+		server.RemoveDocument(id);
+	}
+	server.SetStatisticsEpochOptions({ 50, chrono::milliseconds(0) });
+	server.AddDocument(5000, generator.GetVocabulary()[0] + " newword"s, DocumentStatus::ACTUAL, { 7 });
+	server.SetImpactOrderedPostings(true);
+	server.SetFuzzyEditDistance(1);
+
+	QueryLogOptions query_options;
+	query_options.query_count = 40;
+	query_options.minus_word_probability = 0.3;
+	vector<string> queries = GenerateQueryLog(generator.GetVocabulary(), query_options);
+	queries.push_back("newword"s);
+
+	const auto assert_same = [&queries](const SearchServer& lhs, const SearchServer& rhs) {
+		ASSERT_EQUAL(lhs.GetDocumentCount(), rhs.GetDocumentCount());
+		ASSERT(equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end()));
+		for (const string& query : queries) {
+			const vector<Document> expected = lhs.FindTopDocuments(query);
+			const vector<Document> docs = rhs.FindTopDocuments(query);
+			ASSERT_EQUAL(docs.size(), expected.size());
+			for (size_t i = 0; i < docs.size(); ++i) {
+				ASSERT_EQUAL(docs[i].id, expected[i].id);
+				ASSERT_EQUAL(docs[i].relevance, expected[i].relevance);
+			}
+			ASSERT_EQUAL(rhs.AggregateDocuments(query).rating_histogram, lhs.AggregateDocuments(query).rating_histogram);
+		}
+		for (const int id : lhs) {
+			const auto& expected = lhs.GetWordToFrequencies(id);
+			const auto& word_freqs = rhs.GetWordToFrequencies(id);
+			ASSERT(equal(word_freqs.begin(), word_freqs.end(), expected.begin(), expected.end()));
+			ASSERT(get<0>(rhs.MatchDocument(queries[0], id)) == get<0>(lhs.MatchDocument(queries[0], id)));
+		}
+	};
+
+	SearchServer reorganized = SearchServer::Reorganize(server);
+	assert_same(server, reorganized);
+	ASSERT_EQUAL(reorganized.GetStatisticsEpoch(), server.GetStatisticsEpoch());
+	ASSERT_EQUAL(reorganized.GetFuzzyEditDistance(), 1);
+	ASSERT(reorganized.HasImpactOrderedPostings());
+
+	SearchServer::ReorganizeOptions options;
+	options.query_sample = queries;
+	options.query_sample.push_back("--invalid"s);
+	options.use_huge_pages = true;
+	SearchServer hot_first = SearchServer::Reorganize(server, options);
+	assert_same(server, hot_first);
+
+	// копия остаётся обычным изменяемым индексом
+	for (SearchServer* target : { &server, &hot_first }) {
+		target->RemoveDocument(1);
+		target->AddDocument(6000, "newword "s + generator.GetVocabulary()[1], DocumentStatus::ACTUAL, { 3 });
+		target->PublishStatistics();
+	}
+	assert_same(server, hot_first);
+
+	// подмена работающего сервера копией идёт через указатель: копия переезжает конструктором перемещения
+	auto live = make_unique<SearchServer>(SearchServer::Reorganize(server));
+	live = make_unique<SearchServer>(SearchServer::Reorganize(*live));
+	assert_same(server, *live);
+	live->AddDocument(7000, "newword"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT_EQUAL(live->FindTopDocuments("newword"s).size(), 3u);
+}
+
+void TestMemoryStats() {
+	SearchServer server("and in on"s);
+	{
+		const auto stats = server.GetMemoryStats();
+		ASSERT_EQUAL(stats.postings, 0u);
+		ASSERT_EQUAL(stats.documents, 0u);
+	}
+
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 1000;
+	corpus_options.vocabulary_size = 300;
+	CorpusGenerator generator(corpus_options);
+	AddGeneratedDocuments(generator, SIZE_MAX, server);
+	size_t word_count = 0;
+	for (const int id : server) {
+		word_count += server.GetWordToFrequencies(id).size();
+	}
+	const auto filled = server.GetMemoryStats();
+	// узел списка хранит хотя бы id и частоту, документ — хотя бы свои частоты
+	ASSERT(filled.postings >= word_count * (sizeof(int) + sizeof(double)));
+	ASSERT(filled.documents >= word_count * sizeof(pair<string_view, double>));
+	ASSERT(filled.dictionary > 0);
+	ASSERT(filled.caches > 0);
+
+	server.SetImpactOrderedPostings(true);
+	const auto with_impact = server.GetMemoryStats();
+	ASSERT(with_impact.caches >= filled.caches + word_count * (sizeof(double) + 2 * sizeof(int)));
+	ASSERT_EQUAL(with_impact.postings, filled.postings);
+	server.SetImpactOrderedPostings(false);
+
+	server.SetFuzzyEditDistance(1);
+	ASSERT(server.GetMemoryStats().dictionary > filled.dictionary);
+	server.SetFuzzyEditDistance(0);
+
+	// освобождённое остаётся у пула арены и переходит в slack
+	for (int id = 0; id < 1000; ++id) {
+		server.RemoveDocument(id);
+	}
+	const auto emptied = server.GetMemoryStats();
+	ASSERT_EQUAL(emptied.postings, 0u);
+	ASSERT(emptied.slack >= filled.postings);
+	ASSERT(emptied.GetTotal() >= filled.GetTotal());
+
+	// повторные добавления и удаления переиспользуют освобождённое, а не берут новые блоки
+	for (int round = 0; round < 3; ++round) {
+		CorpusGenerator churn_generator(corpus_options);
+		AddGeneratedDocuments(churn_generator, SIZE_MAX, server);
+		for (int id = 0; id < 1000; ++id) {
+			server.RemoveDocument(id);
+		}
+	}
+	ASSERT(server.GetMemoryStats().GetTotal() < emptied.GetTotal() + emptied.GetTotal() / 4);
+
+	// перестройка отдаёт освобождённое вместе со старой ареной
+	const SearchServer reorganized = SearchServer::Reorganize(server);
+	ASSERT(reorganized.GetMemoryStats().GetTotal() < emptied.GetTotal() / 2);
+
+	// с внешним resource учёт структур тот же, slack — только хвосты пула слов
+	pmr::unsynchronized_pool_resource pool;
+	SearchServer pooled(""s, &pool);
+	pooled.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+	const auto pooled_stats = pooled.GetMemoryStats();
+	ASSERT(pooled_stats.postings > 0);
+	pooled.RemoveDocument(1);
+	ASSERT_EQUAL(pooled.GetMemoryStats().postings, 0u);
+	ASSERT_EQUAL(pooled.GetMemoryStats().slack, pooled_stats.slack);
+}
+
+#ifdef __cpp_impl_coroutine
+namespace {
+
+// Корутина без результата, которая запускается сразу и никого не ждёт при завершении
+struct DetachedCoroutine {
+	struct promise_type {
+		DetachedCoroutine get_return_object() {
+			return {};
+		}
+		suspend_never initial_suspend() noexcept {
+			return {};
+		}
+		suspend_never final_suspend() noexcept {
+			return {};
+		}
+		void return_void() {
+		}
+		void unhandled_exception() {
+			terminate();
+		}
+	};
+};
+
+DetachedCoroutine FindWithCoroutine(QueryExecutor& executor, const SearchServer& server, string query, AsyncQueryOptions options,
+	vector<Document>& result, bool& done) {
+	result = co_await AwaitTopDocuments(executor, server, move(query), move(options));
+	done = true;
+}
+
+}
+#endif
+
+void TestAsyncQueries() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 500;
+	corpus_options.vocabulary_size = 200;
+	CorpusGenerator generator(corpus_options);
+	SearchServer server = MakeGeneratedServer(generator, "and in on"s);
+
+	const auto check = [](const vector<Document>& docs, const vector<Document>& expected) {
+		ASSERT_EQUAL(docs.size(), expected.size());
+		for (size_t i = 0; i < docs.size(); ++i) {
+			ASSERT_EQUAL(docs[i].id, expected[i].id);
+			ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+		}
+	};
+
+	// простой цикл событий: завершения запросов приходят в его очередь и выполняются в этом потоке
+	struct EventLoop {
+		mutex events_mutex;
+		condition_variable event_posted;
+		deque<function<void()>> events;
+
+		void Post(function<void()> event) {
+			{
+				lock_guard guard(events_mutex);
+				events.push_back(move(event));
+			}
+			event_posted.notify_one();
+		}
+
+		void RunUntil(const function<bool()>& done) {
+			while (!done()) {
+				function<void()> event;
+				{
+					unique_lock lock(events_mutex);
+					event_posted.wait(lock, [this] {
+						return !events.empty();
+					});
+					event = move(events.front());
+					events.pop_front();
+				}
+				event();
+			}
+		}
+	};
+
+	QueryLogOptions query_options;
+	query_options.query_count = 200;
+	query_options.minus_word_probability = 0.3;
+	const vector<string> queries = GenerateQueryLog(generator.GetVocabulary(), query_options);
+
+	QueryExecutor executor(2);
+	ASSERT_EQUAL(executor.GetThreadCount(), 2u);
+	{
+		// все запросы в полёте одновременно, два потока исполнителя, один поток цикла
+		EventLoop loop;
+		AsyncQueryOptions options;
+		options.post_completion = [&loop](function<void()> completion) {
+			loop.Post(move(completion));
+		};
+		vector<vector<Document>> results(queries.size());
+		size_t completed = 0;
+		const thread::id loop_thread = this_thread::get_id();
+		bool on_loop_thread = true;
+		for (size_t i = 0; i < queries.size(); ++i) {
+			FindTopDocumentsAsync(executor, server, queries[i], options,
+				[&, i](vector<Document> documents, exception_ptr error) {
+					ASSERT(!error);
+					on_loop_thread = on_loop_thread && this_thread::get_id() == loop_thread;
+					results[i] = move(documents);
+					++completed;
+				}
+			);
+		}
+		loop.RunUntil([&completed, &queries] {
+			return completed == queries.size();
+		});
+		ASSERT(on_loop_thread);
+		for (size_t i = 0; i < queries.size(); ++i) {
+			check(results[i], server.FindTopDocuments(queries[i]));
+		}
+	}
+
+	{
+		AsyncQueryOptions options;
+		options.status = DocumentStatus::BANNED;
+		check(FindTopDocumentsAsync(executor, server, queries[0], options).get(), server.FindTopDocuments(queries[0], DocumentStatus::BANNED));
+		options = {};
+		options.mode = QueryMode::ALL;
+		check(FindTopDocumentsAsync(executor, server, queries[1], options).get(), server.FindTopDocuments(queries[1], QueryMode::ALL));
+
+		auto invalid = FindTopDocumentsAsync(executor, server, "cat --dog"s);
+		try {
+			invalid.get();
+			ASSERT_HINT(false, "Query errors must reach the future"s);
+		} catch (const invalid_argument&) {
+		}
+	}
+
+	{
+		// единственный поток исполнителя занят, пока не открыт gate
+		QueryExecutor single(1);
+		promise<void> gate;
+		single.Post([opened = gate.get_future().share()] {
+			opened.wait();
+		});
+
+		CancellationSource cancellation;
+		AsyncQueryOptions cancelled_options;
+		cancelled_options.cancellation = cancellation.GetToken();
+		auto cancelled = FindTopDocumentsAsync(single, server, queries[0], cancelled_options);
+
+		// дедлайн срабатывает, пока запрос ждёт в очереди
+		AsyncQueryOptions deadline_options;
+		deadline_options.deadline = QueryExecutor::Clock::now() + chrono::milliseconds(20);
+		auto late = FindTopDocumentsAsync(single, server, queries[0], deadline_options);
+		ASSERT(late.wait_for(chrono::seconds(10)) == future_status::ready);
+
+		deadline_options.deadline = QueryExecutor::Clock::now() + chrono::hours(1);
+		auto in_time = FindTopDocumentsAsync(single, server, queries[0], deadline_options);
+
+		cancellation.Cancel();
+		gate.set_value();
+		try {
+			cancelled.get();
+			ASSERT_HINT(false, "Cancelled query must fail"s);
+		} catch (const QueryCancelledError&) {
+		}
+		try {
+			late.get();
+			ASSERT_HINT(false, "Late query must fail"s);
+		} catch (const QueryDeadlineExceededError&) {
+		}
+		check(in_time.get(), server.FindTopDocuments(queries[0]));
+
+		deadline_options.deadline = QueryExecutor::Clock::now() - chrono::milliseconds(1);
+		try {
+			FindTopDocumentsAsync(single, server, queries[0], deadline_options).get();
+			ASSERT_HINT(false, "Expired deadline must fail"s);
+		} catch (const QueryDeadlineExceededError&) {
+		}
+	}
+
+#ifdef __cpp_impl_coroutine
+	{
+		EventLoop loop;
+		AsyncQueryOptions options;
+		options.post_completion = [&loop](function<void()> completion) {
+			loop.Post(move(completion));
+		};
+		vector<Document> result;
+		bool done = false;
+		FindWithCoroutine(executor, server, queries[0], options, result, done);
+		loop.RunUntil([&done] {
+			return done;
+		});
+		check(result, server.FindTopDocuments(queries[0]));
+	}
+#endif
+}
+
+void TestAdmissionControl() {
+	SearchServer server("and"s);
+	server.AddDocument(0, "white cat and fancy collar"s, DocumentStatus::ACTUAL, { 1 });
+	server.AddDocument(1, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 2 });
+	server.AddDocument(2, "groomed dog expressive eyes"s, DocumentStatus::ACTUAL, { 3 });
+	server.AddDocument(3, "groomed cat and dog"s, DocumentStatus::ACTUAL, { 4 });
+	server.AddDocument(4, "fancy dog"s, DocumentStatus::BANNED, { 5 });
+
+	{
+		const SearchServer::QueryCost cost = server.EstimateQueryCost("cat dog -collar and unknown"s);
+		ASSERT_EQUAL(cost.plus_word_count, 3u);
+		ASSERT_EQUAL(cost.posting_count, 3u + 3u + 1u);
+		const SearchServer::QueryCost limited = server.EstimateQueryCost("cat dog eyes"s, QueryMode::ANY, SearchServer::QueryLimits{ 1 });
+		ASSERT_EQUAL(limited.plus_word_count, 1u);
+		ASSERT_EQUAL(limited.posting_count, 1u);
+	}
+	{
+		// остаются самые редкие слова, обязательные не отбрасываются
+		vector<Document> result;
+		server.FillTopDocuments(execution::seq, "cat dog eyes"s, QueryMode::ANY,
+			[](int, DocumentStatus status, int) { return status == DocumentStatus::ACTUAL; }, SearchServer::QueryLimits{ 1 }, result);
+		ASSERT_EQUAL(result.size(), 1u);
+		ASSERT_EQUAL(result[0].id, 2);
+		server.FillTopDocuments(execution::seq, "+cat dog eyes"s, QueryMode::ANY,
+			[](int, DocumentStatus status, int) { return status == DocumentStatus::ACTUAL; }, SearchServer::QueryLimits{ 1 }, result);
+		ASSERT_EQUAL(result.size(), 3u);
+		ASSERT(server.EstimateQueryCost("+cat +dog eyes"s, QueryMode::ANY, SearchServer::QueryLimits{ 1 }).plus_word_count == 2u);
+	}
+
+	{
+		AdmissionController controller(server);
+		ASSERT(controller.GetOptions().max_concurrent_queries > 0);
+		const auto documents = controller.FindTopDocuments("fluffy groomed cat"s);
+		const auto expected = server.FindTopDocuments("fluffy groomed cat"s);
+		ASSERT_EQUAL(documents.size(), expected.size());
+		for (size_t i = 0; i < documents.size(); ++i) {
+			ASSERT_EQUAL(documents[i].id, expected[i].id);
+			ASSERT(NearlyEquals(documents[i].relevance, expected[i].relevance));
+		}
+		ASSERT_EQUAL(controller.FindTopDocuments("fancy"s, DocumentStatus::BANNED).size(), 1u);
+		ASSERT(controller.FindTopDocuments("cat dog"s, DocumentStatus::ACTUAL, QueryMode::ALL).size() == 1u);
+
+		const AdmissionCounters counters = controller.GetCounters();
+		ASSERT_EQUAL(counters.admitted, 3u);
+		ASSERT_EQUAL(counters.degraded + counters.rejected, 0u);
+		ASSERT_EQUAL(counters.admitted_cost, 1u + 2u + 3u + 2u + 3u + 3u);
+		ASSERT_EQUAL(counters.peak_in_flight_queries, 1u);
+
+		try {
+			controller.FindTopDocuments("cat --dog"s);
+			ASSERT_HINT(false, "Invalid query must throw"s);
+		} catch (const invalid_argument&) {
+		}
+		ASSERT_EQUAL(controller.GetInFlightQueries(), 0u);
+		ASSERT_EQUAL(controller.GetInFlightCost(), 0u);
+	}
+	{
+		// дорогой запрос упрощается, даже когда бюджет свободен
+		AdmissionOptions options;
+		options.max_query_cost = 4;
+		options.degraded_max_plus_words = 1;
+		AdmissionController controller(server, options);
+		vector<Document> result;
+		ASSERT(controller.FillTopDocuments("cat dog eyes"s, DocumentStatus::ACTUAL, QueryMode::ANY, result) == AdmissionDecision::DEGRADED);
+		ASSERT_EQUAL(result.size(), 1u);
+		ASSERT_EQUAL(result[0].id, 2);
+		// упрощать нечего — запрос выполняется целиком
+		ASSERT(controller.FillTopDocuments("cat"s, DocumentStatus::ACTUAL, QueryMode::ANY, result) == AdmissionDecision::ADMITTED);
+		ASSERT_EQUAL(result.size(), 3u);
+
+		const AdmissionCounters counters = controller.GetCounters();
+		ASSERT_EQUAL(counters.degraded, 1u);
+		ASSERT_EQUAL(counters.shed_cost, 6u);
+	}
+	{
+		// бюджет меньше любого запроса: в простаивающей системе запрос всё равно выполняется
+		AdmissionOptions options;
+		options.max_in_flight_cost = 0;
+		options.degraded_max_plus_words = 2;
+		AdmissionController controller(server, options);
+		vector<Document> result;
+		ASSERT(controller.FillTopDocuments("cat dog eyes"s, DocumentStatus::ACTUAL, QueryMode::ANY, result) == AdmissionDecision::DEGRADED);
+		ASSERT(controller.FillTopDocuments("cat"s, DocumentStatus::ACTUAL, QueryMode::ANY, result) == AdmissionDecision::ADMITTED);
+	}
+	try {
+		AdmissionOptions options;
+		options.degraded_max_plus_words = 0;
+		AdmissionController controller(server, options);
+		ASSERT_HINT(false, "Degraded query without words must be rejected"s);
+	} catch (const invalid_argument&) {
+	}
+
+	{
+		// под параллельной нагрузкой бюджет не превышается, а допущенные запросы дают обычный результат
+		std::mt19937 generator;
+		const auto dictionary = GenerateDictionary(generator, 1000, 10);
+		const auto texts = GenerateQueries(generator, dictionary, 5'000, 10);
+		SearchServer loaded_server(dictionary[0]);
+		for (size_t i = 0; i < texts.size(); ++i) {
+			loaded_server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+		}
+		const auto queries = GenerateQueries(generator, dictionary, 2'000, 7);
+
+		AdmissionOptions options;
+		options.max_concurrent_queries = 2;
+		options.max_in_flight_cost = 60;
+		options.degraded_max_plus_words = 2;
+		AdmissionController controller(loaded_server, options);
+		vector<vector<Document>> results;
+		vector<AdmissionDecision> decisions;
+		ProcessQueriesInto(controller, queries, results, &decisions);
+
+		const AdmissionCounters counters = controller.GetCounters();
+		ASSERT_EQUAL(counters.admitted + counters.degraded + counters.rejected, queries.size());
+		ASSERT(counters.peak_in_flight_queries <= 2u);
+		ASSERT(counters.degraded > 0);
+		ASSERT_EQUAL(controller.GetInFlightQueries(), 0u);
+		for (size_t i = 0; i < queries.size(); ++i) {
+			if (decisions[i] == AdmissionDecision::REJECTED) {
+				ASSERT(results[i].empty());
+			} else if (decisions[i] == AdmissionDecision::ADMITTED) {
+				const auto expected = loaded_server.FindTopDocuments(queries[i]);
+				ASSERT_EQUAL(results[i].size(), expected.size());
+				for (size_t j = 0; j < expected.size(); ++j) {
+					ASSERT_EQUAL(results[i][j].id, expected[j].id);
+				}
+			}
+		}
+	}
+}
+
+void TestWriteAheadLog() {
+	const filesystem::path directory = filesystem::temp_directory_path() / ("search_server_wal_test_"s + to_string(random_device{}()));
+	filesystem::remove_all(directory);
+	const auto collect_ids = [](const SearchServer& server) {
+		vector<int> ids(server.begin(), server.end());
+		sort(ids.begin(), ids.end());
+		return ids;
+	};
+
+	{
+		// записи читаются до первой повреждённой, хвост после неё отбрасывается
+		const string path = (directory / "records.log"s).string();
+		filesystem::create_directories(directory);
+		{
+			WriteAheadLog log(path);
+			log.Append({ LogRecordType::ADD_DOCUMENT, 7, DocumentStatus::BANNED, { 1, -2 }, "white cat"sv });
+			log.Append({ LogRecordType::REMOVE_DOCUMENT, 7, DocumentStatus::ACTUAL, {}, {} });
+			log.Append({ LogRecordType::ADD_DOCUMENT, 8, DocumentStatus::ACTUAL, {}, "dog"sv });
+			ASSERT_EQUAL(log.GetRecordCount(), 3u);
+			ASSERT_EQUAL(log.GetSyncCount(), 3u);
+		}
+		vector<string> texts;
+		LogReplayStats stats = WriteAheadLog::Replay(path, [&texts](const LogRecord& record) {
+			texts.push_back(string(record.text));
+			if (record.document_id == 7 && record.type == LogRecordType::ADD_DOCUMENT) {
+				ASSERT(record.status == DocumentStatus::BANNED);
+				ASSERT(record.ratings == vector<int>({ 1, -2 }));
+			}
+		});
+		ASSERT_EQUAL(stats.record_count, 3u);
+		ASSERT_EQUAL(stats.discarded_bytes, 0u);
+		ASSERT(texts == vector<string>({ "white cat"s, ""s, "dog"s }));
+
+		const uint64_t size = filesystem::file_size(path);
+		{
+			fstream file(path, ios::in | ios::out | ios::binary);
+			file.seekp(size - 1);
+			file.put('x');
+		}
+		stats = WriteAheadLog::Replay(path, [](const LogRecord&) {});
+		ASSERT_HINT(stats.record_count == 2u && stats.valid_bytes + stats.discarded_bytes == size, "Record with a wrong checksum must be discarded"s);
+		ASSERT_EQUAL(WriteAheadLog::Replay((directory / "missing.log"s).string(), [](const LogRecord&) {}).record_count, 0u);
+
+		// fsync раз в sync_every_records записей
+		const string batched_path = (directory / "batched.log"s).string();
+		WriteAheadLogOptions batched_options;
+		batched_options.sync_every_records = 10;
+		WriteAheadLog log(batched_path, batched_options);
+		for (int i = 0; i < 25; ++i) {
+			log.Append({ LogRecordType::REMOVE_DOCUMENT, i, DocumentStatus::ACTUAL, {}, {} });
+		}
+		ASSERT_EQUAL(log.GetWriteCount(), 25u);
+		ASSERT_EQUAL(log.GetSyncCount(), 2u);
+		log.Sync();
+		ASSERT_EQUAL(log.GetSyncCount(), 3u);
+	}
+
+	const string index_directory = (directory / "index"s).string();
+	vector<Document> expected;
+	{
+		SearchServer server("and"s);
+		DurableSearchServer durable(server, index_directory);
+		ASSERT_EQUAL(durable.GetRecoveryStats().log.record_count, 0u);
+		durable.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+		durable.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+		durable.AddDocument(3, "groomed dog"s, DocumentStatus::BANNED, {});
+		durable.RemoveDocument(2);
+		try {
+			durable.AddDocument(1, "duplicate"s, DocumentStatus::ACTUAL, {});
+			ASSERT_HINT(false, "Duplicate id must throw"s);
+		} catch (const invalid_argument&) {
+		}
+		expected = server.FindTopDocuments("cat dog"s);
+	}
+	{
+		SearchServer server("and"s);
+		DurableSearchServer durable(server, index_directory);
+		ASSERT_EQUAL(durable.GetRecoveryStats().log.record_count, 4u);
+		ASSERT(collect_ids(server) == vector<int>({ 1, 3 }));
+		const auto documents = server.FindTopDocuments("cat dog"s);
+		ASSERT_EQUAL(documents.size(), expected.size());
+		ASSERT_EQUAL(documents[0].id, 1);
+		ASSERT_EQUAL(documents[0].rating, expected[0].rating);
+		ASSERT_EQUAL(server.FindTopDocuments("dog"s, DocumentStatus::BANNED).size(), 1u);
+
+		durable.Checkpoint();
+		ASSERT_EQUAL(durable.GetGeneration(), 1u);
+		ASSERT(filesystem::exists(filesystem::path(index_directory) / "snapshot.1.tsv"s));
+		ASSERT(!filesystem::exists(filesystem::path(index_directory) / "wal.0.log"s));
+		durable.RemoveDocument(1);
+		durable.AddDocument(1, "black cat"s, DocumentStatus::ACTUAL, { 5 });
+		durable.AddDocument(4, "curly dog"s, DocumentStatus::ACTUAL, { 1 });
+	}
+	{
+		// недописанная запись в конце журнала — как при падении посреди write
+		ofstream(filesystem::path(index_directory) / "wal.1.log"s, ios::binary | ios::app) << "\x20\x00\x00"s;
+		SearchServer server("and"s);
+		DurableSearchServer durable(server, index_directory);
+		const RecoveryStats& stats = durable.GetRecoveryStats();
+		ASSERT_EQUAL(stats.generation, 1u);
+		ASSERT_EQUAL(stats.snapshot_document_count, 2u);
+		ASSERT_EQUAL(stats.log.record_count, 3u);
+		ASSERT_EQUAL(stats.log.discarded_bytes, 3u);
+		ASSERT(collect_ids(server) == vector<int>({ 1, 3, 4 }));
+		ASSERT_EQUAL(server.FindTopDocuments("black"s).size(), 1u);
+		ASSERT(server.FindTopDocuments("white"s).empty());
+		durable.AddDocument(5, "cat in boots"s, DocumentStatus::ACTUAL, { 2 });
+		durable.Checkpoint();
+		durable.AddDocument(6, "last dog"s, DocumentStatus::ACTUAL, { 2 });
+	}
+	{
+		// прерванная контрольная точка оставляет временный файл, он удаляется
+		ofstream(filesystem::path(index_directory) / "snapshot.3.tsv.tmp"s) << "1\t0\t\tbroken"s;
+		SearchServer server("and"s);
+		DurableSearchServer durable(server, index_directory);
+		ASSERT_EQUAL(durable.GetGeneration(), 2u);
+		ASSERT_EQUAL(durable.GetRecoveryStats().snapshot_document_count, 4u);
+		ASSERT(collect_ids(server) == vector<int>({ 1, 3, 4, 5, 6 }));
+		ASSERT(!filesystem::exists(filesystem::path(index_directory) / "snapshot.3.tsv.tmp"s));
+	}
+	{
+		// изменения потоков, пришедшие во время fsync, синхронизируются одной группой: первый fsync
+		// ждёт, пока каждый писатель не поставит в очередь свою запись
+		const string concurrent_directory = (directory / "concurrent"s).string();
+		const uint64_t writer_count = 4;
+		atomic<const DurableSearchServer*> durable_pointer = nullptr;
+		bool first_sync = true;
+		DurableSearchServerOptions options;
+		options.log.before_sync = [&durable_pointer, &first_sync, writer_count] {
+			if (!exchange(first_sync, false)) {
+				return true;
+			}
+			const auto deadline = chrono::steady_clock::now() + chrono::seconds(10);
+			const DurableSearchServer* durable = durable_pointer.load();
+			while (durable != nullptr && durable->GetLog().GetRecordCount() < writer_count && chrono::steady_clock::now() < deadline) {
+				this_thread::sleep_for(chrono::milliseconds(1));
+			}
+			return true;
+		};
+		SearchServer server;
+		DurableSearchServer durable(server, concurrent_directory, options);
+		durable_pointer = &durable;
+		vector<thread> writers;
+		for (uint64_t writer = 0; writer < writer_count; ++writer) {
+			writers.emplace_back([&durable, writer] {
+				for (int i = 0; i < 50; ++i) {
+					durable.AddDocument(static_cast<int>(writer) * 1000 + i, "word"s + to_string(i), DocumentStatus::ACTUAL, { i });
+				}
+			});
+		}
+		for (thread& writer : writers) {
+			writer.join();
+		}
+		ASSERT_EQUAL(durable.GetLog().GetRecordCount(), 200u);
+		ASSERT(durable.GetLog().GetSyncCount() < durable.GetLog().GetRecordCount());
+
+		SearchServer recovered;
+		DurableSearchServer recovered_durable(recovered, concurrent_directory);
+		ASSERT_EQUAL(recovered.GetDocumentCount(), 200);
+	}
+	{
+		// контрольные точки сменяют журнал, пока писатели ждут fsync предыдущего
+		const string checkpoint_directory = (directory / "checkpoint_race"s).string();
+		SearchServer server;
+		DurableSearchServer durable(server, checkpoint_directory);
+		atomic<int> running_writers = 4;
+		vector<thread> writers;
+		for (int writer = 0; writer < 4; ++writer) {
+			writers.emplace_back([&durable, &running_writers, writer] {
+				for (int i = 0; i < 100; ++i) {
+					durable.AddDocument(writer * 1000 + i, "word"s + to_string(i), DocumentStatus::ACTUAL, { i });
+					if (i % 10 == 9) {
+						durable.RemoveDocument(writer * 1000 + i);
+					}
+				}
+				--running_writers;
+			});
+		}
+		int checkpoint_count = 0;
+		while (running_writers > 0) {
+			durable.Checkpoint();
+			++checkpoint_count;
+		}
+		for (thread& writer : writers) {
+			writer.join();
+		}
+		ASSERT(checkpoint_count > 0);
+		const vector<int> expected_ids = collect_ids(server);
+		ASSERT_EQUAL(expected_ids.size(), 360u);
+
+		SearchServer recovered;
+		DurableSearchServer recovered_durable(recovered, checkpoint_directory);
+		ASSERT(collect_ids(recovered) == expected_ids);
+		ASSERT_EQUAL(distance(filesystem::directory_iterator(checkpoint_directory), filesystem::directory_iterator()), 2);
+	}
+	{
+		// после отказа журнала изменения, которые он не принял, не попадают и в индекс
+		const string failing_directory = (directory / "failing"s).string();
+		bool fail_sync = false;
+		DurableSearchServerOptions options;
+		options.log.before_sync = [&fail_sync] {
+			return !fail_sync;
+		};
+		SearchServer server;
+		DurableSearchServer durable(server, failing_directory, options);
+		durable.AddDocument(1, "white cat"s, DocumentStatus::ACTUAL, { 1 });
+		durable.AddDocument(2, "curly dog"s, DocumentStatus::ACTUAL, { 2 });
+		fail_sync = true;
+		const auto assert_log_failure = [](const auto& change) {
+			try {
+				change();
+				ASSERT_HINT(false, "A change must fail after the log failed"s);
+			} catch (const runtime_error&) {
+			}
+		};
+		// запись 3 уже в файле и в индексе, не удался только fsync
+		assert_log_failure([&durable] { durable.AddDocument(3, "fluffy cat"s, DocumentStatus::ACTUAL, { 3 }); });
+		assert_log_failure([&durable] { durable.AddDocument(4, "nasty rat"s, DocumentStatus::ACTUAL, { 4 }); });
+		assert_log_failure([&durable] { durable.RemoveDocument(1); });
+		ASSERT(collect_ids(server) == vector<int>({ 1, 2, 3 }));
+		ASSERT(server.FindTopDocuments("rat"s).empty());
+
+		SearchServer recovered;
+		DurableSearchServer recovered_durable(recovered, failing_directory);
+		ASSERT(collect_ids(recovered) == collect_ids(server));
+	}
+
+	filesystem::remove_all(directory);
+}
+
+// Доступ тестов к внутренним структурам SearchServer, чтобы сделать индекс несогласованным
+struct SearchServerTestAccess {
+	static void ErasePosting(SearchServer& server, string_view word, int document_id) {
+		server.word_to_document_freqs_.at(word).erase(document_id);
+	}
+	static void EraseDocument(SearchServer& server, int document_id) {
+		server.documents_.erase(document_id);
+	}
+	static void DuplicateDocumentOrder(SearchServer& server, int document_id) {
+		server.document_ids_.push_back(document_id);
+	}
+	static void EraseFromStatusFacet(SearchServer& server, int document_id) {
+		server.status_documents_[static_cast<size_t>(server.documents_.at(document_id).status)].Reset(document_id);
+	}
+	static void SetTermFreq(SearchServer& server, string_view word, int document_id, double term_freq) {
+		server.word_to_document_freqs_.at(word).at(document_id) = term_freq;
+	}
+	static void ClearPostings(SearchServer& server) {
+		for (auto& [word, documents] : server.word_to_document_freqs_) {
+			documents.clear();
+		}
+	}
+};
+
+void TestIndexVerification() {
+	const auto make_server = [] {
+		SearchServer server("and in"s);
+		server.AddDocument(1, "white cat and collar"s, DocumentStatus::ACTUAL, { 8, -3 });
+		server.AddDocument(2, "fluffy cat fluffy tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+		server.AddDocument(3, "groomed dog in garden"s, DocumentStatus::BANNED, { 1 });
+		server.AddDocument(0, "unique zebra"s, DocumentStatus::IRRELEVANT, {});
+		return server;
+	};
+	const auto has_violation = [](const SearchServer::VerificationReport& report, const string& text) {
+		return any_of(report.violations.begin(), report.violations.end(), [&text](const string& violation) {
+			return violation.find(text) != string::npos;
+		});
+	};
+
+	{
+		SearchServer server = make_server();
+		server.RemoveDocument(0);
+		server.SetFuzzyEditDistance(1);
+		server.SetImpactOrderedPostings(true);
+		server.AddDocument(5, "curly dog"s, DocumentStatus::ACTUAL, { 4 });
+		const SearchServer::VerificationReport report = server.Verify();
+		ASSERT_HINT(report.IsConsistent(), report.violations.empty() ? ""s : report.violations.front());
+		ASSERT_EQUAL(report.document_count, 4u);
+		ASSERT_EQUAL(report.posting_count, 3u + 3u + 3u + 2u);
+		ASSERT_EQUAL(report.word_count, 9u);
+		// слова удалённого документа остаются в словаре
+		ASSERT_EQUAL(report.retired_word_count, 2u);
+		ASSERT(server.Verify(execution::seq).IsConsistent());
+
+		SearchServer::StatisticsEpochOptions epoch_options;
+		epoch_options.document_interval = 100;
+		server.SetStatisticsEpochOptions(epoch_options);
+		ASSERT(server.Verify().IsConsistent());
+		server.RemoveDocument(5);
+		ASSERT(server.Verify().IsConsistent());
+		server.PublishStatistics();
+		ASSERT(server.Verify().IsConsistent());
+		ASSERT(SearchServer::Reorganize(server).Verify().IsConsistent());
+	}
+	{
+		SearchServer server = make_server();
+		SearchServerTestAccess::ErasePosting(server, "cat"sv, 2);
+		const SearchServer::VerificationReport report = server.Verify();
+		ASSERT_EQUAL(report.violation_count, 2u);
+		ASSERT(has_violation(report, "document 2 is missing from postings of word 'cat'"s));
+		ASSERT(has_violation(report, "postings hold 10 entries, documents list 11 words"s));
+	}
+	{
+		SearchServer server = make_server();
+		SearchServerTestAccess::EraseDocument(server, 3);
+		const SearchServer::VerificationReport report = server.Verify(execution::seq);
+		ASSERT(has_violation(report, "document order lists document 3 missing from the document table"s));
+		ASSERT(has_violation(report, "postings of word 'dog' reference missing document 3"s));
+		ASSERT(has_violation(report, "facets hold"s));
+	}
+	{
+		SearchServer server = make_server();
+		SearchServerTestAccess::DuplicateDocumentOrder(server, 1);
+		SearchServerTestAccess::EraseFromStatusFacet(server, 3);
+		SearchServerTestAccess::SetTermFreq(server, "zebra"sv, 0, 0.75);
+		const SearchServer::VerificationReport report = server.Verify();
+		ASSERT(has_violation(report, "document order lists document 1 twice"s));
+		ASSERT(has_violation(report, "document 3 is missing from its status facet"s));
+		ASSERT(has_violation(report, "postings of word 'zebra' disagree with document 0 on term frequency"s));
+	}
+	{
+		// отчёт хранит max_violations первых по тексту нарушений, но считает все
+		SearchServer server = make_server();
+		SearchServerTestAccess::ClearPostings(server);
+		const SearchServer::VerificationReport full_report = server.Verify(execution::seq, 1000);
+		ASSERT(full_report.violation_count > 10u);
+		ASSERT_EQUAL(full_report.violations.size(), full_report.violation_count);
+		ASSERT(is_sorted(full_report.violations.begin(), full_report.violations.end()));
+		const vector<string> expected_violations(full_report.violations.begin(), full_report.violations.begin() + 3);
+		for (int attempt = 0; attempt < 20; ++attempt) {
+			const SearchServer::VerificationReport report = server.Verify(3);
+			ASSERT_EQUAL(report.violation_count, full_report.violation_count);
+			ASSERT(report.violations == expected_violations);
+		}
+		ASSERT(server.Verify(0).violations.empty());
+	}
+}
+
 void TestMatchingDocuments() {
 	{
 		SearchServer server("a the and"s);
@@ -413,6 +1942,70 @@ void TestMatchingDocuments() {
 	}
 }
 
+void TestMatchDocuments() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 200;
+	corpus_options.vocabulary_size = 150;
+	// длинные документы сопоставляются галопом, короткие — слиянием
+	corpus_options.min_document_words = 1;
+	corpus_options.max_document_words = 200;
+	CorpusGenerator generator(corpus_options);
+	SearchServer server = MakeGeneratedServer(generator);
+
+	QueryLogOptions query_options;
+	query_options.query_count = 100;
+	query_options.max_query_words = 8;
+	query_options.minus_word_probability = 0.2;
+	const vector<string> queries = GenerateQueryLog(generator.GetVocabulary(), query_options);
+	const vector<int> document_ids(server.begin(), server.end());
+	for (const string& query : queries) {
+		set<string_view> plus_words;
+		set<string_view> minus_words;
+		for (const string_view word : SplitIntoWords(query)) {
+			if (word[0] == '-') {
+				minus_words.insert(word.substr(1));
+			} else {
+				plus_words.insert(word);
+			}
+		}
+
+		const auto batch = server.MatchDocuments(query, document_ids);
+		const auto parallel_batch = server.MatchDocuments(execution::par, query, document_ids);
+		ASSERT_EQUAL(batch.size(), document_ids.size());
+		for (size_t i = 0; i < document_ids.size(); ++i) {
+			vector<string_view> expected_words;
+			bool excluded = false;
+			for (const auto& [word, _] : server.GetWordToFrequencies(document_ids[i])) {
+				excluded = excluded || minus_words.count(word) > 0;
+				if (plus_words.count(word) > 0) {
+					expected_words.push_back(word);
+				}
+			}
+			if (excluded) {
+				expected_words.clear();
+			}
+
+			const auto [words, status] = server.MatchDocument(query, document_ids[i]);
+			ASSERT(words == expected_words);
+			ASSERT(get<0>(server.MatchDocument(execution::par, query, document_ids[i])) == expected_words);
+			ASSERT(get<0>(batch[i]) == expected_words);
+			ASSERT(get<0>(parallel_batch[i]) == expected_words);
+			ASSERT(get<1>(batch[i]) == status);
+		}
+	}
+
+	try {
+		server.MatchDocuments(execution::par, "cat"s, { 0, 100'000 });
+		ASSERT_HINT(false, "Unknown document id must be reported"s);
+	} catch (const out_of_range&) {
+	}
+	try {
+		server.MatchDocument("cat"s, -1);
+		ASSERT_HINT(false, "Unknown document id must be reported"s);
+	} catch (const out_of_range&) {
+	}
+}
+
 void TestSortMatchedDocumentsByRelevanceDescending() {
 	SearchServer server;
 	server.AddDocument(0, "white cat with black tail"s, DocumentStatus::ACTUAL, { 1 });
@@ -444,17 +2037,783 @@ void TestProcessQueries() {
 	TEST_PROCESSOR(ProcessQueries);
 }
 
+void TestFuzzyQueries() {
+	SearchServer server("and in"s);
+	server.AddDocument(0, "white cat and yellow hat"s, DocumentStatus::ACTUAL, { 1 });
+	server.AddDocument(1, "curly dog in the garden"s, DocumentStatus::ACTUAL, { 2 });
+	server.AddDocument(2, "black cart"s, DocumentStatus::ACTUAL, { 3 });
+
+	ASSERT(server.FindTopDocuments("kat"s).empty());
+	ASSERT_EQUAL(server.GetFuzzyEditDistance(), 0);
+
+	server.SetFuzzyEditDistance(1);
+	{
+		const auto docs = server.FindTopDocuments("kat"s);
+		ASSERT_EQUAL(docs.size(), 1u);
+		ASSERT_EQUAL(docs[0].id, 0);
+	}
+	{
+		const auto docs = server.FindTopDocuments("cat"s);
+		ASSERT_HINT(docs.size() == 1u && docs[0].id == 0, "Known words must not be expanded"s);
+	}
+	{
+		const auto docs = server.FindTopDocuments("curlt -cat"s);
+		ASSERT_EQUAL(docs.size(), 1u);
+		ASSERT_EQUAL(docs[0].id, 1);
+	}
+	ASSERT(server.FindTopDocuments("gardxxn"s).empty());
+
+	server.SetFuzzyEditDistance(2);
+	{
+		const auto docs = server.FindTopDocuments("gardxxn"s);
+		ASSERT_EQUAL(docs.size(), 1u);
+		ASSERT_EQUAL(docs[0].id, 1);
+	}
+
+	server.AddDocument(3, "grey mouse"s, DocumentStatus::ACTUAL, { 4 });
+	{
+		const auto docs = server.FindTopDocuments("moose"s);
+		ASSERT_HINT(docs.size() == 1u && docs[0].id == 3, "New words must be indexed for fuzzy search"s);
+	}
+
+	server.RemoveDocument(3);
+	ASSERT(server.FindTopDocuments("moose"s).empty());
+
+	server.SetFuzzyEditDistance(0);
+	ASSERT(server.FindTopDocuments("kat"s).empty());
+}
+
+void TestFuzzyTypoQueries() {
+	// слово индекса с одной заменённой буквой находит документы при расстоянии 1, а слова
+	// без опечаток ищутся так же, как без исправления; задержки сравнивает бенчмарк (query.fuzzy*)
+	std::mt19937 generator;
+	const auto dictionary = GenerateDictionary(generator, 300, 12);
+	const auto documents = GenerateQueries(generator, dictionary, 1'000, 10);
+
+	SearchServer search_server;
+	for (size_t i = 0; i < documents.size(); ++i) {
+		search_server.AddDocument(i, documents[i], DocumentStatus::ACTUAL, { 1, 2, 3 });
+	}
+
+	const auto queries = GenerateQueries(generator, dictionary, 200, 1);
+	vector<vector<Document>> exact_results;
+	for (const string& query : queries) {
+		exact_results.push_back(search_server.FindTopDocuments(query));
+	}
+	search_server.SetFuzzyEditDistance(1);
+	size_t corrected = 0;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const vector<Document> fuzzy_results = search_server.FindTopDocuments(queries[i]);
+		ASSERT_EQUAL(fuzzy_results.size(), exact_results[i].size());
+		for (size_t j = 0; j < fuzzy_results.size(); ++j) {
+			ASSERT_EQUAL(fuzzy_results[j].id, exact_results[i][j].id);
+		}
+
+		const string typo_query = GenerateTypos(generator, queries[i]);
+		if (!exact_results[i].empty()) {
+			ASSERT_HINT(!search_server.FindTopDocuments(typo_query).empty(), typo_query);
+			++corrected;
+		}
+	}
+	ASSERT(corrected > 0);
+}
+
+void TestFillTopDocumentsReusesBuffer() {
+	ASSERT_EQUAL(sizeof(Document), 16u);
+
+	SearchServer server("and with"s);
+	server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, { 1, 2 });
+	server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 1, 2 });
+	server.AddDocument(3, "nasty dog with big eyes"s, DocumentStatus::BANNED, { 1, 2 });
+	server.AddDocument(4, "nasty pigeon john"s, DocumentStatus::ACTUAL, { 1, 2 });
+
+	vector<Document> buffer;
+	buffer.reserve(16);
+	const Document* const data = buffer.data();
+	for (const string& query : { "curly nasty cat"s, "cat -curly"s, "dog"s, "pigeon hat tail"s }) {
+		server.FillTopDocuments(query, buffer);
+		const auto expected = server.FindTopDocuments(query);
+		ASSERT_EQUAL(buffer.size(), expected.size());
+		for (size_t i = 0; i < expected.size(); ++i) {
+			ASSERT_EQUAL(buffer[i].id, expected[i].id);
+			ASSERT(NearlyEquals(buffer[i].relevance, expected[i].relevance));
+		}
+		ASSERT_HINT(buffer.data() == data, "Result buffer must be reused"s);
+	}
+
+	server.FillTopDocuments("dog"s, DocumentStatus::BANNED, buffer);
+	ASSERT_EQUAL(buffer.size(), 1u);
+	ASSERT_EQUAL(buffer[0].id, 3);
+
+	const vector<string> queries = { "curly"s, "dog"s, "nasty"s };
+	vector<vector<Document>> documents_lists;
+	ProcessQueriesInto(server, queries, documents_lists);
+	ASSERT_EQUAL(documents_lists.size(), 3u);
+	ASSERT_EQUAL(documents_lists[0].size(), 1u);
+	ASSERT(documents_lists[1].empty());
+	ASSERT_EQUAL(documents_lists[2].size(), 1u);
+
+	vector<Document> joined;
+	ProcessQueriesJoinedInto(server, queries, documents_lists, joined);
+	ASSERT_EQUAL(joined.size(), 2u);
+	ASSERT_EQUAL(joined[0].id, 2);
+	ASSERT_EQUAL(joined[1].id, 4);
+	const Document* const joined_data = joined.data();
+	ProcessQueriesJoinedInto(server, { "curly"s }, documents_lists, joined);
+	ASSERT_EQUAL(joined.size(), 1u);
+	ASSERT_HINT(joined.data() == joined_data, "Joined buffer must be reused"s);
+}
+
+void TestRequestQueue() {
+	SearchServer search_server("and in at"s);
+	RequestQueue request_queue(search_server);
+
+	search_server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 7, 2, 7 });
+	search_server.AddDocument(2, "curly dog and fancy collar"s, DocumentStatus::ACTUAL, { 1, 2, 3 });
+	search_server.AddDocument(3, "big cat fancy collar "s, DocumentStatus::ACTUAL, { 1, 2, 8 });
+	search_server.AddDocument(4, "big dog sparrow Eugene"s, DocumentStatus::ACTUAL, { 1, 3, 2 });
+	search_server.AddDocument(5, "big dog sparrow Vasiliy"s, DocumentStatus::ACTUAL, { 1, 1, 1 });
+
+	for (int i = 0; i < 1439; ++i) {
+		request_queue.AddFindRequest("empty request"s);
+	}
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1439);
+	request_queue.AddFindRequest("curly dog"s);
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1439);
+	request_queue.AddFindRequest("big collar"s);
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1438);
+	request_queue.AddFindRequest("sparrow"s);
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 1437);
+
+	RequestQueue shared_queue(search_server, 4096);
+	vector<thread> workers;
+	for (int t = 0; t < 4; ++t) {
+		workers.emplace_back([&shared_queue, t]() {
+			vector<Document> result;
+			for (int i = 0; i < 500; ++i) {
+				shared_queue.AddFindRequest(i % 2 == 0 ? "curly dog"s : "empty request"s, result);
+			}
+		});
+	}
+	for (thread& worker : workers) {
+		worker.join();
+	}
+	ASSERT_EQUAL(shared_queue.GetNoResultRequests(), 1000);
+	ASSERT_EQUAL(shared_queue.GetStatistics(chrono::hours(1)).request_count, 2000u);
+}
+
+void TestRequestQueueStatistics() {
+	using namespace std::chrono;
+
+	SearchServer search_server;
+	RequestQueue request_queue(search_server, 100);
+	const RequestQueue::Clock::time_point start;
+
+	// 60 запросов с интервалом в секунду; каждый третий без результатов
+	for (int i = 1; i <= 60; ++i) {
+		request_queue.AddRequest(i % 3 == 0 ? 0 : 5, microseconds(i), start + seconds(i));
+	}
+	const auto now = start + seconds(60);
+
+	const auto last_ten = request_queue.GetStatistics(seconds(10), now);
+	ASSERT_EQUAL(last_ten.request_count, 10u);
+	ASSERT_EQUAL(last_ten.no_result_count, 4u);
+	ASSERT(NearlyEquals(last_ten.queries_per_second, 1.0));
+	ASSERT(last_ten.latency_p50 == microseconds(56));
+	ASSERT(last_ten.latency_max == microseconds(60));
+
+	const auto all = request_queue.GetStatistics(minutes(5), now);
+	ASSERT_EQUAL(all.request_count, 60u);
+	ASSERT(NearlyEquals(all.no_result_rate, 1.0 / 3));
+	ASSERT(all.latency_p99 == microseconds(60));
+
+	ASSERT_EQUAL(request_queue.GetStatistics(seconds(10), now + minutes(1)).request_count, 0u);
+
+	// кольцо хранит только последние 100 записей
+	for (int i = 61; i <= 200; ++i) {
+		request_queue.AddRequest(5, microseconds(1), start + seconds(i));
+	}
+	const auto wrapped = request_queue.GetStatistics(hours(1), start + seconds(200));
+	ASSERT_EQUAL(wrapped.request_count, 100u);
+	ASSERT(wrapped.covered_time == seconds(99));
+	ASSERT_EQUAL(request_queue.GetNoResultRequests(), 0);
+}
+
+void TestLatencyHistogram() {
+	for (uint64_t value : { 0ull, 1ull, 63ull, 64ull, 65ull, 1000ull, 123456ull, 987654321ull }) {
+		const size_t index = LatencyHistogram::GetBucketIndex(value);
+		ASSERT(index < LatencyHistogram::BUCKET_COUNT);
+		ASSERT(value <= LatencyHistogram::GetBucketUpperBound(index));
+		ASSERT(index == 0 || value > LatencyHistogram::GetBucketUpperBound(index - 1));
+		ASSERT(LatencyHistogram::GetBucketUpperBound(index) - value <= value / 32);
+	}
+	ASSERT_EQUAL(LatencyHistogram::GetBucketIndex(UINT64_MAX), LatencyHistogram::BUCKET_COUNT - 1);
+
+	LatencyHistogram histogram;
+	ASSERT_EQUAL(histogram.GetPercentile(0.5), 0u);
+	for (uint64_t value = 1; value <= 1000; ++value) {
+		histogram.Record(value * 1000);
+	}
+	ASSERT_EQUAL(histogram.GetCount(), 1000u);
+	ASSERT_EQUAL(histogram.GetMin(), 1000u);
+	ASSERT_EQUAL(histogram.GetMax(), 1000000u);
+	ASSERT(abs(static_cast<double>(histogram.GetPercentile(0.5)) - 500000.0) <= 500000.0 / 32);
+	ASSERT(abs(static_cast<double>(histogram.GetPercentile(0.99)) - 990000.0) <= 990000.0 / 32);
+	ASSERT_EQUAL(histogram.GetPercentile(1.0), 1000000u);
+
+	LatencyHistogram other;
+	other.Record(5);
+	histogram.Merge(other);
+	ASSERT_EQUAL(histogram.GetCount(), 1001u);
+	ASSERT_EQUAL(histogram.GetMin(), 5u);
+}
+
+void TestQueryProfile() {
+	ResetQueryProfile();
+	{
+		ScopedQueryStage stage(QueryStage::SCORE);
+		this_thread::sleep_for(chrono::milliseconds(2));
+	}
+	const size_t live_threads = GetQueryProfileThreadCount();
+	thread([]() {
+		QueryStageSequence stages;
+		stages.Next(QueryStage::PARSE);
+		stages.Next(QueryStage::TOP_K);
+	}).join();
+	// завершившийся поток освобождает свои гистограммы, но его замеры остаются в снимке
+	ASSERT_EQUAL(GetQueryProfileThreadCount(), live_threads);
+
+	const auto snapshot = GetQueryProfileSnapshot();
+	const auto& score = snapshot.stages[static_cast<size_t>(QueryStage::SCORE)];
+	ASSERT_EQUAL(score.GetCount(), 1u);
+	ASSERT(score.GetMax() >= 2'000'000u);
+	ASSERT_EQUAL(snapshot.stages[static_cast<size_t>(QueryStage::PARSE)].GetCount(), 1u);
+	ASSERT_EQUAL(snapshot.stages[static_cast<size_t>(QueryStage::TOP_K)].GetCount(), 1u);
+
+	ostringstream json;
+	PrintQueryProfileJson(json, snapshot);
+	ASSERT(json.str().find("\"score\": {\"count\": 1"s) != string::npos);
+
+	SearchServer server;
+	server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 1 });
+	server.AddDocument(2, "curly dog"s, DocumentStatus::BANNED, { 2 });
+	ResetQueryProfile();
+	server.FindTopDocuments("curly -dog"s);
+	server.FindTopDocuments(execution::par, "cat"s, DocumentStatus::ACTUAL);
+	const auto query_snapshot = GetQueryProfileSnapshot();
+	const auto stage_count = [&query_snapshot](QueryStage stage) {
+		return query_snapshot.stages[static_cast<size_t>(stage)].GetCount();
+	};
+#ifdef SEARCH_SERVER_PROFILE
+	// параллельный поиск дополнительно замеряет сборку результата из общей карты
+	ASSERT_EQUAL(stage_count(QueryStage::TOTAL), 2u);
+	ASSERT_EQUAL(stage_count(QueryStage::PARSE), 2u);
+	ASSERT_EQUAL(stage_count(QueryStage::TOP_K), 2u);
+	ASSERT_EQUAL(stage_count(QueryStage::MATERIALIZE), 3u);
+	ASSERT(stage_count(QueryStage::POSTING_FETCH) >= 2u);
+	ASSERT(stage_count(QueryStage::SCORE) >= 2u);
+#else
+	// без макроса инструментирование вырезано целиком
+	for (size_t stage = 0; stage < QUERY_STAGE_COUNT; ++stage) {
+		ASSERT_EQUAL(stage_count(static_cast<QueryStage>(stage)), 0u);
+	}
+#endif
+
+	ResetQueryProfile();
+	ASSERT_EQUAL(GetQueryProfileSnapshot().stages[static_cast<size_t>(QueryStage::SCORE)].GetCount(), 0u);
+}
+
+void TestCorpusGenerator() {
+	CorpusOptions options;
+	options.document_count = 500;
+	options.vocabulary_size = 1000;
+	options.duplicate_fraction = 0.1;
+
+	CorpusGenerator first(options);
+	CorpusGenerator second(options);
+	ASSERT(first.GetVocabulary() == second.GetVocabulary());
+	ASSERT_EQUAL(set<string>(first.GetVocabulary().begin(), first.GetVocabulary().end()).size(), 1000u);
+
+	GeneratedDocument lhs;
+	GeneratedDocument rhs;
+	map<string, int> word_counts;
+	size_t document_count = 0;
+	while (first.Next(lhs)) {
+		ASSERT(second.Next(rhs));
+		ASSERT_EQUAL(lhs.id, rhs.id);
+		ASSERT_EQUAL(lhs.text, rhs.text);
+		ASSERT(lhs.ratings == rhs.ratings);
+		for (const string_view word : SplitIntoWords(lhs.text)) {
+			++word_counts[string(word)];
+		}
+		++document_count;
+	}
+	ASSERT(!second.Next(rhs));
+	ASSERT_EQUAL(document_count, 500u);
+
+	const string& most_frequent = first.GetVocabulary()[0];
+	const string& rare = first.GetVocabulary()[999];
+	ASSERT_HINT(word_counts[most_frequent] > 10 * word_counts[rare], "Word frequencies must follow Zipf's law"s);
+
+	QueryLogOptions query_options;
+	query_options.query_count = 100;
+	const auto queries = GenerateQueryLog(first.GetVocabulary(), query_options);
+	ASSERT_EQUAL(queries.size(), 100u);
+	ASSERT(queries == GenerateQueryLog(first.GetVocabulary(), query_options));
+}
+
+void TestStringPool() {
+	StringPool pool(pmr::get_default_resource(), 16);
+	const string_view cat = pool.Add("cat"sv);
+	const string_view dog = pool.Add("dog"sv);
+	ASSERT_EQUAL(cat, "cat"sv);
+	ASSERT_EQUAL(dog, "dog"sv);
+	ASSERT_HINT(dog.data() == cat.data() + cat.size(), "Strings must be packed contiguously"s);
+
+	const string long_word(40, 'x');
+	ASSERT_EQUAL(pool.Add(long_word), long_word);
+	ASSERT_EQUAL(pool.Add("fox"sv).data(), dog.data() + dog.size());
+	ASSERT_EQUAL(pool.GetUsedBytes(), 49u);
+	ASSERT_EQUAL(pool.GetAllocatedBytes(), 56u);
+
+	StringPool moved(move(pool));
+	ASSERT_EQUAL(cat, "cat"sv);
+	ASSERT_EQUAL(moved.GetUsedBytes(), 49u);
+}
+
+namespace {
+
+class CountingMemoryResource : public pmr::memory_resource {
+public:
+	size_t allocated_bytes = 0;
+	size_t allocation_count = 0;
+
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		allocated_bytes += bytes;
+		++allocation_count;
+		return pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+
+	void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+		allocated_bytes -= bytes;
+		pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+	}
+
+	bool do_is_equal(const pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+}
+
+void TestCallerMemoryResource() {
+	CountingMemoryResource resource;
+	{
+		SearchServer server("and with"s, &resource);
+		SearchServer reference("and with"s);
+		for (SearchServer* target : { &server, &reference }) {
+			target->AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, { 1, 2 });
+			target->AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 1, 2 });
+			target->AddDocument(3, "nasty dog with big eyes"s, DocumentStatus::ACTUAL, { 1, 2 });
+		}
+		ASSERT(resource.allocated_bytes > 0);
+
+		const auto docs = server.FindTopDocuments("curly nasty cat"s);
+		const auto expected = reference.FindTopDocuments("curly nasty cat"s);
+		ASSERT_EQUAL(docs.size(), expected.size());
+		for (size_t i = 0; i < docs.size(); ++i) {
+			ASSERT_EQUAL(docs[i].id, expected[i].id);
+			ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+		}
+
+		const auto& word_freqs = server.GetWordToFrequencies(2);
+		ASSERT_EQUAL(word_freqs.size(), 3u);
+		ASSERT_EQUAL(word_freqs[0].first, "cat"sv);
+		ASSERT_EQUAL(word_freqs[1].first, "curly"sv);
+		ASSERT(NearlyEquals(word_freqs[1].second, 0.5));
+		ASSERT_EQUAL(word_freqs[2].first, "tail"sv);
+
+		SearchServer moved(move(server));
+		ASSERT_EQUAL(moved.FindTopDocuments("curly"s).size(), 1u);
+		ASSERT(moved.GetWordToFrequencies(42).empty());
+	}
+	ASSERT_HINT(resource.allocated_bytes == 0, "Server must return all memory to the caller's resource"s);
+}
+
+void TestCorpusLoader() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 300;
+	corpus_options.vocabulary_size = 500;
+	CorpusGenerator generator(corpus_options);
+
+	SearchServer reference("and in on"s);
+	ostringstream tsv;
+	GeneratedDocument document;
+	while (generator.Next(document)) {
+		reference.AddDocument(document.id, document.text, document.status, document.ratings);
+		tsv << document.id << '\t' << static_cast<int>(document.status) << '\t';
+		for (size_t i = 0; i < document.ratings.size(); ++i) {
+			tsv << (i > 0 ? ","s : ""s) << document.ratings[i];
+		}
+		tsv << '\t' << document.text << (document.id % 2 == 0 ? "\r\n"s : "\n"s);
+	}
+
+	// маленькие блоки и короткая очередь: строки режутся на границах блоков, чтение ждёт индексацию
+	CorpusLoaderOptions options;
+	options.chunk_size = 64;
+	options.worker_count = 3;
+	options.max_chunks_in_flight = 2;
+	SearchServer server("and in on"s);
+	istringstream input(tsv.str());
+	const CorpusLoadStats stats = LoadCorpus(server, input, options);
+	ASSERT_EQUAL(stats.document_count, 300u);
+	ASSERT_EQUAL(stats.skipped_line_count, 0u);
+	ASSERT_EQUAL(stats.byte_count, tsv.str().size());
+	ASSERT(stats.chunk_count > 1);
+
+	ASSERT(vector<int>(server.begin(), server.end()) == vector<int>(reference.begin(), reference.end()));
+	for (const string& query : GenerateQueryLog(generator.GetVocabulary(), QueryLogOptions{ 50 })) {
+		const auto docs = server.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; });
+		const auto expected = reference.FindTopDocuments(query, [](int, DocumentStatus, int) { return true; });
+		ASSERT_EQUAL(docs.size(), expected.size());
+		for (size_t i = 0; i < docs.size(); ++i) {
+			ASSERT_EQUAL(docs[i].id, expected[i].id);
+			ASSERT_EQUAL(docs[i].rating, expected[i].rating);
+			ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+		}
+	}
+
+	const string jsonl =
+		"{\"text\": \"white cat\", \"ratings\": [1, 2, 3], \"source\": {\"tags\": [\"a\", \"}\"]}}\n"s
+		"\n"s
+		"{\"status\": \"BANNED\", \"text\": \"curly\\ndog \\u0441\\u043e\\u0431\\u0430\\u043a\\u0430\", \"ratings\": []}\n"s
+		"{\"text\": \"broken\n"s
+		"{\"id\": -5, \"text\": \"negative id\"}\n"s;
+	CorpusLoaderOptions json_options;
+	json_options.format = CorpusFormat::JSON_LINES;
+	json_options.chunk_size = 16;
+	json_options.worker_count = 2;
+	{
+		SearchServer json_server(""s);
+		istringstream json_input(jsonl);
+		try {
+			LoadCorpus(json_server, json_input, json_options);
+			ASSERT_HINT(false, "Invalid line must abort loading"s);
+		} catch (const invalid_argument& e) {
+			ASSERT(string(e.what()).find("line 4"s) != string::npos);
+		}
+	}
+
+	json_options.skip_invalid_lines = true;
+	SearchServer json_server(""s);
+	istringstream json_input(jsonl);
+	const CorpusLoadStats json_stats = LoadCorpus(json_server, json_input, json_options);
+	ASSERT_EQUAL(json_stats.document_count, 2u);
+	ASSERT_EQUAL(json_stats.skipped_line_count, 2u);
+	ASSERT_EQUAL(json_server.GetDocumentId(0), 0);
+	ASSERT_EQUAL(json_server.GetDocumentId(1), 1);
+	const auto cats = json_server.FindTopDocuments("cat"s);
+	ASSERT_EQUAL(cats.size(), 1u);
+	ASSERT_EQUAL(cats[0].rating, 2);
+	ASSERT_EQUAL(json_server.FindTopDocuments("собака"s, DocumentStatus::BANNED).size(), 1u);
+	ASSERT_EQUAL(json_server.FindTopDocuments("dog"s, DocumentStatus::BANNED)[0].id, 1);
+
+	try {
+		LoadCorpusFile(json_server, "/nonexistent/corpus.tsv"s);
+		ASSERT_HINT(false, "Missing file must be reported"s);
+	} catch (const invalid_argument&) {
+	}
+}
+
+void TestQueryReplay() {
+	LatencyHistogram corrected;
+	corrected.RecordWithExpectedInterval(1000, 300);
+	ASSERT_EQUAL(corrected.GetCount(), 3u);
+	ASSERT_EQUAL(corrected.GetMin(), 400u);
+	corrected.RecordWithExpectedInterval(200, 300);
+	ASSERT_EQUAL(corrected.GetCount(), 4u);
+
+	SearchServer server("and with"s);
+	server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, { 1, 2 });
+	server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, { 1, 2 });
+	server.AddDocument(3, "nasty dog with big eyes"s, DocumentStatus::ACTUAL, { 1, 2 });
+
+	istringstream log("curly cat\n\nnasty dog\r\nparrot\nwhite hat\ncat -curly\n"s);
+	const vector<string> queries = ReadQueryLog(log);
+	ASSERT_EQUAL(queries.size(), 5u);
+	ASSERT_EQUAL(queries[1], "nasty dog"s);
+
+	ReplayOptions options;
+	options.client_count = 2;
+	const ReplayReport closed = ReplayQueries(server, queries, options);
+	ASSERT_EQUAL(closed.query_count, 5u);
+	ASSERT_EQUAL(closed.no_result_count, 1u);
+	ASSERT_EQUAL(closed.service_time.GetCount(), 5u);
+	ASSERT_EQUAL(closed.response_time.GetCount(), 5u);
+
+	options.api = ReplayApi::PROCESS_QUERIES;
+	options.batch_size = 2;
+	const ReplayReport batched = ReplayQueries(server, queries, options);
+	ASSERT_EQUAL(batched.query_count, 5u);
+	ASSERT_EQUAL(batched.no_result_count, 1u);
+
+	// открытый цикл: 5 запросов по расписанию 1000 q/s занимают не меньше 4 мс,
+	// а время ответа отсчитывается от запланированного момента
+	options.mode = ReplayMode::OPEN_LOOP;
+	options.api = ReplayApi::FIND_TOP_DOCUMENTS;
+	options.target_qps = 1000.0;
+	const ReplayReport open = ReplayQueries(server, queries, options);
+	ASSERT_EQUAL(open.query_count, 5u);
+	ASSERT(open.elapsed >= 4ms);
+	ASSERT(open.response_time.GetMax() >= open.service_time.GetMin());
+	ASSERT(NearlyEquals(open.offered_qps, 1000.0));
+
+	options.duration = 20ms;
+	const ReplayReport timed = ReplayQueries(server, queries, options);
+	ASSERT(timed.query_count >= 19u && timed.query_count <= 21u);
+
+	ostringstream json;
+	PrintReplayReportJson(json, timed);
+	ASSERT(json.str().find("\"response_time\": {\"count\": "s) != string::npos);
+
+	// некорректные строки журнала не роняют клиентов, а считаются отдельно
+	istringstream malformed_log("curly cat\ncat --dog\nnasty dog\n-\nparrot\nwhite hat\ncat -curly\n"s);
+	const vector<string> malformed_queries = ReadQueryLog(malformed_log);
+	ASSERT_EQUAL(malformed_queries.size(), 7u);
+	options = ReplayOptions{};
+	options.client_count = 3;
+	for (const ReplayApi api : { ReplayApi::FIND_TOP_DOCUMENTS, ReplayApi::PROCESS_QUERIES }) {
+		options.api = api;
+		const ReplayReport report = ReplayQueries(server, malformed_queries, options);
+		ASSERT_EQUAL(report.query_count, 5u);
+		ASSERT_EQUAL(report.failed_count, 2u);
+		ASSERT_EQUAL(report.no_result_count, 1u);
+		ASSERT_EQUAL(report.service_time.GetCount(), 5u);
+	}
+	options.duration = 10ms;
+	const ReplayReport timed_malformed = ReplayQueries(server, malformed_queries, options);
+	ASSERT(timed_malformed.failed_count > 0u);
+	ASSERT(timed_malformed.query_count > timed_malformed.failed_count);
+}
+
+void TestShardedSearchServer() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 600;
+	corpus_options.vocabulary_size = 300;
+	CorpusGenerator generator(corpus_options);
+
+	SearchServer reference("and in on"s);
+	ShardedSearchServer sharded("and in on"s, 3);
+	AddGeneratedDocuments(generator, SIZE_MAX, reference, sharded);
+	ASSERT_EQUAL(sharded.GetDocumentCount(), 600);
+	for (size_t i = 0; i < sharded.GetShardCount(); ++i) {
+		ASSERT_HINT(sharded.GetShard(i).GetDocumentCount() > 150, "Documents must be spread across shards"s);
+	}
+
+	// равные по релевантности документы могут идти в любом порядке, поэтому сравниваются ключи сортировки
+	const auto assert_same_top = [](const vector<Document>& docs, const vector<Document>& expected) {
+		ASSERT_EQUAL(docs.size(), expected.size());
+		for (size_t i = 0; i < docs.size(); ++i) {
+			ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+			ASSERT_EQUAL(docs[i].rating, expected[i].rating);
+		}
+	};
+	QueryLogOptions query_options;
+	query_options.query_count = 100;
+	const vector<string> queries = GenerateQueryLog(generator.GetVocabulary(), query_options);
+	for (const string& query : queries) {
+		assert_same_top(sharded.FindTopDocuments(query), reference.FindTopDocuments(query));
+		assert_same_top(sharded.FindTopDocuments(execution::par, query, DocumentStatus::BANNED), reference.FindTopDocuments(query, DocumentStatus::BANNED));
+	}
+	const auto even = [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; };
+	assert_same_top(sharded.FindTopDocuments(queries[0], even), reference.FindTopDocuments(queries[0], even));
+
+	const int document_id = reference.GetDocumentId(7);
+	const auto& word_freqs = reference.GetWordToFrequencies(document_id);
+	const string query = string(word_freqs.front().first) + " "s + string(word_freqs.back().first);
+	const auto [words, status] = sharded.MatchDocument(query, document_id);
+	const auto [expected_words, expected_status] = reference.MatchDocument(query, document_id);
+	ASSERT(words == expected_words);
+	ASSERT(status == expected_status);
+	ASSERT(get<0>(sharded.MatchDocument(execution::par, query, document_id)) == expected_words);
+
+	for (int id = 0; id < 600; id += 3) {
+		reference.RemoveDocument(id);
+		sharded.RemoveDocument(execution::par, id);
+	}
+	ASSERT_EQUAL(sharded.GetDocumentCount(), reference.GetDocumentCount());
+	for (const string& query : queries) {
+		assert_same_top(sharded.FindTopDocuments(execution::par, query), reference.FindTopDocuments(query));
+	}
+
+	try {
+		sharded.FindTopDocuments(execution::par, "cat --dog"s);
+		ASSERT_HINT(false, "Invalid query must be reported"s);
+	} catch (const invalid_argument&) {
+	}
+
+#ifdef __linux__
+	ShardedSearchServer pinned(""s, 2, { { 0 } });
+	ASSERT(pinned.IsShardPinned(0));
+	ASSERT(!pinned.IsShardPinned(1));
+	pinned.AddDocument(1, "pinned cat"s, DocumentStatus::ACTUAL, { 1 });
+	ASSERT_EQUAL(pinned.FindTopDocuments(execution::par, "cat"s).size(), 1u);
+#endif
+}
+
+void TestShardServer() {
+	CorpusOptions corpus_options;
+	corpus_options.document_count = 300;
+	corpus_options.vocabulary_size = 200;
+	CorpusGenerator generator(corpus_options);
+
+	const size_t shard_count = 3;
+	vector<unique_ptr<SearchServer>> shard_indexes;
+	vector<unique_ptr<ShardServer>> shard_servers;
+	vector<thread> shard_threads;
+	vector<uint16_t> ports;
+	for (size_t i = 0; i < shard_count; ++i) {
+		shard_indexes.push_back(make_unique<SearchServer>("and in on"s));
+		shard_servers.push_back(make_unique<ShardServer>(*shard_indexes.back()));
+		ports.push_back(shard_servers.back()->GetPort());
+		shard_threads.emplace_back(&ShardServer::Run, shard_servers.back().get());
+	}
+
+	SearchServer reference("and in on"s);
+	ShardCoordinator coordinator(ports, chrono::seconds(5));
+	AddGeneratedDocuments(generator, SIZE_MAX, reference, coordinator);
+	ASSERT_EQUAL(coordinator.GetDocumentCount(), 300);
+	for (size_t i = 0; i < shard_count; ++i) {
+		ASSERT_HINT(shard_indexes[i]->GetDocumentCount() > 50, "Documents must be spread across shards"s);
+	}
+
+	const auto assert_same_top = [](const vector<Document>& docs, const vector<Document>& expected) {
+		ASSERT_EQUAL(docs.size(), expected.size());
+		for (size_t i = 0; i < docs.size(); ++i) {
+			ASSERT(NearlyEquals(docs[i].relevance, expected[i].relevance));
+			ASSERT_EQUAL(docs[i].rating, expected[i].rating);
+		}
+	};
+	QueryLogOptions query_options;
+	query_options.query_count = 50;
+	const vector<string> queries = GenerateQueryLog(generator.GetVocabulary(), query_options);
+	for (const string& query : queries) {
+		ShardQueryOutcome outcome;
+		assert_same_top(coordinator.FindTopDocuments(query, DocumentStatus::ACTUAL, &outcome), reference.FindTopDocuments(query));
+		ASSERT(!outcome.IsPartial());
+		assert_same_top(coordinator.FindTopDocuments(query, DocumentStatus::BANNED), reference.FindTopDocuments(query, DocumentStatus::BANNED));
+	}
+
+	for (int id = 0; id < 300; id += 4) {
+		reference.RemoveDocument(id);
+		coordinator.RemoveDocument(id);
+	}
+	ASSERT_EQUAL(coordinator.GetDocumentCount(), reference.GetDocumentCount());
+	assert_same_top(coordinator.FindTopDocuments(queries[0]), reference.FindTopDocuments(queries[0]));
+
+	try {
+		coordinator.FindTopDocuments("cat --dog"s);
+		ASSERT_HINT(false, "Invalid query must be reported"s);
+	} catch (const invalid_argument&) {
+	}
+	try {
+		coordinator.AddDocument(1, "duplicate id"s, DocumentStatus::ACTUAL, { 1 });
+		ASSERT_HINT(false, "Duplicate id must be rejected by the shard"s);
+	} catch (const invalid_argument&) {
+	}
+	const string garbage_response = shard_servers[0]->HandleRequest("\x7f junk"sv);
+	ASSERT(ShardMessageReader(string_view(garbage_response).substr(4)).GetType() == ShardMessageType::FAILURE);
+
+	// шард, который принимает соединения, но не отвечает: результат частичный, ошибки нет
+	LoopbackSocket silent_shard = LoopbackSocket::Listen(0);
+	vector<uint16_t> ports_with_silent = ports;
+	ports_with_silent.push_back(silent_shard.GetLocalPort());
+	ShardCoordinator partial_coordinator(ports_with_silent, chrono::milliseconds(100));
+	ShardQueryOutcome outcome;
+	const vector<Document> partial = partial_coordinator.FindTopDocuments(queries[0], DocumentStatus::ACTUAL, &outcome);
+	ASSERT(outcome.IsPartial());
+	ASSERT(outcome.failed_shards == vector<size_t>{ shard_count });
+	// у молчащего шарда нет документов, поэтому ответ остальных совпадает с полным
+	assert_same_top(partial, reference.FindTopDocuments(queries[0]));
+
+	// шард, который не читает запросы: отправка большого запроса прерывается по таймауту
+	LoopbackSocket stalled_shard = LoopbackSocket::Listen(0);
+	ShardCoordinator stalled_coordinator({ stalled_shard.GetLocalPort() }, chrono::milliseconds(100));
+	string huge_document;
+	for (int i = 0; i < 4 << 20; ++i) {
+		huge_document += "cat dog "sv;
+	}
+	const auto send_start = chrono::steady_clock::now();
+	try {
+		stalled_coordinator.AddDocument(1, huge_document, DocumentStatus::ACTUAL, { 1 });
+		ASSERT_HINT(false, "Stalled shard must be reported"s);
+	} catch (const runtime_error&) {
+	}
+	ASSERT(chrono::steady_clock::now() - send_start < chrono::seconds(2));
+
+	// потоки закрытых соединений не копятся до Stop: координатор переподключается после каждого таймаута
+	const size_t connection_count = shard_servers[0]->GetConnectionCount();
+	for (int i = 0; i < 20; ++i) {
+		auto connection = LoopbackSocket::Connect(ports[0], chrono::seconds(1));
+		ASSERT(connection.has_value());
+	}
+	const auto reap_deadline = chrono::steady_clock::now() + chrono::seconds(5);
+	while (shard_servers[0]->GetConnectionCount() > connection_count && chrono::steady_clock::now() < reap_deadline) {
+		this_thread::sleep_for(chrono::milliseconds(10));
+	}
+	ASSERT_EQUAL(shard_servers[0]->GetConnectionCount(), connection_count);
+
+	for (size_t i = 0; i < shard_count; ++i) {
+		shard_servers[i]->Stop();
+		shard_threads[i].join();
+	}
+	ShardCoordinator stopped_coordinator(ports, chrono::milliseconds(100));
+	ASSERT(stopped_coordinator.FindTopDocuments(queries[0], DocumentStatus::ACTUAL, &outcome).empty());
+	ASSERT_EQUAL(outcome.failed_shards.size(), shard_count);
+}
+
 void TestSearchServer() {
 	RUN_TEST(TestExcludeStopWordsFromAddedDocumentContent);
 	RUN_TEST(TestFindAddedDocument);
 	RUN_TEST(TestMinusWords);
+	RUN_TEST(TestDocumentIdBitmap);
+	RUN_TEST(TestMinusWordsExcludeBeforeScoring);
 	RUN_TEST(TestComputeAverageRating);
 	RUN_TEST(TestFindWithPredicat);
 	RUN_TEST(TestFindDocumentsByStatus);
 	RUN_TEST(TestDocumentRelevanceCalculation);
+	RUN_TEST(TestStatisticsEpochs);
+	RUN_TEST(TestImpactOrderedPostings);
+	RUN_TEST(TestQuerySession);
+	RUN_TEST(TestSearchCursor);
+	RUN_TEST(TestAggregateDocuments);
+	RUN_TEST(TestRequiredWords);
+	RUN_TEST(TestStopWordSet);
+	RUN_TEST(TestReorganize);
+	RUN_TEST(TestMemoryStats);
+	RUN_TEST(TestAsyncQueries);
+	RUN_TEST(TestAdmissionControl);
+	RUN_TEST(TestWriteAheadLog);
+	RUN_TEST(TestIndexVerification);
 	RUN_TEST(TestMatchingDocuments);
+	RUN_TEST(TestMatchDocuments);
 	RUN_TEST(TestSortMatchedDocumentsByRelevanceDescending);
 	RUN_TEST(TestProcessQueries);
+	RUN_TEST(TestFuzzyQueries);
+	RUN_TEST(TestFuzzyTypoQueries);
+	RUN_TEST(TestFillTopDocumentsReusesBuffer);
+	RUN_TEST(TestRequestQueue);
+	RUN_TEST(TestRequestQueueStatistics);
+	RUN_TEST(TestLatencyHistogram);
+	RUN_TEST(TestQueryProfile);
+	RUN_TEST(TestCorpusGenerator);
+	RUN_TEST(TestStringPool);
+	RUN_TEST(TestCallerMemoryResource);
+	RUN_TEST(TestCorpusLoader);
+	RUN_TEST(TestQueryReplay);
+	RUN_TEST(TestShardedSearchServer);
+	RUN_TEST(TestShardServer);
 }
 
 void PrintDocument(const Document& document) {
@@ -560,6 +2919,21 @@ vector<string> GenerateQueries(std::mt19937& generator, const vector<string>& di
 	return queries;
 }
 
+string GenerateTypos(std::mt19937& generator, const string& query) {
+	string result = query;
+	for (size_t begin = 0; begin < result.size();) {
+		size_t end = result.find(' ', begin);
+		if (end == string::npos) {
+			end = result.size();
+		}
+		const size_t pos = uniform_int_distribution<size_t>(begin, end - 1)(generator);
+		result[pos] = static_cast<char>(uniform_int_distribution(int('a'), int('z'))(generator));
+		begin = end + 1;
+	}
+
+	return result;
+}
+
 template <typename QueriesProcessor>
 void TestParallelQueries(string_view mark, QueriesProcessor processor, const SearchServer& search_server, const vector<string>& queries) {
 	LOG_DURATION(mark);
@@ -56,6 +56,8 @@ void RunTestImpl(F func, const std::string& func_str);
 void TestExcludeStopWordsFromAddedDocumentContent();
 void TestFindAddedDocument();
 void TestMinusWords();
+void TestDocumentIdBitmap();
+void TestMinusWordsExcludeBeforeScoring();
 void TestComputeAverageRating();
 void TestFindWithPredicat();
 void TestFindDocumentsByStatus();
@@ -63,9 +65,37 @@ void TestFindDocumentsByStatus();
 bool NearlyEquals(double a, double b);
 
 void TestDocumentRelevanceCalculation();
+void TestStatisticsEpochs();
+void TestImpactOrderedPostings();
+void TestQuerySession();
+void TestSearchCursor();
+void TestAggregateDocuments();
+void TestRequiredWords();
+void TestStopWordSet();
+void TestReorganize();
+void TestMemoryStats();
+void TestAsyncQueries();
+void TestAdmissionControl();
+void TestWriteAheadLog();
+void TestIndexVerification();
 void TestMatchingDocuments();
+void TestMatchDocuments();
 void TestSortMatchedDocumentsByRelevanceDescending();
 void TestProcessQueries();
+void TestFuzzyQueries();
+void TestFuzzyTypoQueries();
+void TestFillTopDocumentsReusesBuffer();
+void TestRequestQueue();
+void TestRequestQueueStatistics();
+void TestLatencyHistogram();
+void TestQueryProfile();
+void TestCorpusGenerator();
+void TestStringPool();
+void TestCallerMemoryResource();
+void TestCorpusLoader();
+void TestQueryReplay();
+void TestShardedSearchServer();
+void TestShardServer();
 
 void TestSearchServer();
 
@@ -80,6 +110,7 @@ std::string GenerateWord(std::mt19937& generator, int max_length);
 std::vector<std::string> GenerateDictionary(std::mt19937& generator, int word_count, int max_length);
 std::string GenerateQuery(std::mt19937& generator, const std::vector<std::string>& dictionary, int max_word_count);
 std::vector<std::string> GenerateQueries(std::mt19937& generator, const std::vector<std::string>& dictionary, int query_count, int max_word_count);
+std::string GenerateTypos(std::mt19937& generator, const std::string& query);
 
 template <typename QueriesProcessor>
 void TestParallelQueries(std::string_view mark, QueriesProcessor processor, const SearchServer& search_server, const std::vector<std::string>& queries);
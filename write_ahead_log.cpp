@@ -0,0 +1,328 @@
+#include "write_ahead_log.h"
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+// запись длиннее — признак повреждённого заголовка, а не настоящая запись
+constexpr uint32_t MAX_RECORD_SIZE = 1u << 30;
+constexpr size_t HEADER_SIZE = 8;
+
+const array<uint32_t, 256>& GetCrcTable() {
+	static const array<uint32_t, 256> table = [] {
+		array<uint32_t, 256> result{};
+		for (uint32_t i = 0; i < 256; ++i) {
+			uint32_t value = i;
+			for (int bit = 0; bit < 8; ++bit) {
+				value = (value & 1) ? (value >> 1) ^ 0xEDB88320u : value >> 1;
+			}
+			result[i] = value;
+		}
+		return result;
+	}();
+	return table;
+}
+
+// CRC-32 (IEEE 802.3), как в zlib
+uint32_t ComputeCrc32(string_view data) {
+	const auto& table = GetCrcTable();
+	uint32_t crc = 0xFFFFFFFFu;
+	for (const char c : data) {
+		crc = table[(crc ^ static_cast<uint8_t>(c)) & 0xFF] ^ (crc >> 8);
+	}
+	return crc ^ 0xFFFFFFFFu;
+}
+
+void WriteUint32(string& output, uint32_t value) {
+	for (int shift = 0; shift < 32; shift += 8) {
+		output.push_back(static_cast<char>((value >> shift) & 0xFF));
+	}
+}
+
+uint32_t ReadUint32(string_view input, size_t& pos) {
+	if (input.size() - pos < 4) {
+		throw invalid_argument("Log record is truncated"s);
+	}
+	uint32_t value = 0;
+	for (int shift = 0; shift < 32; shift += 8) {
+		value |= static_cast<uint32_t>(static_cast<uint8_t>(input[pos++])) << shift;
+	}
+	return value;
+}
+
+void EncodeRecord(const LogRecord& record, string& output) {
+	const size_t header_pos = output.size();
+	output.append(HEADER_SIZE, '\0');
+	output.push_back(static_cast<char>(record.type));
+	WriteUint32(output, static_cast<uint32_t>(record.document_id));
+	if (record.type == LogRecordType::ADD_DOCUMENT) {
+		WriteUint32(output, static_cast<uint32_t>(record.status));
+		WriteUint32(output, static_cast<uint32_t>(record.ratings.size()));
+		for (const int rating : record.ratings) {
+			WriteUint32(output, static_cast<uint32_t>(rating));
+		}
+		WriteUint32(output, static_cast<uint32_t>(record.text.size()));
+		output.append(record.text);
+	}
+
+	const string_view payload = string_view(output).substr(header_pos + HEADER_SIZE);
+	if (payload.size() > MAX_RECORD_SIZE) {
+		output.resize(header_pos);
+		throw invalid_argument("Log record is too large"s);
+	}
+	string header;
+	WriteUint32(header, static_cast<uint32_t>(payload.size()));
+	WriteUint32(header, ComputeCrc32(payload));
+	output.replace(header_pos, HEADER_SIZE, header);
+}
+
+// Бросает invalid_argument, если данные записи не соответствуют формату
+LogRecord DecodeRecord(string_view payload) {
+	if (payload.empty()) {
+		throw invalid_argument("Log record is empty"s);
+	}
+	LogRecord record;
+	record.type = static_cast<LogRecordType>(payload[0]);
+	size_t pos = 1;
+	record.document_id = static_cast<int>(ReadUint32(payload, pos));
+	if (record.type == LogRecordType::ADD_DOCUMENT) {
+		const uint32_t status = ReadUint32(payload, pos);
+		if (status > static_cast<uint32_t>(DocumentStatus::REMOVED)) {
+			throw invalid_argument("Invalid document status in log"s);
+		}
+		record.status = static_cast<DocumentStatus>(status);
+		const uint32_t rating_count = ReadUint32(payload, pos);
+		if (rating_count > (payload.size() - pos) / 4) {
+			throw invalid_argument("Log record is truncated"s);
+		}
+		record.ratings.reserve(rating_count);
+		for (uint32_t i = 0; i < rating_count; ++i) {
+			record.ratings.push_back(static_cast<int>(ReadUint32(payload, pos)));
+		}
+		const uint32_t text_size = ReadUint32(payload, pos);
+		if (text_size > payload.size() - pos) {
+			throw invalid_argument("Log record is truncated"s);
+		}
+		record.text = payload.substr(pos, text_size);
+		pos += text_size;
+	} else if (record.type != LogRecordType::REMOVE_DOCUMENT) {
+		throw invalid_argument("Unknown log record type"s);
+	}
+	if (pos != payload.size()) {
+		throw invalid_argument("Log record has trailing bytes"s);
+	}
+	return record;
+}
+
+#ifdef _WIN32
+int OpenForAppend(const string& path) {
+	return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+
+bool WriteAll(int descriptor, string_view data) {
+	while (!data.empty()) {
+		const int written = _write(descriptor, data.data(), static_cast<unsigned>(min<size_t>(data.size(), INT_MAX)));
+		if (written <= 0) {
+			return false;
+		}
+		data.remove_prefix(written);
+	}
+	return true;
+}
+
+bool SyncFile(int descriptor) {
+	return _commit(descriptor) == 0;
+}
+
+void CloseFile(int descriptor) {
+	_close(descriptor);
+}
+#else
+int OpenForAppend(const string& path) {
+	return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+}
+
+bool WriteAll(int descriptor, string_view data) {
+	while (!data.empty()) {
+		const ssize_t written = write(descriptor, data.data(), data.size());
+		if (written < 0 && errno == EINTR) {
+			continue;
+		}
+		if (written <= 0) {
+			return false;
+		}
+		data.remove_prefix(written);
+	}
+	return true;
+}
+
+bool SyncFile(int descriptor) {
+#ifdef __linux__
+	// размер файла меняется при дозаписи, поэтому fdatasync всё равно сбрасывает его метаданные
+	return fdatasync(descriptor) == 0;
+#else
+	return fsync(descriptor) == 0;
+#endif
+}
+
+void CloseFile(int descriptor) {
+	close(descriptor);
+}
+#endif
+
+}
+
+WriteAheadLog::WriteAheadLog(const string& path, const WriteAheadLogOptions& options)
+	: path_(path)
+	, options_(options)
+	, descriptor_(OpenForAppend(path))
+{
+	if (descriptor_ < 0) {
+		throw runtime_error("Cannot open write-ahead log "s + path);
+	}
+}
+
+WriteAheadLog::~WriteAheadLog() {
+	try {
+		Sync();
+	} catch (const exception&) {
+	}
+	CloseFile(descriptor_);
+}
+
+void WriteAheadLog::Append(const LogRecord& record) {
+	WaitDurable(Enqueue(record));
+}
+
+uint64_t WriteAheadLog::Enqueue(const LogRecord& record) {
+	lock_guard guard(mutex_);
+	if (failed_) {
+		throw runtime_error("Write-ahead log "s + path_ + " failed"s);
+	}
+	EncodeRecord(record, pending_);
+	return ++enqueued_records_;
+}
+
+void WriteAheadLog::WaitDurable(uint64_t sequence) {
+	unique_lock lock(mutex_);
+	Flush(lock, sequence, options_.sync_every_records > 0 && sequence % options_.sync_every_records == 0);
+}
+
+void WriteAheadLog::Sync() {
+	unique_lock lock(mutex_);
+	Flush(lock, enqueued_records_, true);
+}
+
+uint64_t WriteAheadLog::GetRecordCount() const {
+	lock_guard guard(mutex_);
+	return enqueued_records_;
+}
+
+uint64_t WriteAheadLog::GetWriteCount() const {
+	lock_guard guard(mutex_);
+	return write_count_;
+}
+
+uint64_t WriteAheadLog::GetSyncCount() const {
+	lock_guard guard(mutex_);
+	return sync_count_;
+}
+
+const string& WriteAheadLog::GetPath() const {
+	return path_;
+}
+
+void WriteAheadLog::Flush(unique_lock<mutex>& lock, uint64_t sequence, bool sync) {
+	while (true) {
+		if (failed_) {
+			throw runtime_error("Write-ahead log "s + path_ + " failed"s);
+		}
+		if ((sync ? synced_records_ : written_records_) >= sequence) {
+			return;
+		}
+		if (flushing_) {
+			flushed_.wait(lock);
+			continue;
+		}
+
+		// лидер группы забирает всё накопленное; остальные ждут его или становятся лидером следующей группы
+		flushing_ = true;
+		string batch;
+		batch.swap(pending_);
+		const uint64_t record_count = enqueued_records_;
+		const size_t batch_size = options_.sync_every_records;
+		const bool sync_batch = sync || (batch_size > 0 && record_count / batch_size > synced_records_ / batch_size);
+		lock.unlock();
+		bool succeeded = WriteAll(descriptor_, batch);
+		if (succeeded && sync_batch) {
+			succeeded = (!options_.before_sync || options_.before_sync()) && SyncFile(descriptor_);
+		}
+		lock.lock();
+
+		flushing_ = false;
+		if (succeeded) {
+			write_count_ += batch.empty() ? 0 : 1;
+			written_records_ = record_count;
+			if (sync_batch) {
+				++sync_count_;
+				synced_records_ = record_count;
+			}
+		} else {
+			failed_ = true;
+		}
+		flushed_.notify_all();
+	}
+}
+
+LogReplayStats WriteAheadLog::Replay(const string& path, const function<void(const LogRecord&)>& callback) {
+	LogReplayStats stats;
+	ifstream input(path, ios::binary);
+	if (!input) {
+		return stats;
+	}
+	input.seekg(0, ios::end);
+	const uint64_t file_size = static_cast<uint64_t>(input.tellg());
+	input.seekg(0);
+
+	string header(HEADER_SIZE, '\0');
+	string payload;
+	while (input.read(header.data(), HEADER_SIZE)) {
+		size_t pos = 0;
+		const uint32_t size = ReadUint32(header, pos);
+		const uint32_t crc = ReadUint32(header, pos);
+		if (size > MAX_RECORD_SIZE || size > file_size - stats.valid_bytes - HEADER_SIZE) {
+			break;
+		}
+		payload.resize(size);
+		if (!input.read(payload.data(), size) || ComputeCrc32(payload) != crc) {
+			break;
+		}
+		LogRecord record;
+		try {
+			record = DecodeRecord(payload);
+		} catch (const invalid_argument&) {
+			break;
+		}
+		callback(record);
+		++stats.record_count;
+		stats.valid_bytes += HEADER_SIZE + size;
+	}
+	stats.discarded_bytes = file_size - stats.valid_bytes;
+	return stats;
+}
\ No newline at end of file
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+struct WriteAheadLogOptions {
+	// fsync после каждых sync_every_records записей: 1 — Append возвращается, когда запись на диске;
+	// N — на диске гарантированно всё, кроме последних < N записей; 0 — fsync только в Sync.
+	// Записанное без fsync переживает падение процесса, но не ОС
+	size_t sync_every_records = 1;
+	// Вызывается перед каждым fsync вне блокировки журнала. Тесты задерживают им синхронизацию,
+	// чтобы записи других потоков гарантированно собрались в группу, или возвращают false,
+	// чтобы сымитировать отказ fsync
+	std::function<bool()> before_sync;
+};
+
+enum class LogRecordType : uint8_t {
+	ADD_DOCUMENT = 1,
+	REMOVE_DOCUMENT = 2,
+};
+
+struct LogRecord {
+	LogRecordType type = LogRecordType::ADD_DOCUMENT;
+	int document_id = 0;
+	// только для ADD_DOCUMENT
+	DocumentStatus status = DocumentStatus::ACTUAL;
+	std::vector<int> ratings;
+	std::string_view text;
+};
+
+struct LogReplayStats {
+	size_t record_count = 0;
+	// длина целых записей; хвост после неё недописан или повреждён
+	uint64_t valid_bytes = 0;
+	uint64_t discarded_bytes = 0;
+};
+
+// Журнал изменений индекса, открытый на дозапись. Запись — [длина][CRC-32][тип][данные],
+// числа little-endian. Записи потоков, пришедшие, пока другой поток пишет и вызывает fsync,
+// копятся и уходят следующей группой одним write и одним fsync (group commit).
+// Потокобезопасен. Ошибка ввода-вывода бросает runtime_error, и журнал перестаёт принимать записи
+class WriteAheadLog {
+public:
+	explicit WriteAheadLog(const std::string& path, const WriteAheadLogOptions& options = {});
+	WriteAheadLog(const WriteAheadLog&) = delete;
+	WriteAheadLog& operator=(const WriteAheadLog&) = delete;
+	// Дописывает и синхронизирует накопленное; ошибки игнорируются
+	~WriteAheadLog();
+
+	// Append = Enqueue + WaitDurable
+	void Append(const LogRecord& record);
+	// Ставит запись в очередь и возвращает её номер. Порядок записей в файле — порядок Enqueue,
+	// поэтому его можно вызывать под блокировкой индекса, а ждать записи — уже без неё
+	uint64_t Enqueue(const LogRecord& record);
+	// Ждёт, пока запись sequence будет записана, а если на ней кончается пакет fsync — и синхронизирована
+	void WaitDurable(uint64_t sequence);
+	// Записывает и синхронизирует все поставленные записи
+	void Sync();
+
+	uint64_t GetRecordCount() const;
+	uint64_t GetWriteCount() const;
+	uint64_t GetSyncCount() const;
+	const std::string& GetPath() const;
+
+	// Вызывает callback для записей файла по порядку до первой недописанной или повреждённой.
+	// text записи действителен только внутри callback. Отсутствующий файл — пустой журнал
+	static LogReplayStats Replay(const std::string& path, const std::function<void(const LogRecord&)>& callback);
+
+private:
+	std::string path_;
+	WriteAheadLogOptions options_;
+	int descriptor_ = -1;
+
+	mutable std::mutex mutex_;
+	std::condition_variable flushed_;
+	std::string pending_;
+	uint64_t enqueued_records_ = 0;
+	uint64_t written_records_ = 0;
+	uint64_t synced_records_ = 0;
+	uint64_t write_count_ = 0;
+	uint64_t sync_count_ = 0;
+	bool flushing_ = false;
+	bool failed_ = false;
+
+	// Пишет очередь, пока условие ожидания не выполнится; вызывается под mutex_ через lock
+	void Flush(std::unique_lock<std::mutex>& lock, uint64_t sequence, bool sync);
+};
\ No newline at end of file